@@ -10,9 +10,6 @@
 loadObject("objects/sphere.obj")
 
 robs = 40.0
-ksiCrit = 7.2
-coordRadius = math.tan(math.rad(ksiCrit)) * robs
---coordRadius = 3.0
 
 imgFactor = 1
 
@@ -32,8 +29,8 @@ setPatFreq(12, 12)
 -- set sphere texture
 setObjTexture("col_sphere")
 
--- set apparent black hole radius (in coordinates)
-setBlackHoleRadius(coordRadius)
+-- black hole radius 0: analytic shadow
+setBlackHoleRadius(0)
 setBlackHoleColor(0.7,0.7,0.7, 1.0)
 setBlackHoleFlatShading(true)
 
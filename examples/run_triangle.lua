@@ -11,8 +11,6 @@
 loadObject("objects/triangle.obj")
 
 robs = 40.0
-ksiCrit = 7.274
-coordRadius = math.tan(math.rad(ksiCrit)) * robs
 
 -- camera position, point of interest, and field of view
 setCamPos(robs, 0.0, 0.0)
@@ -30,8 +28,8 @@ setPatFreq(10, 10)
 -- set triangle texture
 setObjTexture("triangle")
 
--- set apparent black hole radius (in coordinates)
-setBlackHoleRadius(coordRadius)
+-- black hole radius 0: analytic shadow
+setBlackHoleRadius(0)
 setBlackHoleColor(0.7,0.7,0.7, 1.0)
 setBlackHoleFlatShading(true)
 
@@ -10,8 +10,6 @@
 loadObject("objects/triangle.obj")
 
 robs = 40.0
-ksiCrit = 7.274
-coordRadius = math.tan(math.rad(ksiCrit)) * robs
 
 imgFactor = 2.0
 
@@ -34,8 +32,8 @@ setPatFreq(10, 10)
 -- set triangle texture
 setObjTexture("triangle")
 
--- set apparent black hole radius (in coordinates)
-setBlackHoleRadius(coordRadius)
+-- black hole radius 0: analytic shadow
+setBlackHoleRadius(0)
 setBlackHoleColor(0.0,0.0,0.0, 1.0)
 setBlackHoleFlatShading(true)
 
@@ -0,0 +1,309 @@
+/**
+ * File:   bench.cpp
+ * Author: Thomas Mueller, HdA/MPIA
+ *
+ *  Microbenchmark of the geodesic integrator and the lookup table generation.
+ *  All measurements use a fixed sample set, so that results of different
+ *  builds can be compared directly:
+ *
+ *    ./GenLookupBench  [options]
+ *
+ *      --steps <n>           number of rkck/rkqs steps          (200000)
+ *      --lut-size <Nr> <Nphi>  size of lookup table for scaling   (16 32)
+ *      --max-threads <n>     maximum number of threads          (all)
+ *      --output <file>       result file                        (genlookup_bench.json)
+ *
+ *  Measured are
+ *     - rkck:          Cash-Karp steps per second,
+ *     - rkqs:          adaptive steps per second,
+ *     - integrate:     time per ray,
+ *     - findGeodesic:  time per cell, with histograms of the number of
+ *                      bisection steps and random restarts,
+ *     - calcLUT:       wall time for 1..N threads, and whether the table
+ *                      is identical to the single-threaded one.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "nrRungeKutta.h"
+#include "schwarzschild.h"
+#include "helper.h"
+#include "lutgen.h"
+
+constexpr double rInit = 40.0;
+constexpr double rmin = 2.5;
+constexpr double rmax = 30.0;
+
+constexpr unsigned int NumRays = 32;
+constexpr unsigned int NumCellsR = 8;
+constexpr unsigned int NumCellsPhi = 16;
+
+constexpr unsigned int IterBinWidth = 8;
+constexpr unsigned int NumIterBins = MaxTries / IterBinWidth + 1;
+constexpr unsigned int NumRandomBins = 5; // 0, 1-9, 10-99, 100-999, >= 1000
+
+typedef std::chrono::steady_clock Clock;
+
+// keeps the compiler from removing the rkck loop
+static volatile double benchSink = 0.0;
+
+static double secondsSince(const Clock::time_point& t)
+{
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+struct Sample
+{
+    int order;
+    double r;
+    double phi;
+};
+
+struct ScalingResult
+{
+    int numThreads;
+    double seconds;
+    bool identical;
+};
+
+/**
+ *  Fixed set of target points: regular grid in (rs/r, phi) for both
+ *  image orders, the same parametrization as the lookup table.
+ */
+static std::vector<Sample> getSamples()
+{
+    std::vector<Sample> samples;
+    double xmin = 2.0 / rmax;
+    double xmax = 2.0 / rmin;
+    for (int order = 0; order < 2; order++) {
+        for (unsigned int ir = 0; ir < NumCellsR; ir++) {
+            double x = xmin + (xmax - xmin) * (ir + 0.5) / NumCellsR;
+            for (unsigned int ip = 0; ip < NumCellsPhi; ip++) {
+                double phi = PI * (ip + 0.5) / NumCellsPhi;
+                samples.push_back({ order, 2.0 / x, (order == 0 ? phi : 2.0 * PI - phi) });
+            }
+        }
+    }
+    return samples;
+}
+
+static double benchRKCK(unsigned int numSteps)
+{
+    double y[Ncoords], dydx[Ncoords], yout[Ncoords], yerr[Ncoords];
+    double sink = 0.0;
+
+    auto t = Clock::now();
+    for (unsigned int i = 0; i < numSteps; i++) {
+        if (i % NumRays == 0) {
+            schwarzschild_initialize(rInit, PI * ((i / NumRays) % NumRays + 0.5) / NumRays, y);
+            schwarzschild_derivs(0.0, y, dydx);
+        }
+        rkck(y, dydx, 0.0, 0.01, yout, yerr, schwarzschild_derivs);
+        sink += yout[1];
+    }
+    double sec = secondsSince(t);
+
+    benchSink = sink;
+    return numSteps / sec;
+}
+
+static double benchRKQS(unsigned int numSteps)
+{
+    double y[Ncoords], dydx[Ncoords], yscal[Ncoords];
+    double x = 0.0, h = 0.01, hdid, hnext;
+    unsigned int ray = 0;
+    bool restart = true;
+
+    auto t = Clock::now();
+    for (unsigned int i = 0; i < numSteps; i++) {
+        if (restart) {
+            schwarzschild_initialize(rInit, PI * (ray % NumRays + 0.5) / NumRays, y);
+            x = 0.0;
+            h = 0.01;
+            ray++;
+        }
+        schwarzschild_derivs(x, y, dydx);
+        for (unsigned int k = 0; k < Ncoords; k++) {
+            yscal[k] = fabs(y[k]) + fabs(dydx[k] * h) + TINY;
+        }
+        rkqs(y, dydx, &x, h, 1e-10, yscal, hdid, hnext, schwarzschild_derivs);
+        h = hnext;
+        restart = schwarzschild_breakCondition(y) || y[1] > 2.0 * rInit;
+    }
+    double sec = secondsSince(t);
+    return numSteps / sec;
+}
+
+static void benchIntegrate(const std::vector<Sample>& samples, double& usPerRay, double& validFraction)
+{
+    unsigned int numValid = 0;
+    double dr, dt, u[2];
+
+    auto t = Clock::now();
+    for (const Sample& s : samples) {
+        double ksi = calcFlatKsi(rInit, s.r, s.phi);
+        numValid += (calcGeodesicUpTo(rInit, ksi, s.r, s.phi, dr, dt, u) ? 1 : 0);
+    }
+    double sec = secondsSince(t);
+
+    usPerRay = sec * 1e6 / samples.size();
+    validFraction = static_cast<double>(numValid) / samples.size();
+}
+
+static void benchFindGeodesic(const std::vector<Sample>& samples, double& usPerCell, double& integrationsPerCell,
+    unsigned int& numFailed, std::vector<unsigned int>& iterHist, std::vector<unsigned int>& randomHist)
+{
+    iterHist.assign(NumIterBins, 0);
+    randomHist.assign(NumRandomBins, 0);
+    numFailed = 0;
+
+    double ksi, dt, derr, u[2];
+    unsigned int cnt;
+    unsigned long numIntegrations = 0;
+
+    auto t = Clock::now();
+    for (const Sample& s : samples) {
+        GeodesicStats stats;
+        if (!findGeodesic(s.order, rInit, s.r, s.phi, ksi, dt, derr, cnt, u, &stats)) {
+            numFailed++;
+        }
+        numIntegrations += stats.integrations;
+        iterHist[std::min(stats.iterations / IterBinWidth, NumIterBins - 1)]++;
+
+        unsigned int bin = 0;
+        for (unsigned int n = stats.randomTries; n > 0 && bin < NumRandomBins - 1; n /= 10) {
+            bin++;
+        }
+        randomHist[bin]++;
+    }
+    double sec = secondsSince(t);
+
+    usPerCell = sec * 1e6 / samples.size();
+    integrationsPerCell = static_cast<double>(numIntegrations) / samples.size();
+}
+
+static std::vector<ScalingResult> benchScaling(unsigned int Nr, unsigned int Nphi, int maxThreads)
+{
+    std::vector<ScalingResult> results;
+    size_t N = Nr * Nphi * 4;
+    std::vector<float> ref_0(N), ref_1(N), lut_0(N), lut_1(N);
+
+    std::vector<int> threadCounts;
+    for (int n = 1; n < maxThreads; n *= 2) {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int numThreads : threadCounts) {
+        bool isRef = results.empty();
+        float* l0 = (isRef ? ref_0.data() : lut_0.data());
+        float* l1 = (isRef ? ref_1.data() : lut_1.data());
+
+        auto t = Clock::now();
+        calcLUT(rInit, rmin, rmax, Nr, Nphi, numThreads, l0, l1, nullptr, nullptr, false);
+        double sec = secondsSince(t);
+
+        bool identical = isRef
+            || (memcmp(ref_0.data(), l0, N * sizeof(float)) == 0 && memcmp(ref_1.data(), l1, N * sizeof(float)) == 0);
+        results.push_back({ numThreads, sec, identical });
+        fprintf(stderr, "calcLUT %ux%u  threads: %2d  %8.3f s  speedup: %5.2f%s\n", Nr, Nphi, numThreads, sec,
+            results[0].seconds / sec, (identical ? "" : "  TABLE DIFFERS"));
+    }
+    return results;
+}
+
+static void writeHist(FILE* fptr, const char* name, const std::vector<unsigned int>& hist, const char* sep)
+{
+    fprintf(fptr, "    \"%s\": [", name);
+    for (size_t i = 0; i < hist.size(); i++) {
+        fprintf(fptr, "%u%s", hist[i], (i + 1 < hist.size() ? ", " : ""));
+    }
+    fprintf(fptr, "]%s\n", sep);
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int numSteps = 200000;
+    unsigned int Nr = 16;
+    unsigned int Nphi = 32;
+    int maxThreads = getMaxThreads();
+    const char* outFilename = "genlookup_bench.json";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            numSteps = static_cast<unsigned int>(std::max(1, atoi(argv[++i])));
+        }
+        else if (strcmp(argv[i], "--lut-size") == 0 && i + 2 < argc) {
+            Nr = static_cast<unsigned int>(std::max(2, atoi(argv[++i])));
+            Nphi = static_cast<unsigned int>(std::max(2, atoi(argv[++i])));
+        }
+        else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
+            maxThreads = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outFilename = argv[++i];
+        }
+        else {
+            fprintf(stderr, "Unknown option '%s'.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::vector<Sample> samples = getSamples();
+
+    double rkckRate = benchRKCK(numSteps);
+    fprintf(stderr, "rkck:          %12.0f steps/s\n", rkckRate);
+
+    double rkqsRate = benchRKQS(numSteps);
+    fprintf(stderr, "rkqs:          %12.0f steps/s\n", rkqsRate);
+
+    double usPerRay, validFraction;
+    benchIntegrate(samples, usPerRay, validFraction);
+    fprintf(stderr, "integrate:     %12.2f us/ray   (%.1f%% valid)\n", usPerRay, validFraction * 100.0);
+
+    double usPerCell, integrationsPerCell;
+    unsigned int numFailed;
+    std::vector<unsigned int> iterHist, randomHist;
+    benchFindGeodesic(samples, usPerCell, integrationsPerCell, numFailed, iterHist, randomHist);
+    fprintf(stderr, "findGeodesic:  %12.2f us/cell  (%.1f rays/cell, %u failed)\n", usPerCell, integrationsPerCell,
+        numFailed);
+
+    std::vector<ScalingResult> scaling = benchScaling(Nr, Nphi, maxThreads);
+
+    FILE* fptr = fopen(outFilename, "w");
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot open file '%s' for writing.\n", outFilename);
+        return 1;
+    }
+
+    fprintf(fptr, "{\n");
+    fprintf(fptr, "  \"samples\": %u,\n", static_cast<unsigned int>(samples.size()));
+    fprintf(fptr, "  \"rkck_steps_per_s\": %.0f,\n", rkckRate);
+    fprintf(fptr, "  \"rkqs_steps_per_s\": %.0f,\n", rkqsRate);
+    fprintf(fptr, "  \"integrate\": {\"us_per_ray\": %.3f, \"valid_fraction\": %.4f},\n", usPerRay, validFraction);
+    fprintf(fptr, "  \"findGeodesic\": {\n");
+    fprintf(fptr, "    \"us_per_cell\": %.3f,\n", usPerCell);
+    fprintf(fptr, "    \"integrations_per_cell\": %.2f,\n", integrationsPerCell);
+    fprintf(fptr, "    \"failed\": %u,\n", numFailed);
+    fprintf(fptr, "    \"iteration_bin_width\": %u,\n", IterBinWidth);
+    writeHist(fptr, "iteration_hist", iterHist, ",");
+    fprintf(fptr, "    \"random_tries_bins\": [\"0\", \"1-9\", \"10-99\", \"100-999\", \">=1000\"],\n");
+    writeHist(fptr, "random_tries_hist", randomHist, "");
+    fprintf(fptr, "  },\n");
+    fprintf(fptr, "  \"calcLUT\": {\"Nr\": %u, \"Nphi\": %u, \"runs\": [\n", Nr, Nphi);
+    for (size_t i = 0; i < scaling.size(); i++) {
+        const ScalingResult& s = scaling[i];
+        fprintf(fptr, "    {\"threads\": %d, \"seconds\": %.4f, \"speedup\": %.3f, \"identical\": %s}%s\n",
+            s.numThreads, s.seconds, scaling[0].seconds / s.seconds, (s.identical ? "true" : "false"),
+            (i + 1 < scaling.size() ? "," : ""));
+    }
+    fprintf(fptr, "  ]}\n}\n");
+    fclose(fptr);
+
+    fprintf(stderr, "Results written to '%s'.\n", outFilename);
+    return 0;
+}
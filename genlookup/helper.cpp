@@ -64,4 +64,26 @@ void calcCoords(const double* e1, const double* e2, double ksi, double dist, dou
 void calcPerspectiveProjection(const double* p, double &cx, double &cy) {
     cx = p[1] / (-p[0]) * 40;
     cy = p[2] / (-p[0]) * 40;
-}
\ No newline at end of file
+}
+
+void calcBaseCompCos(const double* e1, const double* p, double* e2, double &r, double &cosPhi) {
+    double x = dotProd(p, e1);
+    r = sqrt(dotProd(p, p));
+    cosPhi = x / r;
+
+    e2[0] = p[0] - x * e1[0];
+    e2[1] = p[1] - x * e1[1];
+    e2[2] = p[2] - x * e1[2];
+    double y = sqrt(dotProd(e2, e2));
+    if (y > 0.0) {
+        e2[0] /= y;
+        e2[1] /= y;
+        e2[2] /= y;
+    }
+}
+
+void calcCoordsXY(const double* e1, const double* e2, double dx, double dy, double* q) {
+    q[0] = dx * e1[0] + dy * e2[0];
+    q[1] = dx * e1[1] + dy * e2[1];
+    q[2] = dx * e1[2] + dy * e2[2];
+}
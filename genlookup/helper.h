@@ -16,3 +16,8 @@ void calcBaseComp(const double* e1, const double* e2, const double* p, double &r
 void calcCoords(const double* e1, const double* e2, double ksi, double dist, double* q);
 
 void calcPerspectiveProjection(const double* p, double &cx, double &cy);
+
+// cos(phi) layout: base component and position from (dist cos(ksi), dist sin(ksi)), without atan, sin, or cos
+void calcBaseCompCos(const double* e1, const double* p, double* e2, double &r, double &cosPhi);
+
+void calcCoordsXY(const double* e1, const double* e2, double dx, double dy, double* q);
@@ -0,0 +1,194 @@
+/**
+ * File:   lutfit.cpp
+ * Author: Thomas Mueller, HdA/MPIA
+ */
+#include "lutfit.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "helper.h"
+#include "lutgen.h"
+
+/**
+ *  Index of the first coefficient of a band.
+ */
+static size_t bandOffset(const LUTFit& fit, int order, unsigned int band)
+{
+    size_t numCoeffs = static_cast<size_t>(fit.degX + 1) * (fit.degPhi + 1) * 4;
+    return (static_cast<size_t>(order) * fit.numBands + band) * numCoeffs;
+}
+
+/**
+ *  Evaluate sum_i c[i] T_i(t) for i = 0..deg via Clenshaw recurrence.
+ */
+static double clenshaw(const double* c, unsigned int deg, double t)
+{
+    double b1 = 0.0, b2 = 0.0;
+    for (unsigned int i = deg; i >= 1; i--) {
+        double b = c[i] + 2.0 * t * b1 - b2;
+        b2 = b1;
+        b1 = b;
+    }
+    return c[0] + t * b1 - b2;
+}
+
+void calcLUTFit(double rInit, double rmin, double rmax, int numThreads, LUTFit& fit)
+{
+    fit.xmin = rs / rmax;
+    fit.xmax = rs / rmin;
+    fit.phimin = PhiEps;
+    fit.phimax = PI - PhiEps;
+
+    const unsigned int nx = fit.degX + 1;
+    const unsigned int np = fit.degPhi + 1;
+    fit.coeffs.assign(bandOffset(fit, 2, 0), 0.0f);
+
+    double bandWidth = (fit.xmax - fit.xmin) / fit.numBands;
+    if (numThreads <= 0) {
+        numThreads = getMaxThreads();
+    }
+
+    int N = static_cast<int>(2 * fit.numBands);
+#ifdef HAVE_OPENMP_AVAIL
+    #pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+#endif
+    for (int n = 0; n < N; n++) {
+        int order = n / static_cast<int>(fit.numBands);
+        unsigned int band = static_cast<unsigned int>(n) % fit.numBands;
+        double xa = fit.xmin + band * bandWidth;
+
+        // entries at the Chebyshev nodes
+        std::vector<double> values(nx * np * 4);
+        bool isValid = true;
+        for (unsigned int i = 0; i < nx && isValid; i++) {
+            double u = cos(PI * (i + 0.5) / nx);
+            double x = xa + 0.5 * (u + 1.0) * bandWidth;
+            for (unsigned int j = 0; j < np && isValid; j++) {
+                double v = cos(PI * (j + 0.5) / np);
+                double phi = fit.phimin + 0.5 * (v + 1.0) * (fit.phimax - fit.phimin);
+                float entry[4];
+                isValid = calcLUTEntry(order, rInit, x, phi, entry);
+                for (int k = 0; k < 4; k++) {
+                    values[(i * np + j) * 4 + k] = entry[k];
+                }
+            }
+        }
+
+        float* c = &fit.coeffs[bandOffset(fit, order, band)];
+        if (!isValid) {
+            c[1] = -1.0f;
+            continue;
+        }
+
+        // discrete Chebyshev transform, the constant terms are halved
+        for (unsigned int p = 0; p < nx; p++) {
+            for (unsigned int q = 0; q < np; q++) {
+                double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+                for (unsigned int i = 0; i < nx; i++) {
+                    double tp = cos(PI * p * (i + 0.5) / nx);
+                    for (unsigned int j = 0; j < np; j++) {
+                        double w = tp * cos(PI * q * (j + 0.5) / np);
+                        for (int k = 0; k < 4; k++) {
+                            sum[k] += w * values[(i * np + j) * 4 + k];
+                        }
+                    }
+                }
+
+                double scale = (2.0 / nx) * (2.0 / np) * (p == 0 ? 0.5 : 1.0) * (q == 0 ? 0.5 : 1.0);
+                for (int k = 0; k < 4; k++) {
+                    c[(p * np + q) * 4 + k] = static_cast<float>(scale * sum[k]);
+                }
+            }
+        }
+    }
+}
+
+bool evalLUTFit(const LUTFit& fit, int order, double x, double phi, double* entry)
+{
+    double bx = (x - fit.xmin) / (fit.xmax - fit.xmin) * fit.numBands;
+    bx = std::fmin(std::fmax(bx, 0.0), static_cast<double>(fit.numBands));
+    unsigned int band = std::min(static_cast<unsigned int>(bx), fit.numBands - 1);
+    double u = 2.0 * (bx - band) - 1.0;
+    double v = 2.0 * (phi - fit.phimin) / (fit.phimax - fit.phimin) - 1.0;
+    v = std::fmin(std::fmax(v, -1.0), 1.0);
+
+    const float* c = &fit.coeffs[bandOffset(fit, order, band)];
+    if (c[1] < 0.0f) {
+        return false;
+    }
+
+    const unsigned int nx = fit.degX + 1;
+    const unsigned int np = fit.degPhi + 1;
+    std::vector<double> row(np), col(nx);
+    for (int k = 0; k < 4; k++) {
+        for (unsigned int i = 0; i < nx; i++) {
+            for (unsigned int j = 0; j < np; j++) {
+                row[j] = c[(i * np + j) * 4 + k];
+            }
+            col[i] = clenshaw(row.data(), fit.degPhi, v);
+        }
+        entry[k] = clenshaw(col.data(), fit.degX, u);
+    }
+    return true;
+}
+
+void reportLUTFitError(const LUTFit& fit, unsigned int Nr, unsigned int Nphi, const float* lut_0, const float* lut_1)
+{
+    double xStep = (fit.xmax - fit.xmin) / (Nr - 1);
+    double phiStep = (fit.phimax - fit.phimin) / (Nphi - 1);
+    const char* names[] = { "ksi", "dt", "ux", "uy" };
+
+    fprintf(stderr, "Chebyshev fit: %u bands, degree %u x %u, %zu coefficients\n", fit.numBands, fit.degX,
+        fit.degPhi, fit.coeffs.size());
+
+    for (int order = 0; order < 2; order++) {
+        const float* lut = (order == 0 ? lut_0 : lut_1);
+        double maxErr[4] = { 0.0, 0.0, 0.0, 0.0 };
+        double sumErr2[4] = { 0.0, 0.0, 0.0, 0.0 };
+        unsigned int numCompared = 0, numSkipped = 0;
+
+        for (unsigned int ir = 0; ir < Nr; ir++) {
+            for (unsigned int ip = 0; ip < Nphi; ip++) {
+                const float* ref = &lut[4 * (ir * Nphi + ip)];
+                double entry[4];
+                if (ref[1] < 0.0f || !evalLUTFit(fit, order, fit.xmin + ir * xStep, fit.phimin + ip * phiStep, entry)) {
+                    numSkipped++;
+                    continue;
+                }
+
+                for (int k = 0; k < 4; k++) {
+                    double err = fabs(entry[k] - ref[k]);
+                    maxErr[k] = std::fmax(maxErr[k], err);
+                    sumErr2[k] += err * err;
+                }
+                numCompared++;
+            }
+        }
+
+        fprintf(stderr, "  order %d: %u entries compared, %u skipped (invalid)\n", order, numCompared, numSkipped);
+        for (int k = 0; k < 4 && numCompared > 0; k++) {
+            fprintf(stderr, "    %-4s  max: %.3e  rms: %.3e\n", names[k], maxErr[k], sqrt(sumErr2[k] / numCompared));
+        }
+    }
+}
+
+bool saveLUTFit(const LUTFit& fit, const char* filename)
+{
+    FILE* fptr = fopen(filename, "wb");
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot open file \"%s\" for output.\n", filename);
+        return false;
+    }
+
+    float range[4] = { static_cast<float>(fit.xmin), static_cast<float>(fit.xmax), static_cast<float>(fit.phimin),
+        static_cast<float>(fit.phimax) };
+    fwrite(&fit.numBands, sizeof(unsigned int), 1, fptr);
+    fwrite(&fit.degX, sizeof(unsigned int), 1, fptr);
+    fwrite(&fit.degPhi, sizeof(unsigned int), 1, fptr);
+    fwrite(range, sizeof(float), 4, fptr);
+    fwrite(fit.coeffs.data(), sizeof(float), fit.coeffs.size(), fptr);
+    fclose(fptr);
+    return true;
+}
@@ -0,0 +1,71 @@
+/**
+ * File:   lutfit.h
+ * Author: Thomas Mueller, HdA/MPIA
+ *
+ *  Piecewise Chebyshev approximation of the lookup table. The radial range
+ *  is split into bands of equal width in x = rs/r. Within each band, every
+ *  entry (ksi, dt, ux, uy) is approximated by a tensor-product Chebyshev
+ *  series in x and phi, whose coefficients are calculated from geodesics
+ *  at the Chebyshev nodes. Used by GenLookupTable.
+ */
+#ifndef LUTFIT_H
+#define LUTFIT_H
+
+#include <vector>
+
+struct LUTFit
+{
+    unsigned int numBands; //!< Number of radial bands.
+    unsigned int degX;     //!< Polynomial degree in x per band.
+    unsigned int degPhi;   //!< Polynomial degree in phi.
+    double xmin;
+    double xmax;
+    double phimin;
+    double phimax;
+
+    /**
+     * Coefficients (ksi, dt, ux, uy) ordered by [order][band][ix][iphi].
+     * Bands with invalid entries have vanishing coefficients, except for
+     * dt of the constant term, which is set to -1.
+     */
+    std::vector<float> coeffs;
+};
+
+/**
+ * Calculate Chebyshev coefficients.
+ * @param rInit       Observer distance.
+ * @param rmin        Minimum radius.
+ * @param rmax        Maximum radius.
+ * @param numThreads  Number of OpenMP threads (0 = all available).
+ * @param fit         Fit with numBands, degX, and degPhi set.
+ */
+void calcLUTFit(double rInit, double rmin, double rmax, int numThreads, LUTFit& fit);
+
+/**
+ * Evaluate fit.
+ * @param fit    Chebyshev fit.
+ * @param order  Image order (0 or 1).
+ * @param x      Scaled radius rs/r.
+ * @param phi    Azimuth angle (order 0 convention).
+ * @param entry  Lookup table entry (ksi, dt, ux, uy).
+ * @return false if the fit has no valid approximation at (x, phi).
+ */
+bool evalLUTFit(const LUTFit& fit, int order, double x, double phi, double* entry);
+
+/**
+ * Print error of the fit with respect to the valid lookup table entries.
+ */
+void reportLUTFitError(const LUTFit& fit, unsigned int Nr, unsigned int Nphi, const float* lut_0, const float* lut_1);
+
+/**
+ * Write fit to file.
+ *   The output file has a 28 byte header of the form
+ *      numBands (unsigned int)
+ *      degX     (unsigned int)
+ *      degPhi   (unsigned int)
+ *      xmin, xmax, phimin, phimax (float)
+ *   followed by the coefficients (float array).
+ */
+bool saveLUTFit(const LUTFit& fit, const char* filename);
+
+#endif // LUTFIT_H
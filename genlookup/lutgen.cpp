@@ -0,0 +1,385 @@
+/**
+ * File:   lutgen.cpp
+ * Author: Thomas Mueller, HdA/MPIA
+ */
+#include "lutgen.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+
+#ifdef HAVE_OPENMP_AVAIL
+#include <omp.h>
+#endif // HAVE_OPENMP_AVAIL
+
+#include "lutfit.h"
+#include "nrRungeKutta.h"
+#include "schwarzschild.h"
+#include "helper.h"
+
+constexpr double HitRadiusSphere = 1e-5;
+constexpr double ksi_eps = 1e-9;
+
+
+constexpr unsigned int MaxNumSteps = 10000;
+constexpr double eps_abs = 1e-10;
+
+// offset for finite-difference derivatives, in units of the sample step
+constexpr double DerivStep = 0.1;
+
+bool calcGeodesicUpTo(double rInit, double ksi, double rFinal, double phiFinal, double& dr, double& dt, double* u)
+{
+    dr = 1e12;
+    dt = 1e12;
+
+    double y[Ncoords];
+    double ymax[] = { 1e10, rFinal, phiFinal, 0.0, 0.0, 0.0 };
+    schwarzschild_initialize(rInit, ksi, y);
+
+    bool isValid = integrate(y, ymax, MaxNumSteps, eps_abs, 0.01, 1e-8, schwarzschild_derivs,
+        schwarzschild_breakCondition, schwarzschild_found);
+
+    if (isValid) {
+        dr = y[1] - rFinal;
+        dt = y[0];
+
+        double r = y[1];
+        double phi = y[2];
+        double ur = y[4];
+        double up = y[5];
+        u[0] = ur * cos(phi) - up * r * sin(phi);
+        u[1] = ur * sin(phi) + up * r * cos(phi);
+    }
+
+    return isValid;
+}
+
+double calcFlatKsi(double rInit, double rFinal, double phiFinal)
+{
+    double d2 = rInit * rInit + rFinal * rFinal - 2.0 * rInit * rFinal * cos(phiFinal);
+    double d = sqrt(d2);
+    return asin(rInit / d * sin(phiFinal));
+}
+
+/**
+ *  Seed for the random restarts of one geodesic search.
+ */
+static std::seed_seq::result_type cellSeed(int order, double rFinal, double phiFinal)
+{
+    uint64_t br, bp;
+    memcpy(&br, &rFinal, sizeof(br));
+    memcpy(&bp, &phiFinal, sizeof(bp));
+    uint64_t h = br * 0x9E3779B97F4A7C15ull ^ (bp + 0x632BE59BD9B4E019ull + (br << 6) + (br >> 2));
+    h ^= static_cast<uint64_t>(order) << 63;
+    return static_cast<std::seed_seq::result_type>(h ^ (h >> 32));
+}
+
+bool findGeodesic(int order, double rInit, double rFinal, double phiFinal, double& ksi, double& dt, double& derr,
+    unsigned int& cnt, double* u, GeodesicStats* stats)
+{
+    double ksiCrit = schwarzschild_ksiCrit(rInit);
+
+    double ksiA = (order == 0 ? 0.0 : PI / 2);
+    double ksiB = (order == 0 ? PI : PI - ksiCrit);
+    double ksiC = 0.0;
+
+    double uA[2], uB[2], uC[2] = { 0.0, 0.0 };
+    double drA, drB, drC = 1e12;
+    double dtA, dtB, dtC = 1e12;
+    bool validA = calcGeodesicUpTo(rInit, ksiA, rFinal, phiFinal, drA, dtA, uA);
+    bool validB = calcGeodesicUpTo(rInit, ksiB, rFinal, phiFinal, drB, dtB, uB);
+    unsigned int numIntegrations = 2;
+
+    if (!validA) {
+        drA = 1e10;
+    }
+
+    if (!validB) {
+        drB = -1e10;
+    }
+
+    // The generator is only needed if a geodesic fails; its seed depends on
+    // the cell only, so that the table is reproducible for any thread count.
+    std::mt19937 gen;
+    bool genSeeded = false;
+    std::uniform_real_distribution<> dis(0, 1);
+
+    double eps_radius = HitRadiusSphere;
+    unsigned int count = 0;
+    unsigned int randomCount = 0;
+    unsigned int numRandomTries = 0;
+
+    while ((fabs(drA - drB) > eps_radius) && fabs(ksiA - ksiB) > ksi_eps && count < MaxTries) {
+        ksiC = (ksiA + ksiB) * 0.5;
+
+        if (count == 0) {
+            ksiC = calcFlatKsi(rInit, rFinal, phiFinal);
+        }
+
+        bool validC = false;
+        randomCount = 0;
+        while (!validC && randomCount < MaxRandomTries) {
+            validC = calcGeodesicUpTo(rInit, ksiC, rFinal, phiFinal, drC, dtC, uC);
+            numIntegrations++;
+            if (!validC) {
+                if (!genSeeded) {
+                    gen.seed(cellSeed(order, rFinal, phiFinal));
+                    genSeeded = true;
+                }
+                double t = dis(gen);
+                ksiC = ksiA * (1.0 - t) + t * ksiB;
+                randomCount++;
+            }
+        }
+        numRandomTries += randomCount;
+
+        if (fabs(drC) < 1e-15 && validC) {
+            break;
+        }
+
+        if (drC * drA < 0.0) {
+            ksiB = ksiC;
+            drB = drC;
+            dtB = dtC;
+        }
+        else {
+            ksiA = ksiC;
+            drA = drC;
+            dtA = dtC;
+        }
+
+        count++;
+    }
+
+    ksi = ksiC;
+    dt = dtC;
+    derr = drC;
+    cnt = count;
+    u[0] = uC[0];
+    u[1] = uC[1];
+
+    if (stats != nullptr) {
+        stats->iterations = count;
+        stats->randomTries = numRandomTries;
+        stats->integrations = numIntegrations;
+    }
+    return count < MaxTries;
+}
+
+/**
+ *  Store geodesic search result in lookup table entry.
+ */
+static void setEntry(float* entry, bool isValid, double ksi, double dt, const double* u)
+{
+    entry[0] = static_cast<float>(ksi);
+    entry[1] = (isValid ? static_cast<float>(fabs(dt)) : -1.0f);
+    entry[2] = static_cast<float>(u[0]);
+    entry[3] = static_cast<float>(u[1]);
+}
+
+bool calcLUTEntry(int order, double rInit, double x, double phi, float* entry)
+{
+    double ksi, dt, derr, u[2];
+    unsigned int cnt;
+    double phiFinal = (order == 0 ? phi : 2.0 * PI - phi);
+    bool isValid = findGeodesic(order, rInit, rs / x, phiFinal, ksi, dt, derr, cnt, u);
+    setEntry(entry, isValid, ksi, dt, u);
+    return isValid && entry[1] >= 0.0f;
+}
+
+/**
+ *  Derivative of a lookup table entry with respect to the sample index along
+ *  (dx, dphi), which is one sample step. Central differences are used with
+ *  a fraction of the sample step; at the table border or next to invalid
+ *  entries, one-sided differences are used.
+ */
+static void calcDerivative(int order, double rInit, double x, double phi, double dx, double dphi, bool hasPrev,
+    bool hasNext, const float* center, float* deriv)
+{
+    float prev[4], next[4];
+    hasNext = hasNext && calcLUTEntry(order, rInit, x + DerivStep * dx, phi + DerivStep * dphi, next);
+    hasPrev = hasPrev && calcLUTEntry(order, rInit, x - DerivStep * dx, phi - DerivStep * dphi, prev);
+
+    for (int k = 0; k < 4; k++) {
+        double d = 0.0;
+        if (hasPrev && hasNext) {
+            d = (next[k] - prev[k]) / (2.0 * DerivStep);
+        }
+        else if (hasNext) {
+            d = (next[k] - center[k]) / DerivStep;
+        }
+        else if (hasPrev) {
+            d = (center[k] - prev[k]) / DerivStep;
+        }
+        deriv[k] = static_cast<float>(d);
+    }
+}
+
+/**
+ *  Convert entry (ksi, dt, ux, uy) into the cos(phi) layout.
+ */
+static void toCosPhiLayout(float* entry, bool isValid)
+{
+    double ksi = entry[0];
+    double dt = entry[1];
+    entry[0] = (isValid ? static_cast<float>(dt * cos(ksi)) : 0.0f);
+    entry[1] = (isValid ? static_cast<float>(dt * sin(ksi)) : -1.0f);
+}
+
+void calcLUT(double rInit, double rmin, double rmax, unsigned int Nr, unsigned int Nphi, int numThreads,
+    float* lut_0, float* lut_1, float* deriv_0, float* deriv_1, bool verbose, LUTLayout layout)
+{
+    double xmin = rs / rmax;
+    double xmax = rs / rmin;
+    double xStep = (xmax - xmin) / (Nr - 1);
+
+    double phimin = PhiEps;
+    double phimax = PI - PhiEps;
+    double phiStep = (phimax - phimin) / (Nphi - 1);
+
+    // cos(phi) layout: increasing sample index still means increasing phi
+    double cosPhiMax = cos(phimin);
+    double cosPhiStep = (cosPhiMax - cos(phimax)) / (Nphi - 1);
+
+    int N = static_cast<int>(Nr * Nphi);
+    if (numThreads <= 0) {
+        numThreads = getMaxThreads();
+    }
+    int NperThread = N / numThreads;
+    bool withDerivatives = (deriv_0 != nullptr && deriv_1 != nullptr && layout == LUTLayout::Phi);
+
+    // All per-cell state is declared inside the loop and therefore private
+    // to each thread.
+#ifdef HAVE_OPENMP_AVAIL
+    #pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+#endif
+    for (int n = 0; n < N; n++) {
+        int ir = n / static_cast<int>(Nphi);
+        int ip = n % static_cast<int>(Nphi);
+
+#ifdef HAVE_OPENMP_AVAIL
+        if (verbose && omp_get_thread_num() == 0) {
+            fprintf(stderr, "#: %4d/%4d\r", n, NperThread);
+        }
+#else
+        if (verbose) {
+            fprintf(stderr, "#: %4d/%4d\r", n, NperThread);
+        }
+#endif
+
+        double x = xmin + ir * xStep;
+        double phi = phimin + ip * phiStep;
+        if (layout == LUTLayout::CosPhi) {
+            phi = acos(cosPhiMax - ip * cosPhiStep);
+        }
+
+        float* lut[2] = { &lut_0[4 * n], &lut_1[4 * n] };
+        float* deriv[2] = { deriv_0, deriv_1 };
+        for (int order = 0; order < 2; order++) {
+            bool isValid = calcLUTEntry(order, rInit, x, phi, lut[order]);
+            if (layout == LUTLayout::CosPhi) {
+                toCosPhiLayout(lut[order], isValid);
+            }
+            if (!withDerivatives) {
+                continue;
+            }
+
+            // layer 0: derivative along azimuth samples, layer 1: along radial samples
+            float* dPhi = &deriv[order][4 * n];
+            float* dX = &deriv[order][4 * (N + n)];
+            if (isValid) {
+                calcDerivative(order, rInit, x, phi, 0.0, phiStep, ip > 0, ip + 1 < static_cast<int>(Nphi),
+                    lut[order], dPhi);
+                calcDerivative(order, rInit, x, phi, xStep, 0.0, ir > 0, ir + 1 < static_cast<int>(Nr), lut[order],
+                    dX);
+            }
+            else {
+                memset(dPhi, 0, 4 * sizeof(float));
+                memset(dX, 0, 4 * sizeof(float));
+            }
+        }
+    }
+}
+
+bool genLUT(double rInit, double rmin, double rmax, unsigned int Nr, unsigned int Nphi, const char* filename,
+    int numThreads, bool withDerivatives, LUTFit* fit, LUTLayout layout)
+{
+    if (layout != LUTLayout::Phi && (withDerivatives || fit != nullptr)) {
+        fprintf(stderr, "Derivatives and fit need the phi layout, both are skipped.\n");
+        withDerivatives = false;
+        fit = nullptr;
+    }
+
+    fprintf(stderr, "Gen LUT for rInit = %f, range=[%f,%f], Nr=%u, Nphi=%u%s%s\n", rInit, rmin, rmax, Nr, Nphi,
+        (withDerivatives ? ", with derivatives" : ""), (layout == LUTLayout::CosPhi ? ", cos(phi) layout" : ""));
+
+    float* lut_0 = new float[Nr * Nphi * 4];
+    float* lut_1 = new float[Nr * Nphi * 4];
+    float* deriv_0 = (withDerivatives ? new float[Nr * Nphi * 8] : nullptr);
+    float* deriv_1 = (withDerivatives ? new float[Nr * Nphi * 8] : nullptr);
+
+    auto t1 = std::chrono::steady_clock::now();
+    calcLUT(rInit, rmin, rmax, Nr, Nphi, numThreads, lut_0, lut_1, deriv_0, deriv_1, true, layout);
+    auto t2 = std::chrono::steady_clock::now();
+    double dt_calc = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count());
+    fprintf(stderr, "\ncalc: %f s\n", dt_calc * 1e-3);
+
+    bool ok = false;
+    FILE* fptr = fopen(filename, "wb");
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot open file \"%s\" for output.\n", filename);
+    }
+    else {
+        float fmin = static_cast<float>(rmin);
+        float fmax = static_cast<float>(rmax);
+        float fdist = static_cast<float>(rInit);
+        if (layout != LUTLayout::Phi) {
+            unsigned int ext[2] = { LUTMagic, static_cast<unsigned int>(layout) };
+            fwrite(ext, sizeof(unsigned int), 2, fptr);
+        }
+        fwrite(&Nr, sizeof(unsigned int), 1, fptr);
+        fwrite(&Nphi, sizeof(unsigned int), 1, fptr);
+        fwrite(&fmin, sizeof(float), 1, fptr);
+        fwrite(&fmax, sizeof(float), 1, fptr);
+        fwrite(&fdist, sizeof(float), 1, fptr);
+        fwrite(lut_0, sizeof(float), Nr * Nphi * 4, fptr);
+        fwrite(lut_1, sizeof(float), Nr * Nphi * 4, fptr);
+        if (withDerivatives) {
+            fwrite(deriv_0, sizeof(float), Nr * Nphi * 8, fptr);
+            fwrite(deriv_1, sizeof(float), Nr * Nphi * 8, fptr);
+        }
+        fclose(fptr);
+        ok = true;
+    }
+
+    if (ok && fit != nullptr) {
+        t1 = std::chrono::steady_clock::now();
+        calcLUTFit(rInit, rmin, rmax, numThreads, *fit);
+        t2 = std::chrono::steady_clock::now();
+        dt_calc = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count());
+        fprintf(stderr, "fit: %f s\n", dt_calc * 1e-3);
+        reportLUTFitError(*fit, Nr, Nphi, lut_0, lut_1);
+
+        std::string fitFilename = filename;
+        size_t pos = fitFilename.rfind(".dat");
+        fitFilename = fitFilename.substr(0, pos) + "_fit.dat";
+        ok = saveLUTFit(*fit, fitFilename.c_str());
+    }
+
+    delete[] deriv_1;
+    delete[] deriv_0;
+    delete[] lut_1;
+    delete[] lut_0;
+    return ok;
+}
+
+int getMaxThreads()
+{
+#ifdef HAVE_OPENMP_AVAIL
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
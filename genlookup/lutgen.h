@@ -0,0 +1,135 @@
+/**
+ * File:   lutgen.h
+ * Author: Thomas Mueller, HdA/MPIA
+ *
+ *  Geodesic search and lookup table generation. Used by GenLookupTable
+ *  and GenLookupBench.
+ */
+#ifndef LUTGEN_H
+#define LUTGEN_H
+
+struct LUTFit;
+
+// number of coordinates (3-pos, 3-vel)
+constexpr unsigned int Ncoords = 6;
+
+constexpr unsigned int MaxRandomTries = 3000;
+constexpr unsigned int MaxTries = 200;
+
+// Schwarzschild radius
+constexpr double rs = 2.0;
+
+// azimuth samples cover [PhiEps, pi - PhiEps]
+constexpr double PhiEps = 1e-4;
+
+// magic number of lookup table files with extended header
+constexpr unsigned int LUTMagic = 0x3154554C; // "LUT1"
+
+/**
+ *  Lookup table layout.
+ *    Phi:     samples uniform in phi, entries (ksi, dt, ux, uy).
+ *    CosPhi:  samples uniform in cos(phi), entries (dt cos(ksi), dt sin(ksi), ux, uy).
+ *             Invalid entries have a negative second component.
+ */
+enum class LUTLayout : unsigned int { Phi = 0, CosPhi = 1 };
+
+/**
+ *  Statistics of a single geodesic search.
+ */
+struct GeodesicStats
+{
+    unsigned int iterations; //!< Number of bisection steps.
+    unsigned int randomTries; //!< Number of random restarts for invalid geodesics.
+    unsigned int integrations; //!< Number of integrated geodesics.
+};
+
+/**
+ * Calculate geodesic up to final point
+ * @param rInit      Initial radial position.
+ * @param ksi        Initial direction.
+ * @param rFinal     Final radial position.
+ * @param phiFinal   Final azimuth angle.
+ * @param dr         Radial distance to final point.
+ * @param dt         Light travel time.
+ * @param u          Direction of light at final point (2-array).
+ */
+bool calcGeodesicUpTo(double rInit, double ksi, double rFinal, double phiFinal, double& dr, double& dt, double* u);
+
+/**
+ *  Calculate initial angle for flat spacetime
+ */
+double calcFlatKsi(double rInit, double rFinal, double phiFinal);
+
+/**
+ * Find geodesic between initial position and final point.
+ *   Random restarts use a generator seeded by the final point, so the
+ *   result does not depend on the thread or the order of evaluation.
+ * @param order      Image order (0 or 1).
+ * @param rInit      Initial radial position (point p)
+ * @param rFinal     Final radial position (point q)
+ * @param phiFinal   Final azimuth angle (point q)
+ * @param ksi        Initial direction
+ * @param dt         Light travel time
+ * @param derr       Remaining radial distance to final point.
+ * @param cnt        Number of bisection steps.
+ * @param u          Direction of light at final point (2-array)
+ * @param stats      Optional search statistics.
+ */
+bool findGeodesic(int order, double rInit, double rFinal, double phiFinal, double& ksi, double& dt, double& derr,
+    unsigned int& cnt, double* u, GeodesicStats* stats = nullptr);
+
+/**
+ * Calculate single lookup table entry (ksi, dt, ux, uy).
+ * @param order   Image order (0 or 1).
+ * @param rInit   Observer distance.
+ * @param x       Scaled radius rs/r.
+ * @param phi     Azimuth angle in [0, pi]; order 1 uses 2pi - phi.
+ * @param entry   Lookup table entry, dt is -1 if there is no geodesic.
+ * @return true if a geodesic was found.
+ */
+bool calcLUTEntry(int order, double rInit, double x, double phi, float* entry);
+
+/**
+ * Calculate lookup table data.
+ *   The optional derivatives are given per sample step, first along the
+ *   azimuth samples (Nr * Nphi * 4 floats), then along the radial samples
+ *   (Nr * Nphi * 4 floats). They are used for cubic Hermite interpolation.
+ * @param rInit       Observer distance.
+ * @param rmin        Minimum radius.
+ * @param rmax        Maximum radius.
+ * @param Nr          Number of radial samples.
+ * @param Nphi        Number of azimuth samples.
+ * @param numThreads  Number of OpenMP threads (0 = all available).
+ * @param lut_0       Data for image order 0 (Nr * Nphi * 4 floats).
+ * @param lut_1       Data for image order 1 (Nr * Nphi * 4 floats).
+ * @param deriv_0     Derivatives for image order 0 (Nr * Nphi * 8 floats), or nullptr.
+ * @param deriv_1     Derivatives for image order 1 (Nr * Nphi * 8 floats), or nullptr.
+ * @param verbose     Show progress.
+ * @param layout      Table layout; derivatives are only available for LUTLayout::Phi.
+ */
+void calcLUT(double rInit, double rmin, double rmax, unsigned int Nr, unsigned int Nphi, int numThreads,
+    float* lut_0, float* lut_1, float* deriv_0 = nullptr, float* deriv_1 = nullptr, bool verbose = true,
+    LUTLayout layout = LUTLayout::Phi);
+
+/**
+ * Generate lookup table and write it to file.
+ * @param rInit       Observer distance.
+ * @param rmin        Minimum radius.
+ * @param rmax        Maximum radius.
+ * @param Nr          Number of radial samples.
+ * @param Nphi        Number of azimuth samples.
+ * @param filename    Output file name.
+ * @param numThreads  Number of OpenMP threads (0 = all available).
+ * @param withDerivatives  Append derivatives for cubic Hermite interpolation.
+ * @param fit         Optional Chebyshev fit (numBands, degX, degPhi set). It is
+ *                    compared against the table and written to '<filename>_fit.dat'.
+ * @param layout      Table layout. Tables with LUTLayout::CosPhi are written with
+ *                    an extended header and have neither derivatives nor fit.
+ */
+bool genLUT(double rInit, double rmin, double rmax, unsigned int Nr, unsigned int Nphi, const char* filename,
+    int numThreads = 0, bool withDerivatives = false, LUTFit* fit = nullptr, LUTLayout layout = LUTLayout::Phi);
+
+/// Maximum number of threads that can be used by calcLUT.
+int getMaxThreads();
+
+#endif // LUTGEN_H
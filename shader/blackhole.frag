@@ -0,0 +1,42 @@
+#version 330
+
+uniform mat4 projMX;
+uniform mat4 viewMX;
+uniform vec3 camPos;
+uniform vec4 m_color;
+uniform float flatShading;
+
+// cosine of the shadow's angular radius
+uniform float cosShadow;
+
+// sphere at the black hole's position with the same silhouette
+uniform float radius;
+
+in vec4 vRayPoint;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    vec3 dir = normalize(vRayPoint.xyz / vRayPoint.w - camPos);
+    if (dot(dir, normalize(-camPos)) < cosShadow) {
+        discard;
+    }
+
+    // Depth and normal of the sphere; a shadow wider than half the sky
+    // is placed at the distance of the black hole.
+    float b = dot(camPos, dir);
+    float disc = b * b - dot(camPos, camPos) + radius * radius;
+    float t = length(camPos);
+    vec3 normal = -dir;
+    if (disc >= 0.0 && -b - sqrt(disc) > 0.0) {
+        t = -b - sqrt(disc);
+        normal = (camPos + t * dir) / radius;
+    }
+
+    vec4 clipPos = projMX * viewMX * vec4(camPos + t * dir, 1.0);
+    gl_FragDepth = 0.5 * clipPos.z / clipPos.w + 0.5;
+
+    float val = max(0.0, dot(-dir, normal));
+    val = mix(pow(val, 0.7), 1.0, flatShading);
+    fragColor = m_color * vec4(vec3(val), 1.0);
+}
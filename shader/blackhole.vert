@@ -0,0 +1,30 @@
+#version 330
+
+uniform mat4 projMX;
+uniform mat4 viewMX;
+uniform mat4 invViewProjMX;
+uniform vec3 camPos;
+
+// half size of the quad around the shadow, 0: whole screen
+uniform float quadSize;
+
+// point on the view ray (homogeneous world coordinates)
+out vec4 vRayPoint;
+
+const vec2 corners[4] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(-1.0, 1.0), vec2(1.0, 1.0));
+
+void main() {
+    vec2 c = corners[gl_VertexID];
+    if (quadSize > 0.0) {
+        // the quad is perpendicular to the direction to the black hole
+        vec3 w = normalize(-camPos);
+        vec3 u = normalize(cross(w, (abs(w.z) < 0.9 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0))));
+        vec3 v = cross(u, w);
+        vRayPoint = vec4((c.x * u + c.y * v) * quadSize, 1.0);
+        gl_Position = projMX * viewMX * vRayPoint;
+    }
+    else {
+        gl_Position = vec4(c, 0.0, 1.0);
+        vRayPoint = invViewProjMX * gl_Position;
+    }
+}
@@ -0,0 +1,24 @@
+// faces of the observer's cubemap, see Panorama::SetFaceUniforms
+uniform sampler2DArray faceTex;
+uniform mat3 faceRotMX[6];
+
+/**
+ * Sample the face that looks most directly along a direction
+ * @param dir  direction in world coordinates
+ */
+vec4 sampleFaces(in vec3 dir) {
+    int face = 0;
+    vec3 faceDir = vec3(0.0, 0.0, -1.0);
+    float maxDepth = -2.0;
+    for(int i = 0; i < 6; i++) {
+        vec3 v = faceRotMX[i] * dir;
+        if (-v.z > maxDepth) {
+            maxDepth = -v.z;
+            faceDir = v;
+            face = i;
+        }
+    }
+
+    vec2 tc = 0.5 * faceDir.xy / maxDepth + 0.5;
+    return textureLod(faceTex, vec3(tc, float(face)), 0.0);
+}
@@ -1,6 +1,5 @@
 #version 430
 
-#include <shader/pattern.glsl>
 #include <shader/objectcolor.glsl>
 
 in vec3 vNormal;
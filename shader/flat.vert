@@ -1,5 +1,7 @@
 #version 430
 
+#include <shader/panorama.glsl>
+
 const float PI = 3.1415926;
 
 layout(location = 0) in vec4 in_position;
@@ -30,7 +32,12 @@ void main() {
     vec3 p = r * cos(phi) * e1 + r * sin(phi) * e2;
     vert = vec4(p, 1);
 
+#ifdef PANORAMA
+    gl_Position = faceViewProjMX[gl_InstanceID] * vert;
+    gl_Layer = gl_InstanceID;
+#else
     gl_Position = projMX * viewMX * vert;
+#endif
 
     vNormal = (modelMX * vec4(in_normal, 0)).xyz;
     vTexCoords = in_texCoords;
@@ -1,18 +1,13 @@
 #version 430
 
-#include <shader/pattern.glsl>
 #include <shader/objectcolor.glsl>
 #include <shader/schwarzschild.glsl>
+#include <shader/lighting.glsl>
 
-struct LightSource {
-    float is_active;
-    vec3 position;
-    float factor;
-};
-
-uniform LightSource light1;
-
-uniform float imageOrder;
+// LIGHT_ACTIVE is defined by shader variants, otherwise it is a uniform
+#ifndef LIGHT_ACTIVE
+#define LIGHT_ACTIVE isAnyLightActive()
+#endif
 
 in vec3 gPosition;
 in vec3 gNormal;
@@ -20,22 +15,21 @@ in vec2 gTexCoords;
 
 layout(location = 0) out vec4 fragColor;
 
-float getLight(vec3 pos) {
-    vec3 lightDir1_o0, lightDir1_o1;
-    float dist_o0, dist_o1;
-    calcApparentDirAndDist(light1.position, gPosition, 0.0, lightDir1_o0, dist_o0);
-    calcApparentDirAndDist(light1.position, gPosition, 1.0, lightDir1_o1, dist_o1);
-    float val1_o0 = max(0, dot(gNormal, lightDir1_o0));
-    float val1_o1 = max(0, dot(gNormal, lightDir1_o1));
-
-    float val = val1_o0 / (dist_o0 * dist_o0) + val1_o1 / (dist_o1 * dist_o1);
-    val *= light1.factor * 3e3;
-
-    return mix(1.0, val, light1.is_active);
-}
+// With DEFERRED_LIGHTING, the G-buffer is written and lit by grpr_lighting.frag.
+#ifdef DEFERRED_LIGHTING
+layout(location = 1) out vec4 fragNormal;
+layout(location = 2) out vec4 fragPosition;
+#endif
 
 void main() {
     vec4 color = objectcolor(gTexCoords, gNormal);
-    color.rgb *= getLight(gPosition);      
+#ifdef DEFERRED_LIGHTING
+    fragNormal = vec4(gNormal, 0.0);
+    fragPosition = vec4(gPosition, 1.0);
+#else
+    if (LIGHT_ACTIVE) {
+        color.rgb *= getLight(gPosition, gNormal);
+    }
+#endif
     fragColor = color;
 }
@@ -0,0 +1,22 @@
+#version 430
+
+// tessellated geometry captured by transform feedback, see TessGeometryCache
+layout(location = 0) in vec3 in_apparentPos;
+layout(location = 1) in vec3 in_position;
+layout(location = 2) in vec3 in_normal;
+layout(location = 3) in vec2 in_texCoords;
+
+uniform mat4 projMX;
+uniform mat4 viewMX;
+
+out vec3 gPosition;
+out vec3 gNormal;
+out vec2 gTexCoords;
+
+void main() {
+    gl_Position = projMX * viewMX * vec4(in_apparentPos, 1.0);
+
+    gPosition = in_position;
+    gNormal = in_normal;
+    gTexCoords = in_texCoords;
+}
@@ -4,16 +4,35 @@ layout(location = 0) in vec4 in_position;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec2 in_texCoords;
 
+// apparent positions from the projection pre-pass (grpr_project.comp)
+layout(std430, binding = 4) readonly buffer ApparentPosBuffer {
+    vec4 apparentPos[];
+};
+
 uniform mat4 modelMX;
+uniform uint numVertices;
+
+// IMAGE_ORDER is defined by shader variants, otherwise it is a uniform
+#ifndef IMAGE_ORDER
+uniform float imageOrder;
+#define IMAGE_ORDER imageOrder
+#endif
 
 out vec3 vPosition;
 out vec3 vNormal;
 out vec2 vTexCoords;
 
+#ifdef PANORAMA
+flat out int vFace;
+#endif
+
 void main() {
-    gl_Position = modelMX * in_position;
+    gl_Position = apparentPos[uint(IMAGE_ORDER) * numVertices + gl_VertexID];
 
-    vPosition = gl_Position.xyz;
+    vPosition = (modelMX * in_position).xyz;
     vNormal = (modelMX * vec4(in_normal, 0)).xyz;
     vTexCoords = in_texCoords;
+#ifdef PANORAMA
+    vFace = gl_InstanceID;
+#endif
 }
@@ -0,0 +1,34 @@
+#version 430
+
+#include <shader/schwarzschild.glsl>
+#include <shader/lighting.glsl>
+
+// G-buffer, see GBuffer
+uniform sampler2D gbAlbedo;
+uniform sampler2D gbNormal;
+uniform sampler2D gbPosition;
+uniform sampler2D gbDepth;
+
+// lower left corner of the viewport
+uniform ivec2 viewOrigin;
+
+// number of tiles per row, see grpr_lightcull.comp
+uniform int numTilesX;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy) - viewOrigin;
+    vec4 pos = texelFetch(gbPosition, texel, 0);
+    if (pos.w == 0.0) {
+        discard;
+    }
+
+    vec4 color = texelFetch(gbAlbedo, texel, 0);
+    vec3 normal = texelFetch(gbNormal, texel, 0).xyz;
+    uint tile = uint(texel.y / LIGHT_TILE_SIZE) * uint(numTilesX) + uint(texel.x / LIGHT_TILE_SIZE);
+    color.rgb *= getTileLight(tile, pos.xyz, normal);
+
+    fragColor = color;
+    gl_FragDepth = texelFetch(gbDepth, texel, 0).r;
+}
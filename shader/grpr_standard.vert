@@ -1,18 +1,26 @@
 #version 430
 
-#include <shader/schwarzschild.glsl>
+#include <shader/panorama.glsl>
 
 layout(location = 0) in vec4 in_position;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec2 in_texCoords;
 
+// apparent positions from the projection pre-pass (grpr_project.comp)
+layout(std430, binding = 4) readonly buffer ApparentPosBuffer {
+    vec4 apparentPos[];
+};
+
 uniform mat4 projMX;
 uniform mat4 viewMX;
 uniform mat4 modelMX;
-uniform vec3 obsCamPos;
-uniform vec3 mainNormal;
+uniform uint numVertices;
 
+// IMAGE_ORDER is defined by shader variants, otherwise it is a uniform
+#ifndef IMAGE_ORDER
 uniform float imageOrder;
+#define IMAGE_ORDER imageOrder
+#endif
 
 out vec3 vPosition;
 out vec3 vNormal;
@@ -20,12 +28,14 @@ out vec2 vTexCoords;
 
 
 void main() {
-    vec4 vert = modelMX * in_position;
-
-    vec3 apparentPos = calcApparentPos(obsCamPos, vert.xyz, imageOrder, 0.8);
-    vert = vec4(apparentPos, 1);
+    vec4 vert = apparentPos[uint(IMAGE_ORDER) * numVertices + gl_VertexID];
 
+#ifdef PANORAMA
+    gl_Position = faceViewProjMX[gl_InstanceID] * vert;
+    gl_Layer = gl_InstanceID;
+#else
     gl_Position = projMX * viewMX * vert;
+#endif
 
     vPosition = vert.xyz;
     vNormal = (modelMX * vec4(in_normal, 0)).xyz;
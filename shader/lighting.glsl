@@ -0,0 +1,67 @@
+// Light sources, see LightList: position (xyz) and factor (w) of every active light.
+layout(std430, binding = 9) readonly buffer LightBuffer {
+    vec4 lightData[];
+};
+uniform int numLights;
+
+// Scale of the light factor.
+#define LIGHT_SCALE 3e3
+
+// Tile size, has to match LightList.
+#define LIGHT_TILE_SIZE 16
+
+// Length of the tile lists, see LightList::GetMaxLightsPerTile().
+uniform int maxLightsPerTile;
+
+bool isAnyLightActive() {
+    return numLights > 0;
+}
+
+/**
+ * Diffuse light of light source i, which reaches pos on the
+ *   light rays of both image orders.
+ * @param pos  position of surface
+ * @param normal  surface normal
+ */
+float getLightFrom(uint i, vec3 pos, vec3 normal) {
+    vec3 lightDir_o0, lightDir_o1;
+    float dist_o0, dist_o1;
+    calcApparentDirAndDist(lightData[i].xyz, pos, 0.0, lightDir_o0, dist_o0);
+    calcApparentDirAndDist(lightData[i].xyz, pos, 1.0, lightDir_o1, dist_o1);
+    float val_o0 = max(0, dot(normal, lightDir_o0));
+    float val_o1 = max(0, dot(normal, lightDir_o1));
+
+    return (val_o0 / (dist_o0 * dist_o0) + val_o1 / (dist_o1 * dist_o1)) * lightData[i].w * LIGHT_SCALE;
+}
+
+/**
+ * Diffuse light of all active light sources.
+ */
+float getLight(vec3 pos, vec3 normal) {
+    float val = 0.0;
+    for (uint i = 0; i < uint(numLights); i++) {
+        val += getLightFrom(i, pos, normal);
+    }
+    return val;
+}
+
+// The culling pass writes the tile lists itself.
+#ifndef LIGHT_CULLING
+// Per tile: number of lights followed by maxLightsPerTile light indices.
+layout(std430, binding = 10) readonly buffer TileLightBuffer {
+    uint tileLights[];
+};
+
+/**
+ * Diffuse light of the light sources in the list of a tile, see grpr_lightcull.comp.
+ */
+float getTileLight(uint tile, vec3 pos, vec3 normal) {
+    uint offset = tile * (uint(maxLightsPerTile) + 1);
+    uint num = min(tileLights[offset], uint(maxLightsPerTile));
+    float val = 0.0;
+    for (uint k = 1; k <= num; k++) {
+        val += getLightFrom(tileLights[offset + k], pos, normal);
+    }
+    return val;
+}
+#endif // LIGHT_CULLING
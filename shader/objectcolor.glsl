@@ -5,22 +5,27 @@
 #define OBJ_TEXTURE_COLSPHERE 3
 #define OBJ_TEXTURE_TRIANGLE  4
 
+// OBJ_TEXTURE is defined by shader variants, otherwise the pattern is a uniform
+#ifndef OBJ_TEXTURE
 uniform int obj_texture;
+#define OBJ_TEXTURE obj_texture
+#endif
+
+// patterns baked by PatternAtlas, layer OBJ_TEXTURE - 1
+uniform sampler2DArray patternTex;
+
+// material texture (map_Kd), replaces the pattern once it is loaded
+uniform sampler2D tex;
+uniform int useTexs;
 
 vec4 objectcolor(vec2 tc, vec3 normal) {
     vec4 color = vec4(tc, 0.0, 1.0);
     
-    if (obj_texture == OBJ_TEXTURE_DISK) {
-        color = vec4(checkered_disk(tc), 1.0);
-    }
-    else if (obj_texture == OBJ_TEXTURE_SPHERE) {
-        color = vec4(checkered_sphere(tc), 1.0);
-    }
-    else if (obj_texture == OBJ_TEXTURE_COLSPHERE) {
-        color = vec4(color_checkered_sphere(tc), 1.0);
+    if (useTexs != 0) {
+        color = vec4(texture(tex, tc).rgb, 1.0);
     }
-    else if (obj_texture == OBJ_TEXTURE_TRIANGLE) {
-        color = vec4(checkered_plane(tc + vec2(0.1)), 1.0);
+    else if (OBJ_TEXTURE != OBJ_TEXTURE_NONE) {
+        color = vec4(texture(patternTex, vec3(tc, float(OBJ_TEXTURE - 1))).rgb, 1.0);
     }
     
     //color.rgb = normal*0.5 + vec3(0.5);    
@@ -0,0 +1,6 @@
+// PANORAMA is defined by shader variants: every instance draws into one
+// face of the observer's cubemap, see Panorama
+#ifdef PANORAMA
+#extension GL_ARB_shader_viewport_layer_array : require
+uniform mat4 faceViewProjMX[6];
+#endif
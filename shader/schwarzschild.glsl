@@ -2,10 +2,208 @@
 const float SCHW_PI = 3.1415926;
 const float rs = 2.0;
 
+// azimuth range of the lookup table samples is [LUT_PHI_EPS, pi - LUT_PHI_EPS]
+const float LUT_PHI_EPS = 1e-4;
+
+const int LUT_FILTER_BILINEAR = 0;
+const int LUT_FILTER_BICUBIC = 1;
+const int LUT_FILTER_HERMITE = 2;
+const int LUT_FILTER_CHEBYSHEV = 3;
+
+const int LUT_LAYOUT_PHI = 0;
+const int LUT_LAYOUT_COSPHI = 1;
+
 uniform sampler2D lutTex0;
 uniform sampler2D lutTex1;
+uniform sampler2DArray lutDeriv0;  // derivatives wrt sample index, only for LUT_FILTER_HERMITE
+uniform sampler2DArray lutDeriv1;
 uniform float xmin;
 uniform float xscale;
+uniform int lutFilter = LUT_FILTER_BILINEAR;
+uniform int lutLayout = LUT_LAYOUT_PHI;
+
+// Piecewise Chebyshev fit, only for LUT_FILTER_CHEBYSHEV:
+//   [0]: (numBands, degX, degPhi, -), [1]: (xmin, xmax, phimin, phimax),
+//   then (ksi, dt, ux, uy) coefficients ordered by [order][band][ix][iphi]
+layout(std430, binding = 8) readonly buffer LUTFitBuffer {
+    vec4 lutFit[];
+};
+
+/**
+ * Position in the lookup table in units of samples
+ * @param size  number of samples (azimuth, radius)
+ * @param r  actual position (radius)
+ * @param phi  actual position (azimuth angle)
+ */
+vec2 lutSamplePos(in ivec2 size, in float r, in float phi) {
+    float s = (phi - LUT_PHI_EPS) / (SCHW_PI - 2.0 * LUT_PHI_EPS);
+    float t = (rs / r - xmin) * xscale;
+    return vec2(s, t) * vec2(size - 1);
+}
+
+/**
+ * Bilinear hardware interpolation at sample position g
+ */
+vec4 lutBilinear(in sampler2D lut, in vec2 g) {
+    return texture(lut, (g + 0.5) / vec2(textureSize(lut, 0)));
+}
+
+/**
+ * Catmull-Rom interpolation through 4x4 samples at sample position g.
+ *   Falls back to bilinear interpolation next to invalid samples.
+ */
+vec4 lutBicubic(in sampler2D lut, in vec2 g) {
+    ivec2 size = textureSize(lut, 0);
+    vec2 gi = floor(g);
+    vec2 f = g - gi;
+
+    vec2 w[4];
+    w[0] = f * (-0.5 + f * (1.0 - 0.5 * f));
+    w[1] = 1.0 + f * f * (-2.5 + 1.5 * f);
+    w[2] = f * (0.5 + f * (2.0 - 1.5 * f));
+    w[3] = f * f * (-0.5 + 0.5 * f);
+
+    vec4 value = vec4(0.0);
+    for(int j = 0; j < 4; j++) {
+        for(int i = 0; i < 4; i++) {
+            ivec2 idx = clamp(ivec2(gi) + ivec2(i - 1, j - 1), ivec2(0), size - 1);
+            vec4 v = texelFetch(lut, idx, 0);
+            if (v.y < 0.0) {
+                return lutBilinear(lut, g);
+            }
+            value += w[i].x * w[j].y * v;
+        }
+    }
+    return value;
+}
+
+/**
+ * Cubic Hermite interpolation through 2x2 samples and their derivatives
+ * at sample position g. Falls back to bilinear interpolation next to invalid samples.
+ */
+vec4 lutHermite(in sampler2D lut, in sampler2DArray deriv, in vec2 g) {
+    ivec2 size = textureSize(lut, 0);
+    ivec2 gi = clamp(ivec2(floor(g)), ivec2(0), max(size - 2, ivec2(0)));
+    vec2 f = clamp(g - vec2(gi), 0.0, 1.0);
+
+    // basis functions for values (h) and derivatives (k) at both ends
+    vec2 h[2], k[2];
+    h[1] = f * f * (3.0 - 2.0 * f);
+    h[0] = 1.0 - h[1];
+    k[0] = f * (1.0 - f) * (1.0 - f);
+    k[1] = f * f * (f - 1.0);
+
+    vec4 value = vec4(0.0);
+    for(int j = 0; j < 2; j++) {
+        for(int i = 0; i < 2; i++) {
+            ivec2 idx = min(gi + ivec2(i, j), size - 1);
+            vec4 v = texelFetch(lut, idx, 0);
+            if (v.y < 0.0) {
+                return lutBilinear(lut, g);
+            }
+            vec4 ds = texelFetch(deriv, ivec3(idx, 0), 0);
+            vec4 dt = texelFetch(deriv, ivec3(idx, 1), 0);
+            value += h[i].x * h[j].y * v + k[i].x * h[j].y * ds + h[i].x * k[j].y * dt;
+        }
+    }
+    return value;
+}
+
+/**
+ * Chebyshev series sum_j c_j T_j(v), j = 0..deg, via Clenshaw recurrence
+ * @param first  index of c_0 in lutFit
+ */
+vec4 lutChebyshevSeries(in int first, in int deg, in float v) {
+    vec4 b1 = vec4(0.0);
+    vec4 b2 = vec4(0.0);
+    for(int j = deg; j >= 1; j--) {
+        vec4 b = fma(vec4(2.0 * v), b1, lutFit[first + j] - b2);
+        b2 = b1;
+        b1 = b;
+    }
+    return fma(vec4(v), b1, lutFit[first] - b2);
+}
+
+/**
+ * Evaluate piecewise Chebyshev fit without texture fetches
+ * @param iorder  order of light ray (0,1)
+ * @param r  actual position (radius)
+ * @param phi  actual position (azimuth angle)
+ * @param value  lookup table entry (ksi, dist, ux, uy)
+ * @return false if the radial band has no valid fit
+ */
+bool lutChebyshev(in float iorder, in float r, in float phi, out vec4 value) {
+    ivec3 n = ivec3(lutFit[0].xyz);
+    vec4 range = lutFit[1];
+
+    float bx = clamp((rs / r - range.x) / (range.y - range.x), 0.0, 1.0) * float(n.x);
+    int band = min(int(bx), n.x - 1);
+    float u = 2.0 * (bx - float(band)) - 1.0;
+    float v = clamp(2.0 * (phi - range.z) / (range.w - range.z) - 1.0, -1.0, 1.0);
+
+    int np = n.z + 1;
+    int first = 2 + ((int(iorder + 0.5) * n.x + band) * (n.y + 1)) * np;
+    if (lutFit[first].y < 0.0) {
+        return false;
+    }
+
+    // Clenshaw recurrence in x over the series in phi
+    vec4 b1 = vec4(0.0);
+    vec4 b2 = vec4(0.0);
+    for(int i = n.y; i >= 1; i--) {
+        vec4 b = fma(vec4(2.0 * u), b1, lutChebyshevSeries(first + i * np, n.z, v) - b2);
+        b2 = b1;
+        b1 = b;
+    }
+    value = fma(vec4(u), b1, lutChebyshevSeries(first, n.z, v) - b2);
+    return true;
+}
+
+/**
+ * Read lookup table entry of the cos(phi) layout with a single bilinear fetch
+ * @param iorder  order of light ray (0,1)
+ * @param r  actual position (radius)
+ * @param cosPhi  actual position (cosine of azimuth angle)
+ * @return (dist cos(ksi), dist sin(ksi), ux, uy), invalid if second component is negative
+ */
+vec4 lookupEntryCosPhi(in float iorder, in float r, in float cosPhi) {
+    const float cosPhiMax = cos(LUT_PHI_EPS);
+    const float cosPhiMin = cos(SCHW_PI - LUT_PHI_EPS);
+
+    ivec2 size = textureSize(lutTex0, 0);
+    float s = (cosPhiMax - cosPhi) / (cosPhiMax - cosPhiMin);
+    float t = (rs / r - xmin) * xscale;
+    vec2 tc = (vec2(s, t) * vec2(size - 1) + 0.5) / vec2(size);
+    return (iorder < 0.5 ? texture(lutTex0, tc) : texture(lutTex1, tc));
+}
+
+/**
+ * Read lookup table entry (ksi, dist, ux, uy)
+ * @param iorder  order of light ray (0,1)
+ * @param r  actual position (radius)
+ * @param phi  actual position (azimuth angle)
+ */
+vec4 lookupEntry(in float iorder, in float r, in float phi) {
+    if (lutLayout == LUT_LAYOUT_COSPHI) {
+        vec4 v = lookupEntryCosPhi(iorder, r, cos(phi));
+        return vec4(atan(v.y, v.x), (v.y < 0.0 ? -1.0 : length(v.xy)), v.zw);
+    }
+
+    vec4 value;
+    if (lutFilter == LUT_FILTER_CHEBYSHEV && lutChebyshev(iorder, r, phi, value)) {
+        return value;
+    }
+
+    vec2 g = lutSamplePos(textureSize(lutTex0, 0), r, phi);
+
+    if (lutFilter == LUT_FILTER_BICUBIC) {
+        return (iorder < 0.5 ? lutBicubic(lutTex0, g) : lutBicubic(lutTex1, g));
+    }
+    else if (lutFilter == LUT_FILTER_HERMITE) {
+        return (iorder < 0.5 ? lutHermite(lutTex0, lutDeriv0, g) : lutHermite(lutTex1, lutDeriv1, g));
+    }
+    return mix(lutBilinear(lutTex0, g), lutBilinear(lutTex1, g), iorder);
+}
 
 /**
  * Read distance and angle from lookup table
@@ -16,15 +214,7 @@ uniform float xscale;
  * @param ksi   apparent viewing angle
  */
 void lookupCoords(in float iorder, in float r, in float phi, out float dist, out float ksi) {
-    float x = rs / r;
-    float t = (x - xmin) * xscale;
-
-    float s = phi / SCHW_PI;
-
-    vec2 npos_first = texture(lutTex0, vec2(s, t)).xy;
-    vec2 npos_second = texture(lutTex1, vec2(s, t)).xy;
-
-    vec2 npos = mix(npos_first, npos_second, iorder);
+    vec2 npos = lookupEntry(iorder, r, phi).xy;
     dist = npos.y;
     ksi = npos.x;
 }
@@ -39,6 +229,19 @@ void lookupCoords(in float iorder, in float r, in float phi, out float dist, out
  */
 vec3 calcApparentPos(vec3 p, vec3 q, float iorder, float distScale = 1.0) {
     vec3 e1 = normalize(p);
+
+    if (lutLayout == LUT_LAYOUT_COSPHI) {
+        // e2 is the normalized component of q perpendicular to e1
+        float qx = dot(q, e1);
+        float rq = length(q);
+        vec3 qPerp = q - qx * e1;
+        vec3 e2n = qPerp * inversesqrt(max(dot(qPerp, qPerp), 1e-20));
+
+        vec4 v = lookupEntryCosPhi(iorder, rq, qx / rq);
+        float sn = 2.0 * (0.5 - iorder);
+        return distScale * (v.x * e1 + sn * v.y * e2n) + p;
+    }
+
     vec3 n = cross(e1, q);
     vec3 e2 = normalize(cross(n, e1));
 
@@ -57,22 +260,33 @@ vec3 calcApparentPos(vec3 p, vec3 q, float iorder, float distScale = 1.0) {
 }
 
 /**
- *
+ * Check whether the lookup table holds a light ray from q to p.
+ *   Cells without a geodesic store a negative distance.
+ * @param p  main point
+ * @param q  view point
+ * @param iorder  order of light ray (0,1)
  */
-void lookupDirsAndDist(in float iorder, in float r, in float phi, out float ux, out float uy, out float dist) {
-    float x = rs / r;
-    float t = (x - xmin) * xscale;
+bool isValidLookup(vec3 p, vec3 q, float iorder) {
+    vec3 e1 = normalize(p);
+    vec3 n = cross(e1, q);
+    vec3 e2 = normalize(cross(n, e1));
 
-    float s = phi / SCHW_PI;
+    float x = dot(q, e1);
+    float y = dot(q, e2);
+
+    float dist, ksi;
+    lookupCoords(iorder, sqrt(x*x + y*y), atan(y, x), dist, ksi);
+    return (dist >= 0.0);
+}
 
-    vec3 ndir_first = texture(lutTex0, vec2(s, t)).zwy;
-    vec3 ndir_second = texture(lutTex1, vec2(s, t)).zwy;
-    
-    vec2 ndir = mix(ndir_first.xy, ndir_second.xy, iorder);
+/**
+ *
+ */
+void lookupDirsAndDist(in float iorder, in float r, in float phi, out float ux, out float uy, out float dist) {
+    vec3 ndir = lookupEntry(iorder, r, phi).zwy;
     ux = ndir.x;
     uy = ndir.y;
-
-    dist = mix(ndir_first.z, ndir_second.z, iorder);
+    dist = ndir.z;
 }
 
 
@@ -0,0 +1,28 @@
+#version 430
+
+#include <shader/cubefaces.glsl>
+
+// source directions of both image orders, see shader/warp_deflection.comp
+uniform sampler2DArray deflectionMap;
+uniform ivec2 viewOrigin;
+uniform vec3 clearColor;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy) - viewOrigin;
+    vec4 src0 = texelFetch(deflectionMap, ivec3(pixel, 0), 0);
+    vec4 src1 = texelFetch(deflectionMap, ivec3(pixel, 1), 0);
+
+    // the flat scene was cleared with alpha zero
+    vec4 color = vec4(clearColor, 0.0);
+    if (src1.w > 0.0) {
+        vec4 c1 = sampleFaces(src1.xyz);
+        color = mix(color, c1, c1.a);
+    }
+    if (src0.w > 0.0) {
+        vec4 c0 = sampleFaces(src0.xyz);
+        color = mix(color, c0, c0.a);
+    }
+    fragColor = color;
+}
@@ -0,0 +1,124 @@
+/**
+ * File:    BlackHoleShadow.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "BlackHoleShadow.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Above this angular radius, the quad around the shadow is replaced by the whole screen.
+constexpr double MaxQuadAngle = 80.0 / 180.0 * 3.14159265358979;
+
+BlackHoleShadow::BlackHoleShadow()
+    : m_radius(0.0f)
+    , m_rs(2.0f)
+{
+    m_center = glm::vec3(0.0f);
+}
+
+BlackHoleShadow::~BlackHoleShadow() {}
+
+double BlackHoleShadow::CalcShadowAngle(double r, double rs)
+{
+    if (r <= rs) {
+        return glm::pi<double>();
+    }
+
+    // see schwarzschild_ksiCrit() in genlookup; inside the photon sphere, the shadow covers more than half the sky
+    double sk2 = 6.75 * rs * rs / (r * r) * (1.0 - rs / r);
+    double ksi = asin(std::min(1.0, sqrt(sk2)));
+    return (r < 1.5 * rs ? glm::pi<double>() - ksi : ksi);
+}
+
+void BlackHoleShadow::Draw(const float* projMXptr, const float* viewMXptr, const float* modelMXptr)
+{
+    if (!m_visible) {
+        return;
+    }
+    std::ignore = modelMXptr;
+
+    if (m_radius > 0.0f) {
+        m_sphere.SetColor(glm::value_ptr(m_color));
+        m_sphere.SetFlatShading(m_isFlatShading);
+        m_sphere.Draw(projMXptr, viewMXptr);
+        return;
+    }
+
+    glm::mat4 projMX = glm::make_mat4(projMXptr);
+    glm::mat4 viewMX = glm::mat4(1.0f);
+    if (viewMXptr != nullptr) {
+        viewMX = glm::make_mat4(viewMXptr);
+    }
+    glm::vec3 camPos = glm::vec3(glm::inverse(viewMX)[3]);
+    double dist = static_cast<double>(glm::length(camPos));
+
+    // angular radius and the sphere at the black hole's position with the same silhouette
+    double ksi = CalcShadowAngle(dist, static_cast<double>(m_rs));
+    double radius = dist * sin(std::min(ksi, 0.5 * glm::pi<double>()));
+    float quadSize = (ksi < MaxQuadAngle ? static_cast<float>(1.05 * dist * tan(ksi)) : 0.0f);
+
+    m_shader.Bind();
+    m_shader.SetFloatMatrix("projMX", 4, 1, GL_FALSE, projMXptr);
+    m_shader.SetFloatMatrix("viewMX", 4, 1, GL_FALSE, glm::value_ptr(viewMX));
+    m_shader.SetFloatMatrix("invViewProjMX", 4, 1, GL_FALSE, glm::value_ptr(glm::inverse(projMX * viewMX)));
+    m_shader.SetFloat("camPos", camPos.x, camPos.y, camPos.z);
+    m_shader.SetFloat("quadSize", quadSize);
+    m_shader.SetFloat("cosShadow", static_cast<float>(cos(ksi)));
+    m_shader.SetFloat("radius", static_cast<float>(radius));
+
+    m_shader.SetFloatArray("m_color", 4, 1, glm::value_ptr(m_color));
+    m_shader.SetFloat("flatShading", (m_isFlatShading ? 1.0f : 0.0f));
+    m_va.Bind();
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_va.Release();
+
+    m_shader.Release();
+}
+
+bool BlackHoleShadow::Init()
+{
+    m_va.Create(0);
+
+    bool isOkay = m_sphere.Init();
+
+    std::string vShaderName = "shader/blackhole.vert";
+    std::string fShaderName = "shader/blackhole.frag";
+    m_shader.SetFileNames(vShaderName.c_str(), fShaderName.c_str());
+    return isOkay && m_shader.ReloadShaders();
+}
+
+bool BlackHoleShadow::ReloadShaders()
+{
+    return m_sphere.ReloadShaders() && m_shader.ReloadShaders();
+}
+
+float BlackHoleShadow::GetRadius()
+{
+    return m_radius;
+}
+
+void BlackHoleShadow::SetRadius(float radius)
+{
+    m_radius = std::max(0.0f, radius);
+    if (m_radius > 0.0f) {
+        m_sphere.SetRadius(m_radius);
+    }
+}
+
+void BlackHoleShadow::SetApparentSize(int pixels)
+{
+    m_sphere.SetApparentSize(pixels);
+}
+
+void BlackHoleShadow::SetSchwarzschildRadius(float rs)
+{
+    m_rs = rs;
+}
+
+void BlackHoleShadow::setModelMatrix()
+{
+    modelMX = glm::mat4(1.0f);
+}
@@ -0,0 +1,66 @@
+/**
+ * File:    BlackHoleShadow.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_BLACK_HOLE_SHADOW_H
+#define GRPR_BLACK_HOLE_SHADOW_H
+
+#include "Object.h"
+#include "SDSphere.h"
+
+/**
+ * @brief Screen-space impostor of the black hole's shadow.
+ *   A single quad around the shadow is rasterized (shader/blackhole.vert), the
+ *   fragment shader keeps the pixels within the shadow's angular radius and
+ *   writes the depth of a sphere with the same silhouette. By default, the
+ *   angular radius follows from the distance of the camera to the black hole;
+ *   with a fixed radius, the icosphere of earlier versions (SDSphere) is drawn.
+ */
+class BlackHoleShadow : public Object
+{
+public:
+    BlackHoleShadow();
+    virtual ~BlackHoleShadow();
+
+    /**
+     * @brief Angular radius of the shadow.
+     * @param r   Distance of the observer to the black hole.
+     * @param rs  Schwarzschild radius.
+     * @return Angular radius measured from the direction to the black hole [rad].
+     */
+    static double CalcShadowAngle(double r, double rs);
+
+    virtual void Draw(const float* projMXptr, const float* viewMXptr, const float* modelMXptr = nullptr);
+
+    virtual bool Init();
+
+    virtual bool ReloadShaders();
+
+    /// Fixed radius of the sphere, 0 if the shadow is drawn.
+    float GetRadius();
+
+    /**
+     * @brief Set radius.
+     * @param radius  Radius of a sphere at the black hole's position,
+     *                0: radius of the shadow as seen from the camera.
+     */
+    void SetRadius(float radius);
+
+    /// Apparent radius of the fixed-radius sphere in pixels, see SDSphere::SetApparentSize().
+    void SetApparentSize(int pixels);
+
+    void SetSchwarzschildRadius(float rs);
+
+protected:
+    virtual void setModelMatrix();
+
+protected:
+    float m_radius;
+    float m_rs;
+
+    SDSphere m_sphere;
+};
+
+#endif // GRPR_BLACK_HOLE_SHADOW_H
@@ -75,6 +75,7 @@ Camera::Camera()
 {
     viewMX = glm::mat4(1.0);
     projMX = glm::mat4(1.0);
+    projFullMX = glm::mat4(1.0);
     m_quat = Quaternion<double>(0, 0, 0, 1);
 
     setStandardCamera();
@@ -112,6 +113,7 @@ Camera::Camera(const Camera& other)
     , cam_base_rot1(other.cam_base_rot1)
     , cam_base_rot2(other.cam_base_rot2)
     , cam_pix_offset(other.cam_pix_offset)
+    , cam_tile_region(other.cam_tile_region)
     , m_useInverseYaw(other.m_useInverseYaw)
 {
     m_quat = other.m_quat;
@@ -149,6 +151,7 @@ Camera::Camera(const Camera& other, CoordAxis ca)
     , camOrthoView(other.camOrthoView)
     , camViewAngleKsi(other.camViewAngleKsi)
     , camViewAngleChi(other.camViewAngleChi)
+    , cam_tile_region(other.cam_tile_region)
     , m_useInverseYaw(other.m_useInverseYaw)
 {
     glm::dvec3 r, d, u;
@@ -189,6 +192,11 @@ const float* Camera::GetProjMatrixPtr() const
     return glm::value_ptr(projMX);
 }
 
+const float* Camera::GetFullProjMatrixPtr() const
+{
+    return glm::value_ptr(projFullMX);
+}
+
 Camera::Projection Camera::GetProjection()
 {
     return camProjection;
@@ -693,6 +701,33 @@ void Camera::SetPixelOffset(double px, double py)
     cam_pix_offset = glm::dvec2(px, py);
 }
 
+void Camera::SetTileRegion(double x0, double y0, double x1, double y1)
+{
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+    cam_tile_region = glm::dvec4(x0, y0, x1, y1);
+    UpdateMatrices();
+}
+
+void Camera::ResetTileRegion()
+{
+    SetTileRegion(0.0, 0.0, 1.0, 1.0);
+}
+
+void Camera::GetTileRegion(double& x0, double& y0, double& x1, double& y1)
+{
+    x0 = cam_tile_region.x;
+    y0 = cam_tile_region.y;
+    x1 = cam_tile_region.z;
+    y1 = cam_tile_region.w;
+}
+
+bool Camera::IsTiled()
+{
+    return (cam_tile_region != glm::dvec4(0.0, 0.0, 1.0, 1.0));
+}
+
 void Camera::Roll(double angle)
 {
     if (camType == Type::ORBIT_QUATERNION) {
@@ -1086,12 +1121,22 @@ void Camera::UpdateMatrices()
     //  update perspective matrix
     // -----------------------------
     if (camProjection == Projection::ORTHOGRAPHIC) {
-        calc_ortho_matrix(projMX);
+        calc_ortho_matrix(projFullMX);
     }
     else if (camProjection == Projection::PERSPECTIVE) {
-        calc_persp_matrix(projMX);
+        calc_persp_matrix(projFullMX);
     }
 
+    // map the tile region onto the full clip space (off-centre frustum)
+    double tw = cam_tile_region.z - cam_tile_region.x;
+    double th = cam_tile_region.w - cam_tile_region.y;
+    glm::mat4 tileMX = glm::mat4(1.0f);
+    tileMX[0][0] = static_cast<float>(1.0 / tw);
+    tileMX[1][1] = static_cast<float>(1.0 / th);
+    tileMX[3][0] = static_cast<float>((1.0 - cam_tile_region.x - cam_tile_region.z) / tw);
+    tileMX[3][1] = static_cast<float>((1.0 - cam_tile_region.y - cam_tile_region.w) / th);
+    projMX = tileMX * projFullMX;
+
     // -----------------------------
     //  update view matrix
     // -----------------------------
@@ -1271,6 +1316,7 @@ void Camera::SetProjectionMatrix(const float* matrix, bool is_glm)
     if (!is_glm) {
         projMX = glm::transpose(projMX);
     }
+    projFullMX = projMX;
 }
 
 void Camera::SetResolution(const int res)
@@ -1815,6 +1861,7 @@ void Camera::setStandardCamera()
     
     camRes = glm::ivec2(720, 576);
     camAspect = camRes.x / static_cast<double>(camRes.y);
+    cam_tile_region = glm::dvec4(0.0, 0.0, 1.0, 1.0);
 
     camFoVv = 40.0; 
     camZnear = 0.1;
@@ -330,6 +330,9 @@ public:
     /// Get pointer to projection matrix which can be directly used in glUniformMatrix4fv.
     const float* GetProjMatrixPtr() const;
 
+    /// Get pointer to projection matrix of the full image, independent of the current tile region.
+    const float* GetFullProjMatrixPtr() const;
+
     /**
      * @brief Get camera resolution.
      *   The individual values can be obtained using GetWidth() and GetHeight().
@@ -808,6 +811,27 @@ public:
 
     void SetPixelOffset(double px, double py);
 
+    /**
+     * @brief Restrict the projection to a sub-region of the full image.
+     *   The region is given in normalized image coordinates with the origin
+     *   in the lower left corner. The projection matrix then becomes the
+     *   off-centre frustum of this tile, which is used for tiled rendering.
+     * @param x0  Left border of tile [0,1].
+     * @param y0  Lower border of tile [0,1].
+     * @param x1  Right border of tile [0,1].
+     * @param y1  Upper border of tile [0,1].
+     */
+    void SetTileRegion(double x0, double y0, double x1, double y1);
+
+    /// Reset tile region to the full image.
+    void ResetTileRegion();
+
+    /// Get tile region (x0,y0,x1,y1) in normalized image coordinates.
+    void GetTileRegion(double& x0, double& y0, double& x1, double& y1);
+
+    /// Check whether projection is restricted to a tile.
+    bool IsTiled();
+
     /**
      * @brief Set camera type.
      *  The camera type is only interesting for the orbital motion and for the
@@ -918,6 +942,7 @@ protected:
     glm::mat4 viewMX; //!< View matrix.
     glm::mat4 invViewMX; //!< Inverse view matrix.
     glm::mat4 projMX; //!< Projection matrix.
+    glm::mat4 projFullMX; //!< Projection matrix of the full image (without tile region).
 
     glm::mat4 cmViewMX; //!< Cubemap view matrix.
     CMView cmView;
@@ -970,6 +995,7 @@ protected:
     glm::mat4 cam_base_rotMX;
 
     glm::dvec2 cam_pix_offset;
+    glm::dvec4 cam_tile_region; //!< Tile region: x0,y0,x1,y1 in normalized image coordinates
 
     // Special position definition (Xpos,Xneg,Ypos,Yneg,Zpos,Zneg)
     glm::dvec3 m_specPoI[6];
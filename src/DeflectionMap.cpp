@@ -0,0 +1,120 @@
+/**
+ * File:    DeflectionMap.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "DeflectionMap.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+DeflectionMap::DeflectionMap()
+    : m_texID(0)
+    , m_emptyVA(0)
+    , m_width(0)
+    , m_height(0)
+    , m_texWidth(0)
+    , m_texHeight(0)
+    , m_isValid(false)
+{
+    memset(m_key, 0, sizeof(m_key));
+}
+
+DeflectionMap::~DeflectionMap()
+{
+    //
+}
+
+void DeflectionMap::BindImage(GLuint unit)
+{
+    glBindImageTexture(unit, m_texID, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+}
+
+void DeflectionMap::BindTexture()
+{
+    glActiveTexture(GL_TEXTURE0 + TexUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texID);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void DeflectionMap::Delete()
+{
+    if (glIsTexture(m_texID)) {
+        glDeleteTextures(1, &m_texID);
+    }
+    m_texID = 0;
+
+    if (glIsVertexArray(m_emptyVA)) {
+        glDeleteVertexArrays(1, &m_emptyVA);
+    }
+    m_emptyVA = 0;
+    m_width = m_height = 0;
+    m_texWidth = m_texHeight = 0;
+    m_isValid = false;
+}
+
+void DeflectionMap::DrawFullScreen()
+{
+    // the core profile needs a vertex array even without attributes
+    glBindVertexArray(m_emptyVA);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
+
+int DeflectionMap::GetWidth()
+{
+    return m_width;
+}
+
+int DeflectionMap::GetHeight()
+{
+    return m_height;
+}
+
+void DeflectionMap::Invalidate()
+{
+    m_isValid = false;
+}
+
+bool DeflectionMap::IsValidFor(const float* key)
+{
+    return (m_isValid && memcmp(key, m_key, sizeof(m_key)) == 0);
+}
+
+void DeflectionMap::Resize(int width, int height)
+{
+    if (m_texID != 0 && width <= m_texWidth && height <= m_texHeight) {
+        m_width = width;
+        m_height = height;
+        return;
+    }
+
+    TRACE_SCOPE("DeflectionMap::Resize");
+    int texWidth = std::max(width, m_texWidth);
+    int texHeight = std::max(height, m_texHeight);
+    Delete();
+    m_width = width;
+    m_height = height;
+    m_texWidth = texWidth;
+    m_texHeight = texHeight;
+
+    glGenVertexArrays(1, &m_emptyVA);
+
+    // read via texelFetch, one texel per pixel
+    glGenTextures(1, &m_texID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texID);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA16F, m_texWidth, m_texHeight, NumOrders);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void DeflectionMap::Validate(const float* key)
+{
+    memcpy(m_key, key, sizeof(m_key));
+    m_isValid = true;
+}
@@ -0,0 +1,82 @@
+/**
+ * File:    DeflectionMap.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_DEFLECTION_MAP_H
+#define GRPR_DEFLECTION_MAP_H
+
+#include "glad/glad.h"
+
+/**
+ * @brief Per-pixel source directions of a fixed observer for the Warp view mode.
+ *
+ *   Layer i (RGBA16F) holds for every pixel the flat-space direction from the
+ *   observer to the source of the order-i light ray that arrives in this
+ *   pixel, w=1 if there is such a ray. The sources lie on a sphere around the
+ *   black hole, see shader/warp_deflection.comp. The map is only computed
+ *   again if observer, camera, or resolution change (the key). The texture
+ *   only grows; a smaller resolution, e.g. from the dynamic resolution of the
+ *   FrameGovernor, uses its lower left part.
+ */
+class DeflectionMap
+{
+public:
+    static const GLuint TexUnit = 8;
+    static const int NumOrders = 2;
+
+    /// view matrix, projection matrix, observer distance, source radius, LUT filter and layout, size
+    static const int KeySize = 38;
+
+public:
+    DeflectionMap();
+    ~DeflectionMap();
+
+    /// Bind map to image unit 'unit' for writing.
+    void BindImage(GLuint unit);
+
+    /// Bind map to texture unit 'TexUnit'.
+    void BindTexture();
+
+    void Delete();
+
+    /// Draw one triangle covering the viewport, see shader/grpr_lighting.vert.
+    void DrawFullScreen();
+
+    int GetWidth();
+    int GetHeight();
+
+    /// Compute the map again with the next frame, e.g. after loading a lookup table.
+    void Invalidate();
+
+    /// Whether the map was computed for 'key'.
+    bool IsValidFor(const float* key);
+
+    /**
+     * @brief Set the used size; the map is only recreated if it is too small.
+     * @param width    Width in pixels.
+     * @param height   Height in pixels.
+     */
+    void Resize(int width, int height);
+
+    /// Mark map as computed for 'key'.
+    void Validate(const float* key);
+
+protected:
+    GLuint m_texID;
+    GLuint m_emptyVA;
+
+    /// Used size.
+    int m_width;
+    int m_height;
+
+    /// Allocated size.
+    int m_texWidth;
+    int m_texHeight;
+
+    float m_key[KeySize];
+    bool m_isValid;
+};
+
+#endif // GRPR_DEFLECTION_MAP_H
@@ -6,6 +6,7 @@
  */
 #include "FileTokenizer.h"
 #include "StringUtils.h"
+#include "Trace.h"
 #include "Utilities.h"
 
 #include <algorithm>
@@ -245,6 +246,7 @@ bool FileTokenizer::ReadFile(const char* filename)
 
 bool FileTokenizer::tokenize()
 {
+    TRACE_SCOPE("FileTokenizer::tokenize");
     std::ifstream in(m_filename.c_str());
     if (!in.is_open()) {
         char msg[256];
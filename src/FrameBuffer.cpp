@@ -0,0 +1,128 @@
+/**
+ * File:    FrameBuffer.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "FrameBuffer.h"
+
+#include <cstdio>
+
+FrameBuffer::FrameBuffer()
+    : m_fbo(0)
+    , m_depthRB(0)
+    , m_colorTex(0)
+    , m_width(0)
+    , m_height(0)
+{
+    //
+}
+
+FrameBuffer::~FrameBuffer()
+{
+    //
+}
+
+void FrameBuffer::Bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void FrameBuffer::Blit(int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, srcWidth, srcHeight, 0, 0, dstWidth, dstHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool FrameBuffer::Create(int width, int height)
+{
+    Delete();
+
+    m_width = width;
+    m_height = height;
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+    glGenRenderbuffers(1, &m_depthRB);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRB);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRB);
+
+    glGenTextures(1, &m_colorTex);
+    glBindTexture(GL_TEXTURE_2D, m_colorTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTex, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "FBO incomplete!\n");
+        return false;
+    }
+    return true;
+}
+
+void FrameBuffer::Delete()
+{
+    if (glIsTexture(m_colorTex)) {
+        glDeleteTextures(1, &m_colorTex);
+    }
+    m_colorTex = 0;
+
+    if (glIsRenderbuffer(m_depthRB)) {
+        glDeleteRenderbuffers(1, &m_depthRB);
+    }
+    m_depthRB = 0;
+
+    if (glIsFramebuffer(m_fbo)) {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+    m_fbo = 0;
+    m_width = m_height = 0;
+}
+
+GLuint FrameBuffer::GetColorTexID()
+{
+    return m_colorTex;
+}
+
+int FrameBuffer::GetWidth()
+{
+    return m_width;
+}
+
+int FrameBuffer::GetHeight()
+{
+    return m_height;
+}
+
+bool FrameBuffer::IsValid()
+{
+    return (m_fbo > 0);
+}
+
+void FrameBuffer::ReadPixels(int x, int y, int w, int h, int rowLength, unsigned char* rgb)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ROW_LENGTH, rowLength);
+    glReadPixels(x, y, w, h, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+}
+
+void FrameBuffer::Release()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
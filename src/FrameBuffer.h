@@ -0,0 +1,71 @@
+/**
+ * File:    FrameBuffer.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_FRAME_BUFFER_H
+#define GRPR_FRAME_BUFFER_H
+
+#include "glad/glad.h"
+
+/**
+ * @brief Framebuffer object with one RGB color texture and a depth renderbuffer.
+ *   Used for headless rendering (offline renderer, benchmark) and for the
+ *   scaled resolution of the interactive version (FrameGovernor).
+ */
+class FrameBuffer
+{
+public:
+    FrameBuffer();
+    ~FrameBuffer();
+
+    /// Bind framebuffer for drawing and set viewport to (0,0,width,height).
+    void Bind();
+
+    /**
+     * @brief Upsample the region (0,0,srcWidth,srcHeight) into the whole default framebuffer.
+     * @param srcWidth, srcHeight  Size of rendered region.
+     * @param dstWidth, dstHeight  Size of default framebuffer.
+     */
+    void Blit(int srcWidth, int srcHeight, int dstWidth, int dstHeight);
+
+    /**
+     * @brief Create framebuffer object.
+     *   An already existing framebuffer is deleted first.
+     * @param width    Width in pixels.
+     * @param height   Height in pixels.
+     * @return true if framebuffer is complete.
+     */
+    bool Create(int width, int height);
+
+    void Delete();
+
+    GLuint GetColorTexID();
+    int GetWidth();
+    int GetHeight();
+
+    bool IsValid();
+
+    /**
+     * @brief Read back RGB pixels (bottom row first).
+     * @param x, y      Lower left corner.
+     * @param w, h      Size of region.
+     * @param rowLength Row length of destination buffer in pixels (0 = w).
+     * @param rgb       Destination buffer.
+     */
+    void ReadPixels(int x, int y, int w, int h, int rowLength, unsigned char* rgb);
+
+    /// Bind default framebuffer.
+    void Release();
+
+protected:
+    GLuint m_fbo;
+    GLuint m_depthRB;
+    GLuint m_colorTex;
+
+    int m_width;
+    int m_height;
+};
+
+#endif // GRPR_FRAME_BUFFER_H
@@ -0,0 +1,262 @@
+/**
+ * File:    FrameGovernor.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "FrameGovernor.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#ifdef HAVE_IMGUI
+#include "imgui.h"
+#endif // HAVE_IMGUI
+
+// share of the target frame time available for rendering, the rest is left for GUI and swap
+constexpr double GPUBudget = 0.85;
+
+FrameGovernor::FrameGovernor()
+    : m_currSet(0)
+    , m_width(0)
+    , m_height(0)
+    , m_scaledWidth(0)
+    , m_scaledHeight(0)
+    , m_enabled(true)
+    , m_isInitialized(false)
+    , m_isMoving(false)
+    , m_lastFrameReduced(false)
+    , m_targetMS(1000.0 / 60.0)
+    , m_gpuMS(0.0)
+    , m_frameStart(0.0)
+    , m_lastChange(-1e10)
+    , m_stillDelay(0.3)
+    , m_resScale(1.0f)
+    , m_tessScale(1.0f)
+    , m_minResScale(0.5f)
+    , m_minTessScale(0.125f)
+{
+    memset(m_queries, 0, sizeof(m_queries));
+    memset(m_issued, 0, sizeof(m_issued));
+    memset(m_wasMoving, 0, sizeof(m_wasMoving));
+}
+
+FrameGovernor::~FrameGovernor()
+{
+    //
+}
+
+void FrameGovernor::BeginFrame(double time)
+{
+    m_frameStart = time;
+    if (!m_isInitialized) {
+        return;
+    }
+
+    collect();
+
+    m_isMoving = m_enabled && (time - m_lastChange < m_stillDelay);
+    float scale = (m_isMoving ? m_resScale : 1.0f);
+    m_scaledWidth = std::max(1, static_cast<int>(scale * m_width + 0.5f));
+    m_scaledHeight = std::max(1, static_cast<int>(scale * m_height + 0.5f));
+
+    m_fbo.Bind();
+    glViewport(0, 0, m_scaledWidth, m_scaledHeight);
+    glQueryCounter(m_queries[m_currSet][0], GL_TIMESTAMP);
+    m_wasMoving[m_currSet] = m_isMoving;
+}
+
+void FrameGovernor::EndFrame(bool viewChanged)
+{
+    if (!m_isInitialized) {
+        return;
+    }
+
+    glQueryCounter(m_queries[m_currSet][1], GL_TIMESTAMP);
+    m_issued[m_currSet] = true;
+    m_currSet = (m_currSet + 1) % NumQuerySets;
+
+    m_fbo.Release();
+    m_fbo.Blit(m_scaledWidth, m_scaledHeight, m_width, m_height);
+    glViewport(0, 0, m_width, m_height);
+
+    if (viewChanged) {
+        m_lastChange = m_frameStart;
+    }
+    m_lastFrameReduced = m_isMoving && (m_resScale < 1.0f || m_tessScale < 1.0f);
+}
+
+void FrameGovernor::Delete()
+{
+    if (m_isInitialized) {
+        glDeleteQueries(2 * NumQuerySets, &m_queries[0][0]);
+    }
+    memset(m_queries, 0, sizeof(m_queries));
+    memset(m_issued, 0, sizeof(m_issued));
+    m_fbo.Delete();
+    m_isInitialized = false;
+}
+
+float FrameGovernor::GetResolutionScale()
+{
+    return ((m_enabled && m_isMoving) ? m_resScale : 1.0f);
+}
+
+float FrameGovernor::GetTessLevelScale()
+{
+    return ((m_enabled && m_isMoving) ? m_tessScale : 1.0f);
+}
+
+double FrameGovernor::GetGPUTime()
+{
+    return m_gpuMS;
+}
+
+double FrameGovernor::GetTargetFrameTime()
+{
+    return m_targetMS;
+}
+
+bool FrameGovernor::Init(int width, int height)
+{
+    Delete();
+    glGenQueries(2 * NumQuerySets, &m_queries[0][0]);
+    m_width = width;
+    m_height = height;
+    m_isInitialized = m_fbo.Create(width, height);
+    return m_isInitialized;
+}
+
+bool FrameGovernor::IsEnabled()
+{
+    return m_enabled;
+}
+
+bool FrameGovernor::NeedsRedraw()
+{
+    return m_lastFrameReduced;
+}
+
+void FrameGovernor::Present()
+{
+    if (!m_isInitialized) {
+        return;
+    }
+    m_fbo.Blit(m_scaledWidth, m_scaledHeight, m_width, m_height);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void FrameGovernor::SetEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    m_isMoving = false;
+}
+
+void FrameGovernor::SetTargetFrameTime(double ms)
+{
+    m_targetMS = std::max(1.0, ms);
+}
+
+void FrameGovernor::SetWindowSize(int width, int height)
+{
+    if (width <= 0 || height <= 0 || (width == m_width && height == m_height)) {
+        return;
+    }
+    m_width = width;
+    m_height = height;
+    if (m_isInitialized) {
+        m_fbo.Create(width, height);
+        m_scaledWidth = m_scaledHeight = 0;
+    }
+}
+
+void FrameGovernor::WaitForNextFrame(double time)
+{
+    if (!m_enabled || !m_isInitialized) {
+        std::this_thread::sleep_for(std::chrono::microseconds(5000));
+        return;
+    }
+
+    double remainingMS = m_targetMS - (time - m_frameStart) * 1000.0;
+    if (remainingMS > 0.5) {
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long>(remainingMS * 1000.0)));
+    }
+}
+
+#ifdef HAVE_IMGUI
+void FrameGovernor::RenderGUI()
+{
+    const ImGuiTreeNodeFlags headerFlags = ImGuiTreeNodeFlags_None;
+    if (ImGui::CollapsingHeader("Frame Governor", headerFlags)) {
+        bool enabled = m_enabled;
+        if (ImGui::Checkbox("enabled", &enabled)) {
+            SetEnabled(enabled);
+        }
+
+        float targetFPS = static_cast<float>(1000.0 / m_targetMS);
+        if (ImGui::SliderFloat("target fps", &targetFPS, 20.0f, 144.0f, "%.0f")) {
+            SetTargetFrameTime(1000.0 / targetFPS);
+        }
+
+        ImGui::Text("gpu: %6.2f ms   resolution: %3.0f%%   tessellation: %3.0f%%", m_gpuMS,
+            GetResolutionScale() * 100.0f, GetTessLevelScale() * 100.0f);
+    }
+}
+#endif // HAVE_IMGUI
+
+void FrameGovernor::collect()
+{
+    for (int s = 0; s < NumQuerySets; s++) {
+        if (!m_issued[s]) {
+            continue;
+        }
+
+        // The set which is about to be reused has to be read back in any case.
+        GLint available = 0;
+        if (s != m_currSet) {
+            glGetQueryObjectiv(m_queries[s][1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                continue;
+            }
+        }
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(m_queries[s][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(m_queries[s][1], GL_QUERY_RESULT, &end);
+        m_issued[s] = false;
+
+        if (m_wasMoving[s] && end > start) {
+            update(static_cast<double>(end - start) * 1e-6);
+        }
+    }
+}
+
+void FrameGovernor::update(double gpuMS)
+{
+    m_gpuMS = (m_gpuMS > 0.0 ? 0.8 * m_gpuMS + 0.2 * gpuMS : gpuMS);
+
+    double budget = GPUBudget * m_targetMS;
+    double ratio = budget / m_gpuMS;
+
+    if (m_gpuMS > budget) {
+        // Tessellation is the dominant cost of dense GRtess scenes, reduce it first.
+        if (m_tessScale > m_minTessScale) {
+            m_tessScale = std::max(m_minTessScale, m_tessScale * static_cast<float>(std::max(0.5, ratio)));
+        }
+        else {
+            m_resScale = std::max(m_minResScale, m_resScale * static_cast<float>(std::max(0.7, sqrt(ratio))));
+        }
+    }
+    else if (m_gpuMS < 0.75 * budget) {
+        if (m_resScale < 1.0f) {
+            m_resScale = std::min(1.0f, m_resScale * static_cast<float>(std::min(1.05, sqrt(ratio))));
+        }
+        else {
+            m_tessScale = std::min(1.0f, m_tessScale * static_cast<float>(std::min(1.1, ratio)));
+        }
+    }
+}
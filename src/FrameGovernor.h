@@ -0,0 +1,123 @@
+/**
+ * File:    FrameGovernor.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_FRAME_GOVERNOR_H
+#define GRPR_FRAME_GOVERNOR_H
+
+#include "glad/glad.h"
+
+#include "FrameBuffer.h"
+
+/**
+ * @brief Frame-time governor for the interactive loop.
+ *
+ *   The scene is rendered into an offscreen framebuffer with a scaled
+ *   resolution and linearly upsampled into the window. The GPU time of each
+ *   frame is measured via timestamp queries (read back with a delay of two
+ *   frames). While the view changes, the resolution scale and the tessellation
+ *   level scale are adapted to meet the target frame time: tessellation is
+ *   reduced first, resolution second; on the way back, resolution is restored
+ *   first. As soon as the view has been still for a short while, frames are
+ *   rendered with full resolution and tessellation again.
+ *
+ *   The offscreen framebuffer is also used without adaptation: it keeps the
+ *   last rendered frame, so that GUI-only updates can be presented without
+ *   rendering the scene again.
+ */
+class FrameGovernor
+{
+public:
+    FrameGovernor();
+    ~FrameGovernor();
+
+    /**
+     * @brief Start frame: bind offscreen framebuffer with the scaled viewport.
+     * @param time  Current time [s].
+     */
+    void BeginFrame(double time);
+
+    /**
+     * @brief Finish frame: upsample into the default framebuffer.
+     * @param viewChanged  Whether the rendered view differs from the previous frame.
+     */
+    void EndFrame(bool viewChanged);
+
+    void Delete();
+
+    /// Resolution scale of the current frame.
+    float GetResolutionScale();
+
+    /// Tessellation level scale of the current frame.
+    float GetTessLevelScale();
+
+    double GetGPUTime();
+
+    double GetTargetFrameTime();
+
+    bool Init(int width, int height);
+
+    bool IsEnabled();
+
+    /// Whether the last frame was rendered with reduced quality and should be refined.
+    bool NeedsRedraw();
+
+    /// Copy the last rendered frame into the default framebuffer again.
+    void Present();
+
+    void SetEnabled(bool enabled);
+
+    void SetTargetFrameTime(double ms);
+
+    void SetWindowSize(int width, int height);
+
+    /**
+     * @brief Sleep for the rest of the target frame period.
+     *   Without governor, the loop sleeps for a fixed 5 ms.
+     * @param time  Current time [s].
+     */
+    void WaitForNextFrame(double time);
+
+#ifdef HAVE_IMGUI
+    void RenderGUI();
+#endif // HAVE_IMGUI
+
+protected:
+    void collect();
+    void update(double gpuMS);
+
+protected:
+    static const int NumQuerySets = 3;
+
+    FrameBuffer m_fbo;
+    GLuint m_queries[NumQuerySets][2];
+    bool m_issued[NumQuerySets];
+    bool m_wasMoving[NumQuerySets];
+    int m_currSet;
+
+    int m_width;
+    int m_height;
+    int m_scaledWidth;
+    int m_scaledHeight;
+
+    bool m_enabled;
+    bool m_isInitialized;
+    bool m_isMoving;
+    bool m_lastFrameReduced;
+
+    double m_targetMS;
+    double m_gpuMS;  //!< smoothed GPU time of moving frames
+    double m_frameStart;
+    double m_lastChange;
+    double m_stillDelay;
+
+    /// Scales used while the view changes.
+    float m_resScale;
+    float m_tessScale;
+    float m_minResScale;
+    float m_minTessScale;
+};
+
+#endif // GRPR_FRAME_GOVERNOR_H
@@ -0,0 +1,160 @@
+/**
+ * File:    GBuffer.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "GBuffer.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+
+GBuffer::GBuffer()
+    : m_fbo(0)
+    , m_depthTex(0)
+    , m_emptyVA(0)
+    , m_width(0)
+    , m_height(0)
+    , m_texWidth(0)
+    , m_texHeight(0)
+{
+    for (int i = 0; i < NumTargets; i++) {
+        m_texIDs[i] = 0;
+    }
+}
+
+GBuffer::~GBuffer()
+{
+    //
+}
+
+void GBuffer::Bind()
+{
+    const GLenum drawBuffers[NumTargets] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    glDrawBuffers(NumTargets, drawBuffers);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void GBuffer::BindTextures(GLuint firstUnit)
+{
+    for (int i = 0; i < NumTargets; i++) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + static_cast<GLuint>(i));
+        glBindTexture(GL_TEXTURE_2D, m_texIDs[i]);
+    }
+    glActiveTexture(GL_TEXTURE0 + firstUnit + NumTargets);
+    glBindTexture(GL_TEXTURE_2D, m_depthTex);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void GBuffer::Clear()
+{
+    const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat one = 1.0f;
+    for (int i = 0; i < NumTargets; i++) {
+        glClearBufferfv(GL_COLOR, i, zero);
+    }
+    glClearBufferfv(GL_DEPTH, 0, &one);
+}
+
+void GBuffer::Delete()
+{
+    if (glIsTexture(m_texIDs[0])) {
+        glDeleteTextures(NumTargets, m_texIDs);
+    }
+    for (int i = 0; i < NumTargets; i++) {
+        m_texIDs[i] = 0;
+    }
+
+    if (glIsTexture(m_depthTex)) {
+        glDeleteTextures(1, &m_depthTex);
+    }
+    m_depthTex = 0;
+
+    if (glIsFramebuffer(m_fbo)) {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+    m_fbo = 0;
+
+    if (glIsVertexArray(m_emptyVA)) {
+        glDeleteVertexArrays(1, &m_emptyVA);
+    }
+    m_emptyVA = 0;
+    m_width = m_height = 0;
+    m_texWidth = m_texHeight = 0;
+}
+
+void GBuffer::DrawFullScreen()
+{
+    // the core profile needs a vertex array even without attributes
+    glBindVertexArray(m_emptyVA);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
+
+int GBuffer::GetWidth()
+{
+    return m_width;
+}
+
+int GBuffer::GetHeight()
+{
+    return m_height;
+}
+
+bool GBuffer::Resize(int width, int height)
+{
+    if (m_fbo != 0 && width <= m_texWidth && height <= m_texHeight) {
+        m_width = width;
+        m_height = height;
+        return true;
+    }
+
+    TRACE_SCOPE("GBuffer::Resize");
+    int texWidth = std::max(width, m_texWidth);
+    int texHeight = std::max(height, m_texHeight);
+    Delete();
+    m_width = width;
+    m_height = height;
+    m_texWidth = texWidth;
+    m_texHeight = texHeight;
+
+    glGenVertexArrays(1, &m_emptyVA);
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+    m_texIDs[static_cast<int>(Target::Albedo)] = genTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    m_texIDs[static_cast<int>(Target::Normal)] = genTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    m_texIDs[static_cast<int>(Target::Position)] = genTexture(GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    for (int i = 0; i < NumTargets; i++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i), GL_TEXTURE_2D,
+            m_texIDs[i], 0);
+    }
+
+    m_depthTex = genTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTex, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "G-buffer incomplete!\n");
+        return false;
+    }
+    return true;
+}
+
+GLuint GBuffer::genTexture(GLenum internalFormat, GLenum format, GLenum type)
+{
+    // all targets are read via texelFetch
+    GLuint texID;
+    glGenTextures(1, &texID);
+    glBindTexture(GL_TEXTURE_2D, texID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat), m_texWidth, m_texHeight, 0, format, type, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texID;
+}
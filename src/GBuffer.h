@@ -0,0 +1,75 @@
+/**
+ * File:    GBuffer.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_GBUFFER_H
+#define GRPR_GBUFFER_H
+
+#include "glad/glad.h"
+
+/**
+ * @brief Geometry buffer for deferred lighting.
+ *   Holds albedo (RGBA8), normal (RGBA16F), and position (RGBA32F, w=1 where
+ *   geometry was drawn) as color attachments 0-2, and a depth texture.
+ *   The textures only grow; a smaller size, e.g. from the dynamic resolution
+ *   of the FrameGovernor, uses their lower left part.
+ */
+class GBuffer
+{
+public:
+    enum class Target : int { Albedo = 0, Normal, Position, Count };
+    static const int NumTargets = static_cast<int>(Target::Count);
+
+public:
+    GBuffer();
+    ~GBuffer();
+
+    /// Bind G-buffer for drawing into all targets and set viewport to (0,0,width,height).
+    void Bind();
+
+    /**
+     * @brief Bind the target textures to consecutive texture units.
+     * @param firstUnit  Texture unit of albedo; normal, position, and depth follow.
+     */
+    void BindTextures(GLuint firstUnit);
+
+    /// Clear all targets to zero and the depth to one.
+    void Clear();
+
+    void Delete();
+
+    /// Draw one triangle covering the viewport, e.g. for a lighting pass.
+    void DrawFullScreen();
+
+    int GetWidth();
+    int GetHeight();
+
+    /**
+     * @brief Set the used size; the G-buffer is only recreated if it is too small.
+     * @param width    Width in pixels.
+     * @param height   Height in pixels.
+     * @return true if framebuffer is complete.
+     */
+    bool Resize(int width, int height);
+
+protected:
+    GLuint genTexture(GLenum internalFormat, GLenum format, GLenum type);
+
+protected:
+    GLuint m_fbo;
+    GLuint m_texIDs[NumTargets];
+    GLuint m_depthTex;
+    GLuint m_emptyVA;
+
+    /// Used size.
+    int m_width;
+    int m_height;
+
+    /// Allocated size.
+    int m_texWidth;
+    int m_texHeight;
+};
+
+#endif // GRPR_GBUFFER_H
@@ -5,11 +5,33 @@
  *  This file is part of GRPolygonRender.
  */
 #include "GLShader.h"
+#include "Trace.h"
 #include "Utilities.h"
 
+#include <cstdint>
 #include <fstream>
-#include <regex>
+#include <iterator>
 #include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// KHR_parallel_shader_compile is not part of the generated loader
+typedef void (*PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_GRPR)(GLuint count);
+
+std::string GLShader::s_binaryCachePath = "";
+std::map<std::string, GLShader::SourceFile> GLShader::s_sourceCache;
+
+/// 64-bit FNV-1a hash, continued from 'hash'.
+static uint64_t hashText(const std::string& text, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash;
+}
 
 GLShader::GLShader()
     : progHandle(0)
@@ -23,7 +45,10 @@ GLShader::GLShader()
     , m_teFileName("")
     , m_fragFileName("")
     , m_compFileName("")
+    , m_tfBufferMode(GL_INTERLEAVED_ATTRIBS)
     , m_type(0)
+    , m_variant(0)
+    , m_isPending(false)
 {
     if (!gladLoadGL()) {
         fprintf(stderr, "GLShader: Failed to initialize GLAD.\n");
@@ -32,6 +57,7 @@ GLShader::GLShader()
 
 GLShader::~GLShader()
 {
+    deleteVariants();
     RemoveAllShaders();
     m_type = 0;
 }
@@ -141,8 +167,20 @@ void GLShader::CreateEmptyProgram()
     progHandle = glCreateProgram();
 }
 
+bool GLShader::BeginReload()
+{
+    deleteVariants();
+    RemoveAllShaders();
+    return beginProgram();
+}
+
 bool GLShader::CreateProgramFromFile()
 {
+    if (automaticLinking) {
+        bool isOkay = beginProgram();
+        return (finishProgram() && isOkay);
+    }
+
     int vf = static_cast<int>(Type::Vert) | static_cast<int>(Type::Frag);
     if (m_type == vf) {
         return CreateProgramFromFile(m_vertFileName.c_str(), m_fragFileName.c_str());
@@ -443,6 +481,11 @@ void GLShader::Release()
     glUseProgram(0);
 }
 
+unsigned int GLShader::GetVariant()
+{
+    return m_variant;
+}
+
 GLint GLShader::GetAttribLocation(const char* attribName)
 {
     return glGetAttribLocation(progHandle, attribName);
@@ -477,6 +520,14 @@ bool GLShader::IsValid()
 
 bool GLShader::Link(FILE* fptr)
 {
+    if (!m_tfVaryings.empty()) {
+        std::vector<const char*> names;
+        for (const std::string& name : m_tfVaryings) {
+            names.push_back(name.c_str());
+        }
+        glTransformFeedbackVaryings(progHandle, static_cast<GLsizei>(names.size()), names.data(), m_tfBufferMode);
+    }
+
     glLinkProgram(progHandle);
     bool status = printProgramInfoLog(fptr);
     glUseProgram(0);
@@ -532,54 +583,37 @@ size_t GLShader::readShaderFromFile(const char* shaderFilename, std::string& sha
 
 GLuint GLShader::createShaderFromFile(const char* shaderFilename, GLenum type, FILE* fptr)
 {
-    if (shaderFilename == nullptr) {
+    TRACE_SCOPE("GLShader::createShaderFromFile");
+    std::string shaderText;
+    if (!preprocessShader(shaderFilename, shaderText, fptr)) {
         return 0;
     }
 
-    std::string shaderText;
-    size_t iShaderLen = readShaderFromFile(shaderFilename, shaderText, fptr);
-    if (iShaderLen == std::string::npos || iShaderLen == 0) {
+    GLuint shader = glCreateShader(type);
+    const char* strShaderVar = shaderText.c_str();
+    GLint iShaderLen = static_cast<GLint>(shaderText.size());
+    glShaderSource(shader, 1, reinterpret_cast<const GLchar**>(&strShaderVar), &iShaderLen);
+    glCompileShader(shader);
+
+    if (!printShaderInfoLog(shader, fptr)) {
+        printShaderText(shaderText, fptr);
         return 0;
     }
+    return shader;
+}
+
+bool GLShader::preprocessShader(const char* shaderFilename, std::string& shaderText, FILE* fptr)
+{
+    if (shaderFilename == nullptr || !readShaderCached(shaderFilename, shaderText, fptr)) {
+        return false;
+    }
 
     // -------------------------------
     //  emulate '#include' directive
     // -------------------------------
-    std::smatch re_match;
-
-#ifdef __APPLE__
-    // really correct?
-    std::regex re_fname("#include\\s*<([A-Za-z_\\.\\/]+)>");
-#else
-    std::regex re_fname("#include\\s*<([A-Za-z\\_\\.\\/]+)>");
-#endif
-
-    std::string nShaderText = shaderText;
-
-    std::string::const_iterator search_start(shaderText.begin());
-    while (std::regex_search(search_start, shaderText.cend(), re_match, re_fname)) {
-        if (re_match.size() > 1) {
-            std::string include_filename = re_match[1];
-            include_filename = myExePath + include_filename;
-
-            std::string include_local_filename = re_match[1];
-            include_local_filename = myLocalPath + include_local_filename;
-            if (FileExists(include_local_filename.c_str())) {
-                include_filename = include_local_filename;
-            }
-
-            std::string include_text;
-            size_t nShaderLen = readShaderFromFile(include_filename.c_str(), include_text);
-            if (nShaderLen != std::string::npos && nShaderLen > 0) {
-                nShaderText
-                    = std::regex_replace(nShaderText, re_fname, include_text, std::regex_constants::format_first_only);
-                iShaderLen += nShaderLen;
-            }
-        }
-        search_start = re_match.suffix().first;
+    if (!expandIncludes(shaderText, 0, fptr)) {
+        return false;
     }
-
-    shaderText = nShaderText;
     // fprintf(stderr, "\n********************\n%s", shaderText.c_str());
 
     // -------------------------------
@@ -594,36 +628,105 @@ GLuint GLShader::createShaderFromFile(const char* shaderFilename, GLenum type, F
             if (pos != std::string::npos) {
                 shaderText.replace(pos, phText.length(), subsText);
                 pos += phText.length();
-                iShaderLen = shaderText.size();
             }
         }
     }
 
+    // -------------------------------
+    //  insert variant defines
+    // -------------------------------
+    // Placeholders are replaced in place, but defines must precede the included
+    // code and #extension directives, hence they follow #version directly.
+    if (!m_defineText.empty()) {
+        size_t pos = shaderText.find("#version");
+        pos = (pos != std::string::npos ? shaderText.find('\n', pos) : pos);
+        if (pos != std::string::npos) {
+            shaderText.insert(pos + 1, m_defineText + "\n");
+        }
+        else {
+            shaderText = m_defineText + "\n" + shaderText;
+        }
+    }
+
     // -------------------------------
     //  prepend header
     // -------------------------------
     if (!headerText.empty()) {
         shaderText = headerText + "\n" + shaderText;
     }
-    iShaderLen = shaderText.size();
+    return true;
+}
 
-    GLuint shader = glCreateShader(type);
-    const char* strShaderVar = shaderText.c_str();
-    glShaderSource(shader, 1, reinterpret_cast<const GLchar**>(&strShaderVar), reinterpret_cast<GLint*>(&iShaderLen));
-    glCompileShader(shader);
+bool GLShader::expandIncludes(std::string& shaderText, int depth, FILE* fptr)
+{
+    // includes of includes are expanded as well, up to a small depth to catch cycles
+    const int maxDepth = 8;
+    if (depth > maxDepth) {
+        fprintf(fptr, "Error: #include nested deeper than %d levels.\n", maxDepth);
+        return false;
+    }
 
-    if (!printShaderInfoLog(shader, fptr)) {
-        std::stringstream iss(shaderText);
-        std::string sLine;
-        int lineCounter = 1;
-        fprintf(fptr, "====================================================\n");
-        while (std::getline(iss, sLine)) {
-            fprintf(fptr, "%4d : %s\n", (lineCounter++), sLine.c_str());
+    size_t pos = 0;
+    while ((pos = shaderText.find("#include", pos)) != std::string::npos) {
+        size_t nameStart = shaderText.find_first_not_of(" \t", pos + 8);
+        size_t nameEnd = (nameStart != std::string::npos && shaderText[nameStart] == '<'
+                ? shaderText.find_first_of(">\n", nameStart)
+                : std::string::npos);
+        if (nameEnd == std::string::npos || shaderText[nameEnd] != '>') {
+            pos += 8;
+            continue;
         }
-        fprintf(fptr, "====================================================\n");
-        return 0;
+
+        std::string includeName = shaderText.substr(nameStart + 1, nameEnd - nameStart - 1);
+        std::string includeFilename = myLocalPath + includeName;
+        if (!FileExists(includeFilename.c_str())) {
+            includeFilename = myExePath + includeName;
+        }
+
+        std::string includeText;
+        if (!readShaderCached(includeFilename.c_str(), includeText, fptr)
+            || !expandIncludes(includeText, depth + 1, fptr)) {
+            return false;
+        }
+        shaderText.replace(pos, nameEnd + 1 - pos, includeText);
+        pos += includeText.size();
     }
-    return shader;
+    return true;
+}
+
+bool GLShader::readShaderCached(const char* shaderFilename, std::string& shaderContent, FILE* fptr)
+{
+    struct stat stat_buf;
+    if (stat(shaderFilename, &stat_buf) != 0) {
+        fprintf(fptr, "Error: GLShader::readShaderCached() ... Cannot open file \"%s\"\n", shaderFilename);
+        return false;
+    }
+
+    // files are only read again after they were modified, e.g. when editing shaders at runtime
+    auto itr = s_sourceCache.find(shaderFilename);
+    if (itr != s_sourceCache.end() && itr->second.mtime == stat_buf.st_mtime) {
+        shaderContent = itr->second.text;
+        return true;
+    }
+
+    size_t len = readShaderFromFile(shaderFilename, shaderContent, fptr);
+    if (len == std::string::npos || len == 0) {
+        return false;
+    }
+    s_sourceCache[shaderFilename] = { stat_buf.st_mtime, shaderContent };
+    return true;
+}
+
+void GLShader::printShaderText(const std::string& shaderText, FILE* fptr)
+{
+    std::stringstream iss(shaderText);
+    std::string sLine;
+    int lineCounter = 1;
+    fprintf(fptr, "====================================================\n");
+    while (std::getline(iss, sLine)) {
+        fprintf(fptr, "%4d : %s\n", (lineCounter++), sLine.c_str());
+    }
+    fprintf(fptr, "====================================================\n");
 }
 
 GLuint GLShader::createShaderFromString(const char* shaderText, const size_t shaderLen, GLenum type, FILE* fptr)
@@ -710,6 +813,163 @@ bool GLShader::printProgramInfoLog(FILE* fptr)
     return (linkStatus == GL_TRUE);
 }
 
+bool GLShader::beginProgram(FILE* fptr)
+{
+    TRACE_SCOPE("GLShader::beginProgram");
+    const Type types[] = { Type::Vert, Type::TCtrl, Type::TEval, Type::Geom, Type::Frag, Type::Comp };
+    const GLenum glTypes[] = { GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER,
+        GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER };
+
+    m_stages.clear();
+    m_isPending = false;
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (Has(types[i])) {
+            Stage stage = { glTypes[i], "", 0 };
+            if (!preprocessShader(GetFileName(types[i]), stage.text, fptr)) {
+                m_stages.clear();
+                return false;
+            }
+            m_stages.push_back(stage);
+        }
+    }
+    if (m_stages.empty()) {
+        return false;
+    }
+
+    m_binaryFilename.clear();
+    if (!s_binaryCachePath.empty()) {
+        m_binaryFilename = binaryCacheFilename();
+        if (loadProgramBinary(m_binaryFilename)) {
+            m_stages.clear();
+            return true;
+        }
+    }
+
+    // Compile and link without querying the status, so that the driver may work in the background.
+    progHandle = glCreateProgram();
+    for (Stage& stage : m_stages) {
+        const char* text = stage.text.c_str();
+        GLint len = static_cast<GLint>(stage.text.size());
+        stage.shader = glCreateShader(stage.type);
+        glShaderSource(stage.shader, 1, &text, &len);
+        glCompileShader(stage.shader);
+        glAttachShader(progHandle, stage.shader);
+    }
+
+    if (!m_binaryFilename.empty()) {
+        glProgramParameteri(progHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    if (!m_tfVaryings.empty()) {
+        std::vector<const char*> names;
+        for (const std::string& name : m_tfVaryings) {
+            names.push_back(name.c_str());
+        }
+        glTransformFeedbackVaryings(progHandle, static_cast<GLsizei>(names.size()), names.data(), m_tfBufferMode);
+    }
+    glLinkProgram(progHandle);
+    m_isPending = true;
+    return true;
+}
+
+bool GLShader::finishProgram(FILE* fptr)
+{
+    if (!m_isPending) {
+        return IsValid();
+    }
+    TRACE_SCOPE("GLShader::finishProgram");
+    m_isPending = false;
+
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(progHandle, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus != GL_TRUE) {
+        for (const Stage& stage : m_stages) {
+            if (!printShaderInfoLog(stage.shader, fptr)) {
+                printShaderText(stage.text, fptr);
+            }
+        }
+        printProgramInfoLog(fptr);
+        m_stages.clear();
+        return false;
+    }
+
+    if (!m_binaryFilename.empty()) {
+        saveProgramBinary(m_binaryFilename);
+    }
+    m_stages.clear();
+    return true;
+}
+
+std::string GLShader::binaryCacheFilename()
+{
+    // the binary depends on the driver as well as on the sources
+    uint64_t hash = hashText(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    hash = hashText(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), hash);
+    hash = hashText(reinterpret_cast<const char*>(glGetString(GL_VERSION)), hash);
+    for (const Stage& stage : m_stages) {
+        hash = hashText(std::to_string(stage.type), hash);
+        hash = hashText(stage.text, hash);
+    }
+    for (const std::string& name : m_tfVaryings) {
+        hash = hashText(name, hash);
+    }
+    hash = hashText(std::to_string(m_tfBufferMode), hash);
+
+    char filename[32];
+    snprintf(filename, sizeof(filename), "%016llx.bin", static_cast<unsigned long long>(hash));
+    return s_binaryCachePath + filename;
+}
+
+bool GLShader::loadProgramBinary(const std::string& filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    GLenum format = 0;
+    in.read(reinterpret_cast<char*>(&format), sizeof(format));
+    if (!in) {
+        return false;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.empty()) {
+        return false;
+    }
+
+    // A binary of an outdated driver is rejected by glProgramBinary, the program is then compiled again.
+    progHandle = glCreateProgram();
+    glProgramBinary(progHandle, format, data.data(), static_cast<GLsizei>(data.size()));
+
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(progHandle, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus != GL_TRUE) {
+        glDeleteProgram(progHandle);
+        progHandle = 0;
+        return false;
+    }
+    return true;
+}
+
+void GLShader::saveProgramBinary(const std::string& filename)
+{
+    GLint len = 0;
+    glGetProgramiv(progHandle, GL_PROGRAM_BINARY_LENGTH, &len);
+    if (len <= 0) {
+        return;
+    }
+
+    std::vector<char> data(static_cast<size_t>(len));
+    GLenum format = 0;
+    glGetProgramBinary(progHandle, len, nullptr, &format, data.data());
+
+    std::ofstream out(filename, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!out) {
+        fprintf(stderr, "Cannot write program binary '%s'.\n", filename.c_str());
+    }
+}
+
 void GLShader::setFlag(Type type)
 {
     int iflag = static_cast<int>(type);
@@ -740,10 +1000,117 @@ void GLShader::RemoveAllShaders()
     progHandle = 0;
 }
 
+bool GLShader::EnableParallelCompile(GLADloadproc getProc)
+{
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+    const char* procName = nullptr;
+    for (GLint i = 0; i < numExtensions && procName == nullptr; i++) {
+        const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (strcmp(ext, "GL_KHR_parallel_shader_compile") == 0) {
+            procName = "glMaxShaderCompilerThreadsKHR";
+        }
+        else if (strcmp(ext, "GL_ARB_parallel_shader_compile") == 0) {
+            procName = "glMaxShaderCompilerThreadsARB";
+        }
+    }
+
+    auto maxThreads = (procName != nullptr && getProc != nullptr
+            ? reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_GRPR>(getProc(procName))
+            : nullptr);
+    if (maxThreads == nullptr) {
+        return false;
+    }
+
+    // 0xFFFFFFFF lets the driver choose the number of threads
+    maxThreads(0xFFFFFFFFu);
+    return true;
+}
+
+bool GLShader::FinishReload()
+{
+    return finishProgram();
+}
+
 bool GLShader::ReloadShaders()
 {
-    RemoveAllShaders();
-    return CreateProgramFromFile();
+    TRACE_SCOPE("GLShader::ReloadShaders");
+    bool isOkay = BeginReload();
+    return (FinishReload() && isOkay);
+}
+
+void GLShader::SetBinaryCachePath(const char* path)
+{
+    s_binaryCachePath.clear();
+    if (path == nullptr || path[0] == '\0') {
+        return;
+    }
+
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if (numFormats <= 0) {
+        fprintf(stderr, "Driver does not support program binaries, shader cache disabled.\n");
+        return;
+    }
+
+    if (!DirExists(path)) {
+#ifdef _WIN32
+        _mkdir(path);
+#else
+        mkdir(path, 0755);
+#endif
+    }
+    if (!DirExists(path)) {
+        fprintf(stderr, "Cannot create shader cache '%s'.\n", path);
+        return;
+    }
+    s_binaryCachePath = std::string(path) + "/";
+}
+
+bool GLShader::SelectVariant(unsigned int key, const std::string& defines)
+{
+    if (key == m_variant) {
+        return IsValid();
+    }
+
+    // the current program is kept in the cache, the base program as well
+    m_variants[m_variant] = progHandle;
+
+    auto itr = m_variants.find(key);
+    if (itr != m_variants.end()) {
+        progHandle = itr->second;
+        m_variant = key;
+        return IsValid();
+    }
+
+    TRACE_SCOPE("GLShader::SelectVariant");
+    progHandle = 0;
+    m_defineText = defines;
+    bool isOkay = CreateProgramFromFile();
+    m_defineText.clear();
+
+    m_variants[key] = progHandle;
+    m_variant = key;
+    return isOkay;
+}
+
+void GLShader::deleteVariants()
+{
+    m_variants[m_variant] = progHandle;
+    GLuint baseHandle = m_variants[0];
+
+    for (auto itr = m_variants.begin(); itr != m_variants.end(); ++itr) {
+        if (itr->first != 0) {
+            progHandle = itr->second;
+            RemoveAllShaders();
+        }
+    }
+    m_variants.clear();
+
+    // the base program is deleted by RemoveAllShaders
+    progHandle = baseHandle;
+    m_variant = 0;
 }
 
 void GLShader::ClearSubsStrings()
@@ -774,6 +1141,12 @@ void GLShader::SetAutomaticLinking(bool autoLinking)
     automaticLinking = autoLinking;
 }
 
+void GLShader::SetTransformFeedbackVaryings(const std::vector<std::string>& varyings, GLenum bufferMode)
+{
+    m_tfVaryings = varyings;
+    m_tfBufferMode = bufferMode;
+}
+
 bool GLShader::SetFloat(const char* uniformName, float val)
 {
     GLint loc = this->GetUniformLocation(uniformName);
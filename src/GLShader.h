@@ -11,8 +11,11 @@
 
 #include <cstdio>
 #include <cstring>
+#include <ctime>
 #include <iostream>
 #include <map>
+#include <string>
+#include <vector>
 
 class GLShader
 {
@@ -92,6 +95,15 @@ public:
     /// Bind shader program.
     bool Bind();
 
+    /**
+     * @brief Start rebuilding the program from its shader files without waiting.
+     *   Compilation and linking are only issued; with parallel shader compilation
+     *   the driver works in the background until FinishReload is called. Start
+     *   all programs before finishing the first one.
+     * @return false if a shader file could not be read.
+     */
+    bool BeginReload();
+
     /**
      * @brief Bind shader program attribute location.
      * @param attribIndex   Index of attribute.
@@ -238,6 +250,21 @@ public:
         const size_t tcShaderLen, const char* teShaderText, const size_t teShaderLen, const char* gShaderText,
         const size_t gShaderLen, const char* fShaderText, const size_t fShaderLen, FILE* fptr = stderr);
 
+    /**
+     * @brief Let the driver compile shaders on several threads.
+     *   Uses KHR_parallel_shader_compile or ARB_parallel_shader_compile, which
+     *   only pays off together with BeginReload/FinishReload.
+     * @param getProc  Function loader of the context, e.g. glfwGetProcAddress.
+     * @return false if neither extension is available.
+     */
+    static bool EnableParallelCompile(GLADloadproc getProc);
+
+    /**
+     * @brief Wait for the program started by BeginReload and report errors.
+     * @return true if the program is valid.
+     */
+    bool FinishReload();
+
     /**
      * @brief GetAttribLocation
      * @param attribName
@@ -262,6 +289,9 @@ public:
      */
     GLint GetUniformLocation(const char* name);
 
+    /// Get key of the current program variant, see SelectVariant.
+    unsigned int GetVariant();
+
     /// Check if particular shader is available.
     bool Has(Type type);
 
@@ -300,6 +330,19 @@ public:
      */
     void Release();
 
+    /**
+     * @brief Make a program variant the current program.
+     *   A variant is built from the same shader files, but with 'defines' inserted
+     *   right after the '#version' line of every shader. It is built on first use
+     *   and cached under its key until the shaders are reloaded. Uniforms belong to
+     *   the variant and have to be set after selecting it. Key 0 is the program
+     *   without defines, which is built by CreateProgramFromFile.
+     * @param key      Feature bitmask identifying the variant.
+     * @param defines  Preprocessor lines of the variant, only used to build it.
+     * @return false if the variant could not be built.
+     */
+    bool SelectVariant(unsigned int key, const std::string& defines);
+
     void ClearSubsStrings();
 
     /**
@@ -314,6 +357,23 @@ public:
 
     void SetAutomaticLinking(bool autoLinking);
 
+    /**
+     * @brief Set directory of the program binary cache, an empty path disables it.
+     *   Programs built from files are stored there, keyed by a hash of their
+     *   preprocessed sources and the driver, and later loaded via glProgramBinary
+     *   instead of being compiled. Needs a current context.
+     * @param path  Directory, which is created if necessary.
+     */
+    static void SetBinaryCachePath(const char* path);
+
+    /**
+     * @brief Set output variables to be captured by transform feedback.
+     *   Takes effect the next time the program is linked.
+     * @param varyings    Names of output variables of the last vertex processing stage.
+     * @param bufferMode  GL_INTERLEAVED_ATTRIBS or GL_SEPARATE_ATTRIBS.
+     */
+    void SetTransformFeedbackVaryings(const std::vector<std::string>& varyings, GLenum bufferMode = GL_INTERLEAVED_ATTRIBS);
+
     /**
      * @brief Set uniform float value.
      * @param uniformName  Name of uniform variable.
@@ -524,6 +584,36 @@ protected:
      */
     GLuint createShaderFromString(const char* shaderText, const size_t shaderLen, GLenum type, FILE* fptr = stderr);
 
+    /**
+     * @brief Read shader file and expand includes, substitutions, defines, and header.
+     * @param shaderFilename  Filename of shader.
+     * @param shaderText  Preprocessed shader text.
+     * @param fptr  File pointer for log messages.
+     */
+    bool preprocessShader(const char* shaderFilename, std::string& shaderText, FILE* fptr = stderr);
+
+    /// Replace '#include <file>' directives by the file contents.
+    bool expandIncludes(std::string& shaderText, int depth, FILE* fptr);
+
+    /// Read shader file, unchanged files are taken from the source cache.
+    bool readShaderCached(const char* shaderFilename, std::string& shaderContent, FILE* fptr);
+
+    /// Print shader text with line numbers.
+    void printShaderText(const std::string& shaderText, FILE* fptr);
+
+    /**
+     * @brief Issue compilation and linking of the program from its shader files.
+     *   A program found in the binary cache is loaded instead.
+     */
+    bool beginProgram(FILE* fptr = stderr);
+
+    /// Wait for linking, report errors, and store the program in the binary cache.
+    bool finishProgram(FILE* fptr = stderr);
+
+    std::string binaryCacheFilename();
+    bool loadProgramBinary(const std::string& filename);
+    void saveProgramBinary(const std::string& filename);
+
     /// Get Name of shader type.
     const char* getShaderTypeName(GLint shaderType);
 
@@ -552,6 +642,24 @@ protected:
 
     void setFlag(Type type);
 
+    /// Delete all program variants except for the base program.
+    void deleteVariants();
+
+    /// Preprocessed shader of a program that is being built.
+    struct Stage
+    {
+        GLenum type;
+        std::string text;
+        GLuint shader;
+    };
+
+    /// Shader file contents by filename and modification time.
+    struct SourceFile
+    {
+        time_t mtime;
+        std::string text;
+    };
+
 private:
 #ifdef _WIN32
 #pragma warning(push)
@@ -561,6 +669,7 @@ private:
     bool automaticLinking;
 
     std::string headerText;
+    std::string m_defineText;
     std::map<std::string, std::string> subsStrings;
     std::map<std::string, std::string>::iterator subsStringsItr;
     std::string myExePath;
@@ -573,8 +682,23 @@ private:
     std::string m_fragFileName;
     std::string m_compFileName;
 
+    std::vector<std::string> m_tfVaryings;
+    GLenum m_tfBufferMode;
+
     /// Bit-field representing currently set shaders
     int m_type;
+
+    /// Program variants by feature key, key 0 is the base program.
+    std::map<unsigned int, GLuint> m_variants;
+    unsigned int m_variant;
+
+    /// Shaders between BeginReload and FinishReload.
+    std::vector<Stage> m_stages;
+    bool m_isPending;
+    std::string m_binaryFilename;
+
+    static std::string s_binaryCachePath;
+    static std::map<std::string, SourceFile> s_sourceCache;
 };
 
 #endif // GRPR_SHADER_H
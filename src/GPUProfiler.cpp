@@ -0,0 +1,318 @@
+/**
+ * File:    GPUProfiler.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "GPUProfiler.h"
+
+#include <cstdio>
+#include <cstring>
+
+const char* const GPUProfiler::PassNames[]
+    = {"projection", "order0", "order1", "lighting", "blackhole", "overlays", "panorama", "warp"};
+
+const char* const GPUProfiler::StatNames[]
+    = {"primitives", "tes_invocations", "gs_primitives", "fs_invocations"};
+
+static const GLenum statTargets[] = {GL_PRIMITIVES_GENERATED, GL_TESS_EVALUATION_SHADER_INVOCATIONS,
+    GL_GEOMETRY_SHADER_PRIMITIVES_EMITTED, GL_FRAGMENT_SHADER_INVOCATIONS};
+
+static bool hasPipelineStatsExtension()
+{
+    GLint numExt = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExt);
+    for (GLint i = 0; i < numExt; i++) {
+        const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (ext != nullptr && strcmp(ext, "GL_ARB_pipeline_statistics_query") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+GPUProfiler::GPUProfiler()
+    : m_currSet(0)
+    , m_frame(0)
+    , m_enabled(false)
+    , m_inFrame(false)
+    , m_isInitialized(false)
+    , m_hasPipelineStats(false)
+    , m_historySize(256)
+    , m_historyPos(0)
+{
+    memset(m_queries, 0, sizeof(m_queries));
+    memset(m_issued, 0, sizeof(m_issued));
+    m_setFrame[0] = m_setFrame[1] = 0;
+}
+
+GPUProfiler::~GPUProfiler()
+{
+    Release();
+}
+
+bool GPUProfiler::Init()
+{
+    Release();
+
+    // Pipeline statistics queries are core since OpenGL 4.6, older contexts may expose
+    // ARB_pipeline_statistics_query with the same enums.
+    m_hasPipelineStats = (GLAD_GL_VERSION_4_6 != 0 || hasPipelineStatsExtension());
+
+    glGenQueries(2 * NumPasses * (1 + NumStats), &m_queries[0][0][0]);
+    m_isInitialized = (glGetError() == GL_NO_ERROR);
+    return m_isInitialized;
+}
+
+void GPUProfiler::Release()
+{
+    if (m_isInitialized && glDeleteQueries != nullptr) {
+        glDeleteQueries(2 * NumPasses * (1 + NumStats), &m_queries[0][0][0]);
+    }
+    memset(m_queries, 0, sizeof(m_queries));
+    memset(m_issued, 0, sizeof(m_issued));
+    m_isInitialized = false;
+}
+
+void GPUProfiler::BeginFrame()
+{
+    if (!m_enabled || !m_isInitialized) {
+        return;
+    }
+
+    // The query objects of this set were issued two frames ago.
+    m_currSet = static_cast<int>(m_frame % 2);
+    collect(m_currSet);
+    m_setFrame[m_currSet] = m_frame;
+    m_inFrame = true;
+}
+
+void GPUProfiler::EndFrame()
+{
+    if (!m_inFrame) {
+        return;
+    }
+    m_inFrame = false;
+    m_frame++;
+}
+
+void GPUProfiler::BeginPass(Pass pass)
+{
+    if (!m_inFrame) {
+        return;
+    }
+
+    int p = static_cast<int>(pass);
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_currSet][p][0]);
+    for (int s = 0; s < NumStats; s++) {
+        if (s > 0 && !m_hasPipelineStats) {
+            break;
+        }
+        glBeginQuery(statTargets[s], m_queries[m_currSet][p][1 + s]);
+    }
+}
+
+void GPUProfiler::EndPass(Pass pass)
+{
+    if (!m_inFrame) {
+        return;
+    }
+
+    int p = static_cast<int>(pass);
+    glEndQuery(GL_TIME_ELAPSED);
+    for (int s = 0; s < NumStats; s++) {
+        if (s > 0 && !m_hasPipelineStats) {
+            break;
+        }
+        glEndQuery(statTargets[s]);
+    }
+    m_issued[m_currSet][p] = true;
+}
+
+bool GPUProfiler::IsEnabled()
+{
+    return m_enabled;
+}
+
+void GPUProfiler::SetEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (!m_enabled) {
+        memset(m_issued, 0, sizeof(m_issued));
+        m_inFrame = false;
+    }
+}
+
+bool GPUProfiler::HasPipelineStatistics()
+{
+    return m_hasPipelineStats;
+}
+
+double GPUProfiler::GetTime(Pass pass)
+{
+    if (m_history.empty()) {
+        return 0.0;
+    }
+
+    int p = static_cast<int>(pass);
+    double sum = 0.0;
+    for (const FrameResult& res : m_history) {
+        sum += res.timeMS[p];
+    }
+    return sum / static_cast<double>(m_history.size());
+}
+
+double GPUProfiler::GetStat(Pass pass, Stat stat)
+{
+    if (m_history.empty()) {
+        return 0.0;
+    }
+
+    int p = static_cast<int>(pass);
+    int s = static_cast<int>(stat);
+    double sum = 0.0;
+    for (const FrameResult& res : m_history) {
+        sum += static_cast<double>(res.stats[p][s]);
+    }
+    return sum / static_cast<double>(m_history.size());
+}
+
+size_t GPUProfiler::GetNumFrames()
+{
+    return m_history.size();
+}
+
+void GPUProfiler::SetHistorySize(size_t numFrames)
+{
+    m_historySize = (numFrames > 0 ? numFrames : 1);
+    m_history.clear();
+    m_historyPos = 0;
+}
+
+bool GPUProfiler::WriteCSV(const char* filename)
+{
+    FILE* fptr = nullptr;
+#ifdef _WIN32
+    fopen_s(&fptr, filename, "w");
+#else
+    fptr = fopen(filename, "w");
+#endif
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot open file '%s' for writing.\n", filename);
+        return false;
+    }
+
+    fprintf(fptr, "frame,pass,time_ms");
+    for (int s = 0; s < NumStats; s++) {
+        fprintf(fptr, ",%s", StatNames[s]);
+    }
+    fprintf(fptr, "\n");
+
+    size_t num = m_history.size();
+    size_t start = (num < m_historySize ? 0 : m_historyPos);
+    for (size_t i = 0; i < num; i++) {
+        const FrameResult& res = m_history[(start + i) % num];
+        for (int p = 0; p < NumPasses; p++) {
+            fprintf(fptr, "%llu,%s,%.6f", static_cast<unsigned long long>(res.frame), PassNames[p], res.timeMS[p]);
+            for (int s = 0; s < NumStats; s++) {
+                fprintf(fptr, ",%llu", static_cast<unsigned long long>(res.stats[p][s]));
+            }
+            fprintf(fptr, "\n");
+        }
+    }
+
+    fclose(fptr);
+    fprintf(stderr, "GPU profile written to '%s'.\n", filename);
+    return true;
+}
+
+bool GPUProfiler::WriteJSON(const char* filename)
+{
+    FILE* fptr = nullptr;
+#ifdef _WIN32
+    fopen_s(&fptr, filename, "w");
+#else
+    fptr = fopen(filename, "w");
+#endif
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot open file '%s' for writing.\n", filename);
+        return false;
+    }
+
+    fprintf(fptr, "{\n  \"pipelineStatistics\": %s,\n", (m_hasPipelineStats ? "true" : "false"));
+    fprintf(fptr, "  \"numFrames\": %zu,\n", m_history.size());
+
+    fprintf(fptr, "  \"average\": {\n");
+    for (int p = 0; p < NumPasses; p++) {
+        Pass pass = static_cast<Pass>(p);
+        fprintf(fptr, "    \"%s\": { \"time_ms\": %.6f", PassNames[p], GetTime(pass));
+        for (int s = 0; s < NumStats; s++) {
+            fprintf(fptr, ", \"%s\": %.1f", StatNames[s], GetStat(pass, static_cast<Stat>(s)));
+        }
+        fprintf(fptr, " }%s\n", (p < NumPasses - 1 ? "," : ""));
+    }
+    fprintf(fptr, "  },\n");
+
+    fprintf(fptr, "  \"frames\": [\n");
+    size_t num = m_history.size();
+    size_t start = (num < m_historySize ? 0 : m_historyPos);
+    for (size_t i = 0; i < num; i++) {
+        const FrameResult& res = m_history[(start + i) % num];
+        fprintf(fptr, "    { \"frame\": %llu", static_cast<unsigned long long>(res.frame));
+        for (int p = 0; p < NumPasses; p++) {
+            fprintf(fptr, ", \"%s\": { \"time_ms\": %.6f", PassNames[p], res.timeMS[p]);
+            for (int s = 0; s < NumStats; s++) {
+                fprintf(fptr, ", \"%s\": %llu", StatNames[s], static_cast<unsigned long long>(res.stats[p][s]));
+            }
+            fprintf(fptr, " }");
+        }
+        fprintf(fptr, " }%s\n", (i < num - 1 ? "," : ""));
+    }
+    fprintf(fptr, "  ]\n}\n");
+
+    fclose(fptr);
+    fprintf(stderr, "GPU profile written to '%s'.\n", filename);
+    return true;
+}
+
+void GPUProfiler::collect(int set)
+{
+    bool anyIssued = false;
+    for (int p = 0; p < NumPasses; p++) {
+        anyIssued |= m_issued[set][p];
+    }
+    if (!anyIssued) {
+        return;
+    }
+
+    FrameResult res;
+    memset(&res, 0, sizeof(FrameResult));
+    res.frame = m_setFrame[set];
+
+    GLuint64 value = 0;
+    for (int p = 0; p < NumPasses; p++) {
+        if (!m_issued[set][p]) {
+            continue;
+        }
+
+        glGetQueryObjectui64v(m_queries[set][p][0], GL_QUERY_RESULT, &value);
+        res.timeMS[p] = static_cast<double>(value) * 1e-6;
+
+        for (int s = 0; s < NumStats; s++) {
+            if (s > 0 && !m_hasPipelineStats) {
+                break;
+            }
+            glGetQueryObjectui64v(m_queries[set][p][1 + s], GL_QUERY_RESULT, &value);
+            res.stats[p][s] = static_cast<uint64_t>(value);
+        }
+        m_issued[set][p] = false;
+    }
+
+    if (m_history.size() < m_historySize) {
+        m_history.push_back(res);
+    }
+    else {
+        m_history[m_historyPos] = res;
+        m_historyPos = (m_historyPos + 1) % m_historySize;
+    }
+}
@@ -0,0 +1,103 @@
+/**
+ * File:    GPUProfiler.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_GPU_PROFILER_H
+#define GRPR_GPU_PROFILER_H
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief GPU timer and pipeline-statistics queries per render pass.
+ *
+ *   Each pass is enclosed by BeginPass()/EndPass(). The queries are
+ *   double-buffered: the results of a frame are read back two frames later
+ *   when the query objects are reused, so the CPU never waits for the GPU.
+ */
+class GPUProfiler
+{
+public:
+    enum class Pass : int { Projection = 0, Order0, Order1, Lighting, BlackHole, Overlays, Panorama, Warp, Count };
+    enum class Stat : int { Primitives = 0, TessEvalInvocations, GeomPrimitives, FragInvocations, Count };
+
+    static const char* const PassNames[];
+    static const char* const StatNames[];
+
+    static const int NumPasses = static_cast<int>(Pass::Count);
+    static const int NumStats = static_cast<int>(Stat::Count);
+
+    struct FrameResult
+    {
+        uint64_t frame;
+        double timeMS[NumPasses];
+        uint64_t stats[NumPasses][NumStats];
+    };
+
+public:
+    GPUProfiler();
+    ~GPUProfiler();
+
+    /// Create query objects. Needs a valid OpenGL context.
+    bool Init();
+
+    /// Delete query objects.
+    void Release();
+
+    void BeginFrame();
+    void EndFrame();
+
+    void BeginPass(Pass pass);
+    void EndPass(Pass pass);
+
+    bool IsEnabled();
+    void SetEnabled(bool enabled);
+
+    /// Check whether pipeline statistics queries are available (OpenGL 4.6 or ARB_pipeline_statistics_query).
+    bool HasPipelineStatistics();
+
+    /// Get time of pass averaged over the frame history [ms].
+    double GetTime(Pass pass);
+
+    /// Get statistics value of pass averaged over the frame history.
+    double GetStat(Pass pass, Stat stat);
+
+    /// Get number of frames in the history.
+    size_t GetNumFrames();
+
+    void SetHistorySize(size_t numFrames);
+
+    /// Write frame history as comma separated values, one line per frame and pass.
+    bool WriteCSV(const char* filename);
+
+    /// Write averages and frame history as JSON.
+    bool WriteJSON(const char* filename);
+
+protected:
+    void collect(int set);
+
+protected:
+    // query objects: [set][pass][0] timer, [set][pass][1+stat] statistics
+    GLuint m_queries[2][NumPasses][1 + NumStats];
+    bool m_issued[2][NumPasses];
+    uint64_t m_setFrame[2];
+
+    int m_currSet;
+    uint64_t m_frame;
+
+    bool m_enabled;
+    bool m_inFrame;
+    bool m_isInitialized;
+    bool m_hasPipelineStats;
+
+    std::vector<FrameResult> m_history;
+    size_t m_historySize;
+    size_t m_historyPos;
+};
+
+#endif // GRPR_GPU_PROFILER_H
@@ -0,0 +1,266 @@
+/**
+ * File:    GRProjector.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "GRProjector.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+// must match 'local_size_x' of the compute shaders
+constexpr unsigned int WorkGroupSize = 256;
+constexpr unsigned int MaxNumWorkGroups = 65535;
+
+static GLuint numWorkGroups(unsigned int num)
+{
+    return std::max(1u, std::min((num + WorkGroupSize - 1) / WorkGroupSize, MaxNumWorkGroups));
+}
+
+GRProjector::GRProjector()
+    : m_apparentPosBuf(0)
+    , m_edgeMetricBuf(0)
+    , m_edgeBuf(0)
+    , m_triEdgeBuf(0)
+    , m_numEdges(0)
+    , m_numVertices(0)
+    , m_numTriangles(0)
+    , m_isValid(false)
+{
+    memset(&m_params, 0, sizeof(m_params));
+}
+
+GRProjector::~GRProjector()
+{
+    //
+}
+
+void GRProjector::Bind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ApparentPosBinding, m_apparentPosBuf);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EdgeMetricBinding, m_edgeMetricBuf);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TriangleEdgeBinding, m_triEdgeBuf);
+}
+
+void GRProjector::Delete()
+{
+    deleteBuffers();
+    deleteEdges();
+}
+
+void GRProjector::Init()
+{
+    std::string myPath = std::string(".");
+    m_shaderProject.SetFileName(GLShader::Type::Comp, "shader/grpr_project.comp");
+    m_shaderProject.SetLocalPath(myPath.c_str());
+
+    m_shaderTessMetric.SetFileName(GLShader::Type::Comp, "shader/grpr_tessmetric.comp");
+    m_shaderTessMetric.SetLocalPath(myPath.c_str());
+}
+
+void GRProjector::Invalidate()
+{
+    m_isValid = false;
+}
+
+bool GRProjector::ReloadShaders()
+{
+    m_isValid = false;
+    bool isOkay = true;
+    isOkay &= m_shaderProject.BeginReload();
+    isOkay &= m_shaderTessMetric.BeginReload();
+    isOkay &= m_shaderProject.FinishReload();
+    isOkay &= m_shaderTessMetric.FinishReload();
+    return isOkay;
+}
+
+void GRProjector::SetEdges(const unsigned int* indices, unsigned int numIndices)
+{
+    TRACE_SCOPE("GRProjector::SetEdges");
+    deleteEdges();
+    if (indices == nullptr || numIndices < 3) {
+        return;
+    }
+
+    unsigned int numTriangles = numIndices / 3;
+    std::vector<GLuint> edges;
+    std::vector<GLuint> triEdges(3 * numTriangles);
+    edges.reserve(3 * numTriangles);
+
+    // Edges are undirected: key is (smaller index, larger index).
+    std::unordered_map<uint64_t, GLuint> edgeMap;
+    edgeMap.reserve(2 * numTriangles);
+
+    for (unsigned int t = 0; t < numTriangles; t++) {
+        for (unsigned int k = 0; k < 3; k++) {
+            GLuint i1 = indices[3 * t + k];
+            GLuint i2 = indices[3 * t + (k + 1) % 3];
+            uint64_t key = (static_cast<uint64_t>(std::min(i1, i2)) << 32) | std::max(i1, i2);
+
+            auto res = edgeMap.insert(std::make_pair(key, static_cast<GLuint>(edges.size() / 2)));
+            if (res.second) {
+                edges.push_back(std::min(i1, i2));
+                edges.push_back(std::max(i1, i2));
+            }
+            triEdges[3 * t + k] = res.first->second;
+        }
+    }
+    m_numEdges = static_cast<unsigned int>(edges.size() / 2);
+
+    glGenBuffers(1, &m_edgeBuf);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_edgeBuf);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * edges.size(), edges.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &m_triEdgeBuf);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_triEdgeBuf);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * triEdges.size(), triEdges.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // the edge metric buffer depends on the number of edges
+    deleteBuffers();
+}
+
+bool GRProjector::Project(VertexArray& va, const float* modelMX, float obsCamPos, float xmin, float xscale,
+    int lutTexUnit0, int lutTexUnit1, int lutFilter, int lutLayout, const float* obsViewProjMX)
+{
+    Params params;
+    memset(&params, 0, sizeof(params));
+    memcpy(params.modelMX, modelMX, sizeof(params.modelMX));
+    if (obsViewProjMX != nullptr) {
+        memcpy(params.obsViewProjMX, obsViewProjMX, sizeof(params.obsViewProjMX));
+    }
+    params.obsCamPos = obsCamPos;
+    params.xmin = xmin;
+    params.xscale = xscale;
+    params.lutTexUnit[0] = lutTexUnit0;
+    params.lutTexUnit[1] = lutTexUnit1;
+    params.lutFilter = lutFilter;
+    params.lutLayout = lutLayout;
+    params.withTessMetric = (obsViewProjMX != nullptr ? 1 : 0);
+
+    unsigned int numTriangles = va.GetNumElements() / 3;
+    if (m_isValid && va.GetNumVertices() == m_numVertices && numTriangles == m_numTriangles
+        && memcmp(&params, &m_params, sizeof(params)) == 0) {
+        return false;
+    }
+
+    TRACE_SCOPE("GRProjector::Project");
+    resize(va.GetNumVertices(), numTriangles);
+    m_params = params;
+    m_isValid = true;
+    if (m_numVertices == 0) {
+        return true;
+    }
+
+    va.BindBufferBase(GL_SHADER_STORAGE_BUFFER, VertexBinding);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ApparentPosBinding, m_apparentPosBuf);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EdgeMetricBinding, m_edgeMetricBuf);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EdgeBinding, m_edgeBuf);
+
+    m_shaderProject.Bind();
+    setLUTUniforms(m_shaderProject, modelMX, obsCamPos, xmin, xscale, lutTexUnit0, lutTexUnit1, lutFilter,
+        lutLayout);
+    glDispatchCompute(numWorkGroups(m_numVertices), 2, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_shaderProject.Release();
+
+    if (obsViewProjMX != nullptr && m_numEdges > 0) {
+        m_shaderTessMetric.Bind();
+        setLUTUniforms(m_shaderTessMetric, modelMX, obsCamPos, xmin, xscale, lutTexUnit0, lutTexUnit1, lutFilter,
+            lutLayout);
+        m_shaderTessMetric.SetFloatMatrix("obsViewProjMX", 4, 1, GL_FALSE, obsViewProjMX);
+        m_shaderTessMetric.SetUInt("numEdges", m_numEdges);
+        glDispatchCompute(numWorkGroups(m_numEdges), 2, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        m_shaderTessMetric.Release();
+    }
+    return true;
+}
+
+unsigned int GRProjector::GetNumEdges()
+{
+    return m_numEdges;
+}
+
+unsigned int GRProjector::GetNumVertices()
+{
+    return m_numVertices;
+}
+
+unsigned int GRProjector::GetNumTriangles()
+{
+    return m_numTriangles;
+}
+
+void GRProjector::deleteBuffers()
+{
+    if (glIsBuffer(m_apparentPosBuf)) {
+        glDeleteBuffers(1, &m_apparentPosBuf);
+    }
+    m_apparentPosBuf = 0;
+
+    if (glIsBuffer(m_edgeMetricBuf)) {
+        glDeleteBuffers(1, &m_edgeMetricBuf);
+    }
+    m_edgeMetricBuf = 0;
+    m_numVertices = m_numTriangles = 0;
+    m_isValid = false;
+}
+
+void GRProjector::deleteEdges()
+{
+    if (glIsBuffer(m_edgeBuf)) {
+        glDeleteBuffers(1, &m_edgeBuf);
+    }
+    if (glIsBuffer(m_triEdgeBuf)) {
+        glDeleteBuffers(1, &m_triEdgeBuf);
+    }
+    m_edgeBuf = m_triEdgeBuf = 0;
+    m_numEdges = 0;
+    m_isValid = false;
+}
+
+void GRProjector::resize(unsigned int numVertices, unsigned int numTriangles)
+{
+    if (numVertices == m_numVertices && numTriangles == m_numTriangles) {
+        return;
+    }
+
+    deleteBuffers();
+    if (numVertices == 0) {
+        return;
+    }
+
+    m_numVertices = numVertices;
+    m_numTriangles = numTriangles;
+
+    glGenBuffers(1, &m_apparentPosBuf);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_apparentPosBuf);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLfloat) * 4 * numVertices, nullptr, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &m_edgeMetricBuf);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_edgeMetricBuf);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLfloat) * std::max(1u, m_numEdges), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GRProjector::setLUTUniforms(GLShader& shader, const float* modelMX, float obsCamPos, float xmin, float xscale,
+    int lutTexUnit0, int lutTexUnit1, int lutFilter, int lutLayout)
+{
+    shader.SetFloatMatrix("modelMX", 4, 1, GL_FALSE, modelMX);
+    shader.SetFloat("obsCamPos", obsCamPos, 0.0f, 0.0f);
+    shader.SetFloat("xmin", xmin);
+    shader.SetFloat("xscale", xscale);
+    shader.SetInt("lutTex0", lutTexUnit0);
+    shader.SetInt("lutTex1", lutTexUnit1);
+    shader.SetInt("lutDeriv0", lutTexUnit0 + 2);
+    shader.SetInt("lutDeriv1", lutTexUnit1 + 2);
+    shader.SetInt("lutFilter", lutFilter);
+    shader.SetInt("lutLayout", lutLayout);
+    shader.SetUInt("numVertices", m_numVertices);
+}
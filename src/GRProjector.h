@@ -0,0 +1,133 @@
+/**
+ * File:    GRProjector.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_GR_PROJECTOR_H
+#define GRPR_GR_PROJECTOR_H
+
+#include "glad/glad.h"
+
+#include "GLShader.h"
+#include "VertexArray.h"
+
+#include <vector>
+
+/**
+ * @brief Compute pre-pass for the GR view modes.
+ *
+ *   Every unique vertex of the object is projected once per image order into
+ *   a shader storage buffer of apparent positions (grpr_project.comp). For the
+ *   adaptive tessellation, the relative deviation of the apparent edge midpoint
+ *   is additionally stored once per unique edge (grpr_tessmetric.comp), such that
+ *   adjacent patches share the same outer tessellation level. The draw stages
+ *   read these buffers instead of evaluating the lookup table themselves.
+ *
+ *   The object's vertex array is read directly: vertex positions have to be
+ *   stored in attribute 0 and the triangle indices in element buffer 'IndexBinding'.
+ *   The edge list has to be set via SetEdges() whenever the indices change.
+ */
+class GRProjector
+{
+public:
+    /// Shader storage binding points, see shader/grpr_project.comp.
+    static const GLuint VertexBinding = 0;
+    static const GLuint IndexBinding = 3;  //!< vertex array slot of the element buffer
+    static const GLuint ApparentPosBinding = 4;
+    static const GLuint EdgeMetricBinding = 5;
+    static const GLuint EdgeBinding = 6;
+    static const GLuint TriangleEdgeBinding = 7;
+
+public:
+    GRProjector();
+    ~GRProjector();
+
+    /// Bind result buffers for the draw stages.
+    void Bind();
+
+    void Delete();
+
+    void Init();
+
+    /// Force re-projection with the next call of Project(), e.g. if the vertices or the LUT changed.
+    void Invalidate();
+
+    bool ReloadShaders();
+
+    /**
+     * @brief Extract unique edges of the triangle mesh.
+     * @param indices     Triangle indices.
+     * @param numIndices  Number of indices.
+     */
+    void SetEdges(const unsigned int* indices, unsigned int numIndices);
+
+    /**
+     * @brief Project vertices for both image orders.
+     *   The lookup table textures have to be bound to texture units
+     *   'lutTexUnit0' and 'lutTexUnit1' beforehand, its derivatives (if any)
+     *   to 'lutTexUnit0' + 2 and 'lutTexUnit1' + 2.
+     *   The results are kept as long as the parameters do not change and
+     *   Invalidate() is not called. The interactive camera is not involved.
+     * @param va             Object vertex array.
+     * @param modelMX        Model matrix.
+     * @param obsCamPos      Radial position of lookup table observer.
+     * @param xmin           Scaled lookup table range, see LUT::GetScaledRange.
+     * @param xscale         Scaled lookup table range.
+     * @param lutTexUnit0    Texture unit of lookup table for order 0.
+     * @param lutTexUnit1    Texture unit of lookup table for order 1.
+     * @param lutFilter      Lookup table filter, see LUT::Filter.
+     * @param lutLayout      Lookup table layout, see LUT::Layout.
+     * @param obsViewProjMX  Projection-view matrix of observer camera for tessellation metrics,
+     *                       or nullptr if no tessellation metrics are needed.
+     * @return true if the buffers were updated.
+     */
+    bool Project(VertexArray& va, const float* modelMX, float obsCamPos, float xmin, float xscale, int lutTexUnit0,
+        int lutTexUnit1, int lutFilter, int lutLayout, const float* obsViewProjMX);
+
+    unsigned int GetNumEdges();
+    unsigned int GetNumVertices();
+    unsigned int GetNumTriangles();
+
+protected:
+    void deleteBuffers();
+    void deleteEdges();
+    void resize(unsigned int numVertices, unsigned int numTriangles);
+    void setLUTUniforms(GLShader& shader, const float* modelMX, float obsCamPos, float xmin, float xscale,
+        int lutTexUnit0, int lutTexUnit1, int lutFilter, int lutLayout);
+
+protected:
+    /// Parameters of the last projection.
+    struct Params
+    {
+        float modelMX[16];
+        float obsViewProjMX[16];
+        float obsCamPos;
+        float xmin;
+        float xscale;
+        int lutTexUnit[2];
+        int lutFilter;
+        int lutLayout;
+        int withTessMetric;
+    };
+
+protected:
+    GLShader m_shaderProject;
+    GLShader m_shaderTessMetric;
+
+    GLuint m_apparentPosBuf;
+    GLuint m_edgeMetricBuf;
+
+    /// Vertex indices per edge and edge indices per triangle.
+    GLuint m_edgeBuf;
+    GLuint m_triEdgeBuf;
+
+    unsigned int m_numEdges;
+    unsigned int m_numVertices;
+    unsigned int m_numTriangles;
+
+    Params m_params;
+    bool m_isValid;
+};
+
+#endif // GRPR_GR_PROJECTOR_H
@@ -5,9 +5,14 @@
  *  This file is part of GRPolygonRender.
  */
 #include "LUT.h"
+#include "Trace.h"
 #include "Utilities.h"
+#include <string>
+#include <vector>
 #include <sys/stat.h>
 
+const char* const LUT::FilterNames[] = { "Bilinear", "Bicubic", "Hermite", "Chebyshev" };
+
 LUT::LUT()
     : m_Nr(0)
     , m_Nphi(0)
@@ -15,8 +20,11 @@ LUT::LUT()
     , m_rmax(0.0f)
     , m_camPos(10.0f)
     , m_data(nullptr)
+    , m_fitBuf(0)
+    , m_layout(Layout::Phi)
 {
     m_texID[0] = m_texID[1] = 0;
+    m_derivTexID[0] = m_derivTexID[1] = 0;
 }
 
 LUT::~LUT()
@@ -29,6 +37,19 @@ float LUT::GetCameraPos()
     return m_camPos;
 }
 
+GLuint LUT::GetDerivTexID(unsigned int idx)
+{
+    if (idx < 2) {
+        return m_derivTexID[idx];
+    }
+    return 0;
+}
+
+GLuint LUT::GetFitBuffer()
+{
+    return m_fitBuf;
+}
+
 void LUT::GetRadialRange(float& rmin, float& rmax)
 {
     rmin = m_rmin;
@@ -50,8 +71,24 @@ GLuint LUT::GetTexID(unsigned int idx)
     return 0;
 }
 
+LUT::Layout LUT::GetLayout()
+{
+    return m_layout;
+}
+
+bool LUT::HasDerivatives()
+{
+    return (m_derivTexID[0] != 0 && m_derivTexID[1] != 0);
+}
+
+bool LUT::HasFit()
+{
+    return (m_fitBuf != 0);
+}
+
 bool LUT::Load(const char* filename)
 {
+    TRACE_SCOPE("LUT::Load");
     size_t headerSize = sizeof(unsigned int) * 2 + sizeof(float) * 3;
 
     if (filename == nullptr) {
@@ -60,11 +97,7 @@ bool LUT::Load(const char* filename)
     }
 
     SafeDelete<float>(m_data);
-    if (glIsTexture(m_texID[0])) {
-        glDeleteTextures(2, m_texID);
-        m_texID[0] = 0;
-        m_texID[1] = 0;
-    }
+    deleteTextures();
 
     size_t fileSizeInBytes = getFileSizeInBytes(filename);
     if (fileSizeInBytes < headerSize) {
@@ -83,9 +116,18 @@ bool LUT::Load(const char* filename)
         return false;
     }
 
-    // read header
+    // read header, tables with a layout other than Phi start with magic number and layout
     bool isOkay = true;
+    m_layout = Layout::Phi;
     isOkay &= (fread(&m_Nr, sizeof(unsigned int), 1, fptr) == 1);
+    if (isOkay && m_Nr == Magic) {
+        unsigned int layout = 0;
+        isOkay &= (fread(&layout, sizeof(unsigned int), 1, fptr) == 1);
+        isOkay &= (layout < static_cast<unsigned int>(Layout::Count));
+        isOkay &= (fread(&m_Nr, sizeof(unsigned int), 1, fptr) == 1);
+        m_layout = static_cast<Layout>(layout);
+        headerSize += 2 * sizeof(unsigned int);
+    }
     isOkay &= (fread(&m_Nphi, sizeof(unsigned int), 1, fptr) == 1);
     isOkay &= (fread(&m_rmin, sizeof(float), 1, fptr) == 1);
     isOkay &= (fread(&m_rmax, sizeof(float), 1, fptr) == 1);
@@ -99,8 +141,11 @@ bool LUT::Load(const char* filename)
 
     size_t numEntries = m_Nr * m_Nphi * 4U;
     size_t dataSizeInBytes = sizeof(float) * numEntries * 2U;
+    // derivatives along azimuth and radius for both orders
+    size_t derivSizeInBytes = sizeof(float) * numEntries * 4U;
 
-    if (dataSizeInBytes + headerSize != fileSizeInBytes) {
+    bool withDerivatives = (dataSizeInBytes + derivSizeInBytes + headerSize == fileSizeInBytes);
+    if (dataSizeInBytes + headerSize != fileSizeInBytes && !withDerivatives) {
         fprintf(stderr, "LUT '%s' has no valid data size!\n", filename);
         fclose(fptr);
         return false;
@@ -109,16 +154,105 @@ bool LUT::Load(const char* filename)
     m_data = new float[numEntries * 2U];
     isOkay &= (fread(m_data, sizeof(float), numEntries * 2U, fptr) == numEntries * 2U);
 
+    float* deriv = nullptr;
+    if (isOkay && withDerivatives) {
+        deriv = new float[numEntries * 4U];
+        isOkay &= (fread(deriv, sizeof(float), numEntries * 4U, fptr) == numEntries * 4U);
+    }
+
     if (isOkay) {
-        fprintf(stderr, "Successfully loaded LUT '%s' (Nr:%d, Nphi:%d).\n", filename, m_Nr, m_Nphi);
+        fprintf(stderr, "Successfully loaded LUT '%s' (Nr:%d, Nphi:%d%s%s).\n", filename, m_Nr, m_Nphi,
+            (withDerivatives ? ", with derivatives" : ""), (m_layout == Layout::CosPhi ? ", cos(phi) layout" : ""));
         m_texID[0] = genRGBAFloatTexture(m_Nphi, m_Nr, m_data);
         m_texID[1] = genRGBAFloatTexture(m_Nphi, m_Nr, &m_data[numEntries]);
+        if (withDerivatives) {
+            m_derivTexID[0] = genRGBAFloatTextureArray(m_Nphi, m_Nr, 2, deriv);
+            m_derivTexID[1] = genRGBAFloatTextureArray(m_Nphi, m_Nr, 2, &deriv[numEntries * 2U]);
+        }
     }
     else {
         fprintf(stderr, "Error reading LUT '%s'\n", filename);
     }
 
+    SafeDelete<float>(deriv);
+    fclose(fptr);
+
+    std::string fitFilename = filename;
+    fitFilename = fitFilename.substr(0, fitFilename.rfind(".dat")) + "_fit.dat";
+    if (isOkay && FileExists(fitFilename.c_str())) {
+        loadFit(fitFilename.c_str());
+    }
+    return true;
+}
+
+void LUT::deleteTextures()
+{
+    if (glIsTexture(m_texID[0])) {
+        glDeleteTextures(2, m_texID);
+    }
+    if (glIsTexture(m_derivTexID[0])) {
+        glDeleteTextures(2, m_derivTexID);
+    }
+    m_texID[0] = m_texID[1] = 0;
+    m_derivTexID[0] = m_derivTexID[1] = 0;
+
+    if (glIsBuffer(m_fitBuf)) {
+        glDeleteBuffers(1, &m_fitBuf);
+    }
+    m_fitBuf = 0;
+}
+
+bool LUT::loadFit(const char* filename)
+{
+    TRACE_SCOPE("LUT::loadFit");
+    FILE* fptr = nullptr;
+#ifdef _WIN32
+    fopen_s(&fptr, filename, "rb");
+#else
+    fptr = fopen(filename, "rb");
+#endif
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot load LUT fit '%s'\n", filename);
+        return false;
+    }
+
+    // header: numBands, degX, degPhi, and xmin, xmax, phimin, phimax
+    unsigned int dims[3] = { 0, 0, 0 };
+    float range[4];
+    bool isOkay = true;
+    isOkay &= (fread(dims, sizeof(unsigned int), 3, fptr) == 3);
+    isOkay &= (fread(range, sizeof(float), 4, fptr) == 4);
+
+    size_t headerSize = sizeof(dims) + sizeof(range);
+    size_t numCoeffs = 2U * dims[0] * (dims[1] + 1U) * (dims[2] + 1U) * 4U;
+    if (!isOkay || dims[0] == 0 || headerSize + numCoeffs * sizeof(float) != getFileSizeInBytes(filename)) {
+        fprintf(stderr, "LUT fit '%s' is not valid!\n", filename);
+        fclose(fptr);
+        return false;
+    }
+
+    // The buffer starts with two vec4 holding the header.
+    std::vector<float> data(8 + numCoeffs);
+    data[0] = static_cast<float>(dims[0]);
+    data[1] = static_cast<float>(dims[1]);
+    data[2] = static_cast<float>(dims[2]);
+    data[3] = 0.0f;
+    memcpy(&data[4], range, sizeof(range));
+    isOkay = (fread(&data[8], sizeof(float), numCoeffs, fptr) == numCoeffs);
     fclose(fptr);
+
+    if (!isOkay) {
+        fprintf(stderr, "Error reading LUT fit '%s'\n", filename);
+        return false;
+    }
+
+    glGenBuffers(1, &m_fitBuf);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_fitBuf);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * data.size(), data.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    fprintf(stderr, "Successfully loaded LUT fit '%s' (bands:%u, degree:%ux%u).\n", filename, dims[0], dims[1],
+        dims[2]);
     return true;
 }
 
@@ -145,4 +279,23 @@ GLuint LUT::genRGBAFloatTexture(unsigned int width, unsigned int height, float*
         GL_FLOAT, data);
     glBindTexture(GL_TEXTURE_2D, 0);
     return texID;
-}
\ No newline at end of file
+}
+
+GLuint LUT::genRGBAFloatTextureArray(unsigned int width, unsigned int height, unsigned int layers, float* data)
+{
+    GLuint texID;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // Derivatives are only read via texelFetch.
+    glGenTextures(1, &texID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA32F, static_cast<GLsizei>(width), static_cast<GLsizei>(height),
+        static_cast<GLsizei>(layers), 0, GL_RGBA, GL_FLOAT, data);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texID;
+}
@@ -12,11 +12,47 @@
 #include <iostream>
 
 class LUT {
+public:
+    /**
+     * @brief Reconstruction of lookup table values between samples.
+     *   Bilinear: hardware filtering.
+     *   Bicubic:  Catmull-Rom spline through 4x4 samples.
+     *   Hermite:  Cubic Hermite spline through 2x2 samples, needs derivatives.
+     *   Chebyshev: Piecewise Chebyshev fit without texture fetches, needs fit file.
+     */
+    enum class Filter : int { Bilinear = 0, Bicubic, Hermite, Chebyshev, Count };
+    static const char* const FilterNames[];
+
+    /// Shader storage binding point of the Chebyshev fit.
+    static const GLuint FitBinding = 8;
+
+    /**
+     * @brief Sampling of the azimuth angle, see genlookup/lutgen.h.
+     *   Phi:     uniform in phi, entries (ksi, dist, ux, uy).
+     *   CosPhi:  uniform in cos(phi), entries (dist cos(ksi), dist sin(ksi), ux, uy);
+     *            projection needs neither atan nor sin/cos, only bilinear filtering.
+     */
+    enum class Layout : int { Phi = 0, CosPhi, Count };
+
+    /// Magic number of lookup table files with layout field.
+    static const unsigned int Magic = 0x3154554C;
+
 public:
     LUT();
     ~LUT();
 
     float GetCameraPos();
+
+    /**
+     * @brief Texture array with derivatives (layer 0: azimuth, layer 1: radius),
+     *        or 0 if the table has no derivatives.
+     */
+    GLuint GetDerivTexID(unsigned int idx);
+
+    /// Shader storage buffer with the Chebyshev fit, or 0.
+    GLuint GetFitBuffer();
+
+    Layout GetLayout();
     
     void GetRadialRange(float &rmin, float &rmax);
     
@@ -24,11 +60,25 @@ public:
 
     GLuint GetTexID(unsigned int idx);
 
+    /// Whether the table holds derivatives for Hermite interpolation.
+    bool HasDerivatives();
+
+    /// Whether a Chebyshev fit was loaded together with the table.
+    bool HasFit();
+
+    /**
+     * @brief Load lookup table, optionally with derivatives.
+     *   The format is detected by the file size. A Chebyshev fit written
+     *   by GenLookupTable to '<filename>_fit.dat' is loaded as well.
+     */
     bool Load(const char* filename);
 
 protected:
+    void deleteTextures();
+    bool loadFit(const char* filename);
     size_t getFileSizeInBytes(const char* filename);
     GLuint genRGBAFloatTexture(unsigned int width, unsigned int height, float* data);
+    GLuint genRGBAFloatTextureArray(unsigned int width, unsigned int height, unsigned int layers, float* data);
 
 protected:
     unsigned int m_Nr;
@@ -37,7 +87,10 @@ protected:
     float m_rmax;
     float m_camPos;
     float* m_data;
-    GLuint m_texID[2];    
+    GLuint m_texID[2];
+    GLuint m_derivTexID[2];
+    GLuint m_fitBuf;
+    Layout m_layout;
 };
 
 #endif // GRPR_LUT_H
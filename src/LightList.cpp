@@ -0,0 +1,138 @@
+/**
+ * File:    LightList.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "LightList.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+
+LightList::LightList()
+    : m_lightBuf(0)
+    , m_tileBuf(0)
+    , m_lightBufSize(0)
+    , m_tileBufSize(0)
+    , m_numLights(0)
+    , m_isOverflowReported(false)
+{
+    //
+}
+
+LightList::~LightList()
+{
+    //
+}
+
+void LightList::Bind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LightBinding, m_lightBuf);
+    if (m_tileBuf != 0) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TileBinding, m_tileBuf);
+    }
+}
+
+void LightList::Delete()
+{
+    if (glIsBuffer(m_lightBuf)) {
+        glDeleteBuffers(1, &m_lightBuf);
+    }
+    if (glIsBuffer(m_tileBuf)) {
+        glDeleteBuffers(1, &m_tileBuf);
+    }
+    m_lightBuf = m_tileBuf = 0;
+    m_lightBufSize = m_tileBufSize = 0;
+    m_numLights = 0;
+}
+
+unsigned int LightList::GetMaxLightsPerTile()
+{
+    return std::max(1u, std::min(m_numLights, static_cast<unsigned int>(MaxLightsPerTile)));
+}
+
+unsigned int LightList::GetNumLights()
+{
+    return m_numLights;
+}
+
+void LightList::GetNumTiles(int width, int height, int& numTilesX, int& numTilesY)
+{
+    numTilesX = (width + TileSize - 1) / TileSize;
+    numTilesY = (height + TileSize - 1) / TileSize;
+}
+
+void LightList::ResizeTiles(int width, int height)
+{
+    int numTilesX, numTilesY;
+    GetNumTiles(width, height, numTilesX, numTilesY);
+    GLsizeiptr size
+        = static_cast<GLsizeiptr>(numTilesX) * numTilesY * (GetMaxLightsPerTile() + 1) * sizeof(GLuint);
+    if (size <= m_tileBufSize) {
+        return;
+    }
+
+    if (m_tileBuf == 0) {
+        glGenBuffers(1, &m_tileBuf);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_tileBuf);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    m_tileBufSize = size;
+}
+
+void LightList::Upload(std::vector<LightSource>& lights)
+{
+    TRACE_SCOPE("LightList::Upload");
+    m_data.clear();
+    for (LightSource& light : lights) {
+        if (light.IsActive()) {
+            const float* pos = light.GetPositionPtr();
+            m_data.insert(m_data.end(), { pos[0], pos[1], pos[2], light.GetFactor() });
+        }
+    }
+    m_numLights = static_cast<unsigned int>(m_data.size() / 4);
+
+    // Tile lists cannot hold all lights: the strongest come first, see shader/grpr_lightcull.comp.
+    if (m_numLights > MaxLightsPerTile) {
+        std::vector<unsigned int> order(m_numLights);
+        for (unsigned int i = 0; i < m_numLights; i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(),
+            [this](unsigned int a, unsigned int b) { return m_data[4 * a + 3] > m_data[4 * b + 3]; });
+
+        std::vector<float> sorted;
+        sorted.reserve(m_data.size());
+        for (unsigned int i : order) {
+            sorted.insert(sorted.end(), m_data.begin() + 4 * i, m_data.begin() + 4 * i + 4);
+        }
+        m_data.swap(sorted);
+
+        if (!m_isOverflowReported) {
+            fprintf(stderr, "LightList: %u active lights, deferred lighting keeps the %u strongest per tile.\n",
+                m_numLights, MaxLightsPerTile);
+            m_isOverflowReported = true;
+        }
+    }
+    else {
+        m_isOverflowReported = false;
+    }
+
+    // an empty buffer cannot be bound, so there is always room for one light
+    GLsizeiptr size = static_cast<GLsizeiptr>(std::max<size_t>(m_data.size(), 4) * sizeof(float));
+    if (m_lightBuf == 0) {
+        glGenBuffers(1, &m_lightBuf);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuf);
+    if (size > m_lightBufSize) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        m_lightBufSize = size;
+    }
+    if (!m_data.empty()) {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(m_data.size() * sizeof(float)),
+            m_data.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,70 @@
+/**
+ * File:    LightList.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_LIGHT_LIST_H
+#define GRPR_LIGHT_LIST_H
+
+#include "glad/glad.h"
+
+#include "LightSource.h"
+
+#include <vector>
+
+/**
+ * @brief Shader storage buffers of the active light sources and of the
+ *   per-tile light lists of the deferred lighting pass.
+ *
+ *   Every active light is stored as vec4(position, factor) in 'LightBinding'.
+ *   For deferred lighting, shader/grpr_lightcull.comp splits the G-buffer into
+ *   tiles of TileSize x TileSize pixels and writes for every tile the number of
+ *   lights followed by at most GetMaxLightsPerTile() light indices to 'TileBinding'.
+ *   The lists are as long as the number of active lights, such that no light is
+ *   dropped, but at most MaxLightsPerTile. With more lights, they are uploaded in
+ *   the order of decreasing factor, and a full tile keeps the strongest ones.
+ *   TileSize has to match shader/lighting.glsl.
+ */
+class LightList
+{
+public:
+    static const GLuint LightBinding = 9;
+    static const GLuint TileBinding = 10;
+    static const int TileSize = 16;
+    static const unsigned int MaxLightsPerTile = 512;
+
+public:
+    LightList();
+    ~LightList();
+
+    /// Bind light buffer and, if allocated, tile buffer.
+    void Bind();
+
+    void Delete();
+
+    /// Length of the tile lists, pass as 'maxLightsPerTile' to the shaders.
+    unsigned int GetMaxLightsPerTile();
+
+    unsigned int GetNumLights();
+
+    /// Number of tiles covering width x height pixels.
+    void GetNumTiles(int width, int height, int& numTilesX, int& numTilesY);
+
+    /// Allocate tile lists for width x height pixels; the buffer only grows.
+    void ResizeTiles(int width, int height);
+
+    /// Upload position and factor of all active light sources.
+    void Upload(std::vector<LightSource>& lights);
+
+protected:
+    GLuint m_lightBuf;
+    GLuint m_tileBuf;
+    GLsizeiptr m_lightBufSize;
+    GLsizeiptr m_tileBufSize;
+    unsigned int m_numLights;
+    bool m_isOverflowReported;
+    std::vector<float> m_data;
+};
+
+#endif // GRPR_LIGHT_LIST_H
@@ -61,27 +61,6 @@ void LightSource::SetFactor(float factor)
     m_factor = factor;
 }
 
-void LightSource::SetUniformName(const char* uname)
-{
-    m_uniformName = std::string(uname);
-}
-
-void LightSource::UpdateGL(GLShader* shader)
-{
-    if (shader == nullptr) {
-        return;
-    }
-
-    std::string uact = m_uniformName + ".is_active";
-    shader->SetFloat(uact.c_str(), (m_isActive ? 1.0 : 0.0));
-
-    std::string upos = m_uniformName + ".position";
-    shader->SetFloat(upos.c_str(), m_position[0], m_position[1], m_position[2]);
-
-    std::string ufac = m_uniformName + ".factor";
-    shader->SetFloat(ufac.c_str(), m_factor);
-}
-
 void LightSource::calcPosition()
 {
     float theta = m_theta / 180.0f * PI_F;
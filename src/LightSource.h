@@ -8,7 +8,6 @@
 #define GRPR_LIGHTSOURCE_H
 
 #include <iostream>
-#include "GLShader.h"
 
 class LightSource {
 public:    
@@ -34,10 +33,6 @@ public:
 
     void SetFactor(float factor);
 
-    void SetUniformName(const char* uname);
-
-    void UpdateGL(GLShader* shader);
-
 protected:
     void calcPosition();
 
@@ -48,8 +43,6 @@ protected:
     float m_factor;
 
     float m_position[3];
-
-    std::string m_uniformName;
 };
 
 #endif // GRPR_LIGHTSOURCE_H
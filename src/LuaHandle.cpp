@@ -1,6 +1,9 @@
 
 #include "LuaHandle.h"
 #include "Renderer.h"
+#include "Trace.h"
+
+#include <algorithm>
 
 static lua_State* m_luaInstance = nullptr;    
 
@@ -9,25 +12,30 @@ extern Renderer* renderer;
 extern void draw();
 extern bool saveImageToFile(const char* filename);
 extern void setWindowSize(int width, int height);
+extern void setTileSize(int width, int height);
 
 int loadObject(lua_State* L) {
+    TRACE_SCOPE("lua: loadObject");
     const char* filename = lua_tostring(L, -1);
     renderer->LoadObject(filename);
     return 0;
 }
 
 int loadSetting(lua_State* L) {
+    TRACE_SCOPE("lua: loadSetting");
     const char* filename = lua_tostring(L, -1);
     renderer->LoadSetting(filename);
     return 0;
 }
 
 int renderImage(lua_State* L) {
+    TRACE_SCOPE("lua: renderImage");
     draw();
     return 0;
 }
 
 int saveImage(lua_State* L) {
+    TRACE_SCOPE("lua: saveImage");
     const char* filename = lua_tostring(L, -1);
     if (filename != nullptr && strcmp(filename,"") != 0) {
         saveImageToFile(filename);
@@ -153,6 +161,15 @@ int setViewMode(lua_State* L) {
     return 0;
 }
 
+int setLUTFilter(lua_State* L) {
+    const char* filter = lua_tostring(L, -1);
+    if (filter != nullptr && strcmp(filter,"") != 0) {
+        fprintf(stderr, "lua: set lut filter: %s\n", filter);
+        renderer->SetLUTFilterByName(filter);
+    }
+    return 0;
+}
+
 int setMaxTessLevel(lua_State* L) {
     if (lua_isnumber(L,-1)) {
         int mtl = static_cast<int>(lua_tonumber(L,-1));
@@ -189,29 +206,133 @@ int setTessDistRelation(lua_State* L) {
     return 0;
 }
 
+int loadTessPresets(lua_State* L) {
+    const char* filename = lua_tostring(L, -1);
+    if (filename != nullptr && strcmp(filename,"") != 0) {
+        fprintf(stderr, "lua: load tess presets: %s\n", filename);
+        renderer->LoadTessPresets(filename);
+    }
+    return 0;
+}
+
+int setTessTargetError(lua_State* L) {
+    if (lua_isnumber(L,-1)) {
+        double err = lua_tonumber(L,-1);
+        fprintf(stderr, "lua: set tess target error: %f\n", err);
+        renderer->SetTessTargetError(err);
+    }
+    return 0;
+}
+
+/// Light source given by the optional first of 'numArgs' arguments (starting at 1), or nullptr.
+LightSource* getLightSource(lua_State* L, int numArgs) {
+    int idx = 1;
+    if (lua_gettop(L) == numArgs + 1 && lua_isnumber(L,1)) {
+        idx = static_cast<int>(lua_tointeger(L,1));
+    }
+    if (idx < 1 || idx > static_cast<int>(renderer->m_lights.size())) {
+        fprintf(stderr, "lua: light source %d does not exist\n", idx);
+        return nullptr;
+    }
+    return &renderer->m_lights[idx - 1];
+}
+
 int setLightSourceActive(lua_State* L) {
-    if (lua_isboolean(L,-1)) {
+    LightSource* light = getLightSource(L, 1);
+    if (light != nullptr && lua_isboolean(L,-1)) {
         int active = static_cast<int>(lua_toboolean(L,-1));
         fprintf(stderr, "lua: set light source active: %d\n", active);
-        renderer->m_lights[0].SetActive(active == 1);
+        light->SetActive(active == 1);
     }
     return 0;
 }
 
 int setLightSourcePos(lua_State* L) {
-    float pos[2];
-    if (getVector<float>(L, pos, 2)) {
-        fprintf(stderr, "lua: set light source pos: %7.2f %7.2f\n", pos[0], pos[1]);
-        renderer->m_lights[0].Set(pos[0], pos[1]);
+    float pos[3];
+    LightSource* light = getLightSource(L, 2);
+    bool withIndex = (lua_gettop(L) == 3);
+    if (light != nullptr && getVector<float>(L, pos, (withIndex ? 3 : 2))) {
+        float* angles = (withIndex ? &pos[1] : pos);
+        fprintf(stderr, "lua: set light source pos: %7.2f %7.2f\n", angles[0], angles[1]);
+        light->Set(angles[0], angles[1]);
     }
     return 0;
 }
 
 int setLightSourceFactor(lua_State* L) {
-    if (lua_isnumber(L,-1)) {
+    LightSource* light = getLightSource(L, 1);
+    if (light != nullptr && lua_isnumber(L,-1)) {
         float fac = static_cast<float>(lua_tonumber(L,-1));
         fprintf(stderr, "lua: set light source factor: %f\n", fac);
-        renderer->m_lights[0].SetFactor(fac);
+        light->SetFactor(fac);
+    }
+    return 0;
+}
+
+int addLightSource(lua_State* L) {
+    float val[3];
+    if (getVector<float>(L, val, 3)) {
+        fprintf(stderr, "lua: add light source: %7.2f %7.2f %f\n", val[0], val[1], val[2]);
+        LightSource light;
+        light.Set(val[0], val[1]);
+        light.SetFactor(val[2]);
+        renderer->m_lights.push_back(light);
+    }
+    return 0;
+}
+
+int setNumLightSources(lua_State* L) {
+    if (lua_isnumber(L,-1)) {
+        int num = static_cast<int>(lua_tointeger(L,-1));
+        fprintf(stderr, "lua: set number of light sources: %d\n", num);
+        if (num >= 1) {
+            renderer->m_lights.resize(static_cast<size_t>(num));
+        }
+    }
+    return 0;
+}
+
+int setLightCutoff(lua_State* L) {
+    if (lua_isnumber(L,-1)) {
+        float cutoff = static_cast<float>(lua_tonumber(L,-1));
+        fprintf(stderr, "lua: set light cutoff: %f\n", cutoff);
+        renderer->m_lightCutoff = cutoff;
+    }
+    return 0;
+}
+
+int setTextureBudget(lua_State* L) {
+    if (lua_isnumber(L,-1)) {
+        double mb = lua_tonumber(L,-1);
+        fprintf(stderr, "lua: set texture budget: %.1f MB\n", mb);
+        renderer->m_textureLoader.SetMemoryBudget(static_cast<size_t>(std::max(0.0, mb) * 1024.0 * 1024.0));
+    }
+    return 0;
+}
+
+int setDeferredLighting(lua_State* L) {
+    if (lua_isboolean(L,-1)) {
+        int deferred = static_cast<int>(lua_toboolean(L,-1));
+        fprintf(stderr, "lua: set deferred lighting: %d\n", deferred);
+        renderer->m_deferredLighting = (deferred == 1);
+    }
+    return 0;
+}
+
+int setPanorama(lua_State* L) {
+    if (lua_isboolean(L,-1)) {
+        int panorama = static_cast<int>(lua_toboolean(L,-1));
+        fprintf(stderr, "lua: set panorama: %d\n", panorama);
+        renderer->m_renderPanorama = (panorama == 1);
+    }
+    return 0;
+}
+
+int setWarpRadius(lua_State* L) {
+    if (lua_isnumber(L,-1)) {
+        float radius = static_cast<float>(lua_tonumber(L,-1));
+        fprintf(stderr, "lua: set warp radius: %f\n", radius);
+        renderer->m_warpRadius = std::max(0.0f, radius);
     }
     return 0;
 }
@@ -246,6 +367,15 @@ int setWinSize(lua_State* L) {
     return 0;
 }
 
+int setTileSz(lua_State* L) {
+    int tsize[2];
+    if (getVector<int>(L, tsize, 2)) {
+        fprintf(stderr, "lua: set tile size: %d %d\n", tsize[0], tsize[1]);
+        setTileSize(tsize[0], tsize[1]);
+    }
+    return 0;
+}
+
 int setCrossHairsVisible(lua_State* L) {
     if (lua_isboolean(L,-1)) {
         int visible = static_cast<int>(lua_toboolean(L,-1));
@@ -322,6 +452,9 @@ bool LInit() {
     lua_pushcfunction(m_luaInstance, setViewMode);
     lua_setglobal(m_luaInstance, "setViewMode");
 
+    lua_pushcfunction(m_luaInstance, setLUTFilter);
+    lua_setglobal(m_luaInstance, "setLUTFilter");
+
     lua_pushcfunction(m_luaInstance, setMaxTessLevel);
     lua_setglobal(m_luaInstance, "setMaxTessLevel");
 
@@ -334,6 +467,12 @@ bool LInit() {
     lua_pushcfunction(m_luaInstance, setTessDistRelation);
     lua_setglobal(m_luaInstance, "setTessDistRelation");
 
+    lua_pushcfunction(m_luaInstance, loadTessPresets);
+    lua_setglobal(m_luaInstance, "loadTessPresets");
+
+    lua_pushcfunction(m_luaInstance, setTessTargetError);
+    lua_setglobal(m_luaInstance, "setTessTargetError");
+
     lua_pushcfunction(m_luaInstance, setLightSourceActive);
     lua_setglobal(m_luaInstance, "setLightSourceActive");
 
@@ -343,12 +482,36 @@ bool LInit() {
     lua_pushcfunction(m_luaInstance, setLightSourceFactor);
     lua_setglobal(m_luaInstance, "setLightSourceFactor");
 
+    lua_pushcfunction(m_luaInstance, addLightSource);
+    lua_setglobal(m_luaInstance, "addLightSource");
+
+    lua_pushcfunction(m_luaInstance, setNumLightSources);
+    lua_setglobal(m_luaInstance, "setNumLightSources");
+
+    lua_pushcfunction(m_luaInstance, setLightCutoff);
+    lua_setglobal(m_luaInstance, "setLightCutoff");
+
+    lua_pushcfunction(m_luaInstance, setTextureBudget);
+    lua_setglobal(m_luaInstance, "setTextureBudget");
+
+    lua_pushcfunction(m_luaInstance, setDeferredLighting);
+    lua_setglobal(m_luaInstance, "setDeferredLighting");
+
+    lua_pushcfunction(m_luaInstance, setPanorama);
+    lua_setglobal(m_luaInstance, "setPanorama");
+
+    lua_pushcfunction(m_luaInstance, setWarpRadius);
+    lua_setglobal(m_luaInstance, "setWarpRadius");
+
     lua_pushcfunction(m_luaInstance, setClearColor);
     lua_setglobal(m_luaInstance, "setClearColor");
 
     lua_pushcfunction(m_luaInstance, setWinSize);
     lua_setglobal(m_luaInstance, "setWindowSize");
 
+    lua_pushcfunction(m_luaInstance, setTileSz);
+    lua_setglobal(m_luaInstance, "setTileSize");
+
     lua_pushcfunction(m_luaInstance, setCoordSysVisible);
     lua_setglobal(m_luaInstance, "setCoordSysVisible");
 
@@ -360,6 +523,7 @@ bool LInit() {
 
 void LRunFile(const char* filename)
 {
+    TRACE_SCOPE("LRunFile");
     int res = luaL_dofile(m_luaInstance, filename);
     if (res != 0) {
         fprintf(stderr, "Lua Error: 0x%x\n", res);
@@ -101,13 +101,42 @@ int setBlackHoleRadius(lua_State* L);
  */
 int setViewMode(lua_State* L);
 
+/**
+ * @brief Set lookup table filter ("Bilinear", "Bicubic", "Hermite", "Chebyshev")
+ *
+ * Lua: setLUTFilter("filter")
+ */
+int setLUTFilter(lua_State* L);
+
 int setMaxTessLevel(lua_State* L);
 int setTessFactor(lua_State* L);
 int setTessExpon(lua_State* L);
+
+/**
+ * @brief Load tessellation presets generated by GRPolyRenTune
+ *
+ * Lua: loadTessPresets(filename)
+ */
+int loadTessPresets(lua_State* L);
+
+/**
+ * @brief Choose tessellation parameters from the presets to meet a pixel error [%]
+ *
+ * Lua: setTessTargetError(err)
+ */
+int setTessTargetError(lua_State* L);
+
 int setLightSourceActive(lua_State* L);
 int setClearColor(lua_State* L);
 int setWinSize(lua_State* L);
 
+/**
+ * @brief Set tile size for rendering large images (0 = automatic)
+ *
+ * Lua: setTileSize(width, height)
+ */
+int setTileSz(lua_State* L);
+
 
 template <typename T> bool getVector(lua_State* L, T* vec, int dim = 3) {    
     int num = lua_gettop(L);
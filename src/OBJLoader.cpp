@@ -5,8 +5,15 @@
  *  This file is part of GRPolygonRender.
  */
 #include "OBJLoader.h"
+#include "Trace.h"
 #include "Utilities.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
 const char* const OBJLoader::ObjTextureNames[] = { "none", "disk", "sphere", "col_sphere", "triangle"};
 
 OBJLoader::OBJLoader()
@@ -89,6 +96,7 @@ void OBJLoader::ClearAll()
 
 bool OBJLoader::GenDrawObjects(float*& vert, float*& norm, float*& tc)
 {
+    TRACE_SCOPE("OBJLoader::GenDrawObjects");
     if (!m_objList.empty()) {
         m_objList.clear();
     }
@@ -270,6 +278,114 @@ bool OBJLoader::GenDrawObjects(float*& vert, float*& norm, float*& tc)
     return true;
 }
 
+bool OBJLoader::GenDisk(unsigned int numTriangles, float rIn, float rOut, float*& vert, float*& norm, float*& tc)
+{
+    ClearAll();
+
+    if (numTriangles < 2 || rOut <= rIn) {
+        return false;
+    }
+
+    // Ring segments are roughly four times as long as wide.
+    unsigned int numQuads = numTriangles / 2;
+    unsigned int numR = std::max(1u, static_cast<unsigned int>(sqrt(numQuads / 4.0) + 0.5));
+    unsigned int numPhi = std::max(3u, numQuads / numR);
+
+    m_numAllObjVertices = numR * numPhi * 6;
+    m_numDrawObjects = 1;
+    m_objList.push_back(obj_draw());
+
+    m_objOffsets = new unsigned int[2];
+    m_objOffsets[0] = 0;
+    m_objOffsets[1] = m_numAllObjVertices;
+
+    vert = new float[m_numAllObjVertices * 4];
+    norm = new float[m_numAllObjVertices * 3];
+    tc = new float[m_numAllObjVertices * 2];
+
+    float* vptr = vert;
+    float* nptr = norm;
+    float* tptr = tc;
+
+    const float twoPi = 6.28318531f;
+    const unsigned int quadIdx[6][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}};
+
+    for (unsigned int i = 0; i < numR; i++) {
+        for (unsigned int j = 0; j < numPhi; j++) {
+            for (unsigned int k = 0; k < 6; k++) {
+                float r = rIn + (rOut - rIn) * (i + quadIdx[k][0]) / static_cast<float>(numR);
+                // wrap around exactly, so that the seam vertices can be merged
+                float phi = twoPi * ((j + quadIdx[k][1]) % numPhi) / static_cast<float>(numPhi);
+                float x = r * cosf(phi);
+                float y = r * sinf(phi);
+
+                *(vptr++) = x;
+                *(vptr++) = y;
+                *(vptr++) = 0.0f;
+                *(vptr++) = 1.0f;
+                *(nptr++) = 0.0f;
+                *(nptr++) = 0.0f;
+                *(nptr++) = 1.0f;
+                *(tptr++) = 0.25f + 0.25f * x / rOut;
+                *(tptr++) = 0.25f + 0.25f * y / rOut;
+            }
+        }
+    }
+
+    return true;
+}
+
+unsigned int OBJLoader::IndexDrawVertices(
+    unsigned int numDrawVertices, float*& vert, float*& norm, float*& tc, unsigned int*& indices)
+{
+    TRACE_SCOPE("OBJLoader::IndexDrawVertices");
+    const unsigned int dim = 4 + 3 + 2;
+
+    struct VertexKey
+    {
+        float v[dim];
+        bool operator==(const VertexKey& other) const { return memcmp(v, other.v, sizeof(v)) == 0; }
+    };
+
+    struct VertexKeyHash
+    {
+        size_t operator()(const VertexKey& key) const
+        {
+            // FNV-1a
+            const unsigned char* ptr = reinterpret_cast<const unsigned char*>(key.v);
+            uint64_t h = 14695981039346656037ull;
+            for (size_t i = 0; i < sizeof(key.v); i++) {
+                h = (h ^ ptr[i]) * 1099511628211ull;
+            }
+            return static_cast<size_t>(h);
+        }
+    };
+
+    std::unordered_map<VertexKey, unsigned int, VertexKeyHash> uniqueVerts;
+    uniqueVerts.reserve(numDrawVertices / 2);
+    indices = new unsigned int[numDrawVertices];
+
+    // Unique vertices are compacted in place: vertex 'n' is never written before it has been read.
+    unsigned int numUnique = 0;
+    for (unsigned int i = 0; i < numDrawVertices; i++) {
+        VertexKey key;
+        memcpy(&key.v[0], &vert[4 * i], 4 * sizeof(float));
+        memcpy(&key.v[4], &norm[3 * i], 3 * sizeof(float));
+        memcpy(&key.v[7], &tc[2 * i], 2 * sizeof(float));
+
+        auto res = uniqueVerts.insert(std::make_pair(key, numUnique));
+        if (res.second) {
+            memcpy(&vert[4 * numUnique], &key.v[0], 4 * sizeof(float));
+            memcpy(&norm[3 * numUnique], &key.v[4], 3 * sizeof(float));
+            memcpy(&tc[2 * numUnique], &key.v[7], 2 * sizeof(float));
+            numUnique++;
+        }
+        indices[i] = res.first->second;
+    }
+
+    return numUnique;
+}
+
 unsigned int* OBJLoader::GetDrawOffsets()
 {
     return m_objOffsets;
@@ -395,6 +511,7 @@ void OBJLoader::PrintMaterial(int materialID, FILE* fptr)
 
 bool OBJLoader::ReadObjFile(const char* pathname, const char* filename)
 {
+    TRACE_SCOPE("OBJLoader::ReadObjFile");
     std::string fn = std::string(pathname) + "/" + std::string(filename);
 
     FileTokenizer ft;
@@ -561,7 +678,9 @@ bool OBJLoader::ReadMtlfile(const char* pathname, const char* filename)
                 ft.GetSubToken(i, -1, buf);
                 auto itr = m_texNames.find(buf);
                 if (itr == m_texNames.end()) {
-                    m_texNames.insert(std::pair<std::string, int>(std::string(buf), ++currTexID));
+                    // ids are consecutive, also if a texture is referenced by several materials
+                    currTexID = static_cast<int>(m_texNames.size());
+                    m_texNames.insert(std::pair<std::string, int>(std::string(buf), currTexID));
                 }
                 else {
                     currTexID = itr->second;
@@ -703,6 +822,11 @@ void OBJLoader::UpdateGL(GLShader* shader)
     shader->SetInt("obj_texture", static_cast<int>(m_objTexture));
 }
 
+OBJLoader::ObjTexture OBJLoader::GetObjTexture()
+{
+    return m_objTexture;
+}
+
 void OBJLoader::SetObjTexture(ObjTexture objtex)
 {
     m_objTexture = objtex;
@@ -94,8 +94,33 @@ public:
 
     bool GenDrawObjects(float*& vert, float*& norm, float*& tc);
 
+    /**
+     * @brief Generate a flat annulus in the xy-plane as a single draw object.
+     *   Texture coordinates are compatible with the 'disk' object texture.
+     *   The number of generated triangles is close to 'numTriangles'.
+     * @param numTriangles  Requested number of triangles.
+     * @param rIn           Inner radius.
+     * @param rOut          Outer radius.
+     */
+    bool GenDisk(unsigned int numTriangles, float rIn, float rOut, float*& vert, float*& norm, float*& tc);
+
     unsigned int* GetDrawOffsets();
 
+    /**
+     * @brief Merge identical draw vertices.
+     *   The draw arrays generated by GenDrawObjects or GenDisk hold three vertices per
+     *   triangle. They are replaced by the unique vertices, and 'indices' receives one
+     *   index per draw vertex. Thus, the draw offsets are also valid for the indices.
+     * @param numDrawVertices  Number of draw vertices.
+     * @param vert             Vertices (4 floats each).
+     * @param norm             Normals (3 floats each).
+     * @param tc               Texture coordinates (2 floats each).
+     * @param indices          Generated indices.
+     * @return Number of unique vertices.
+     */
+    static unsigned int IndexDrawVertices(
+        unsigned int numDrawVertices, float*& vert, float*& norm, float*& tc, unsigned int*& indices);
+
     bool GetFacePoint(unsigned int face, unsigned int idx, obj_face_point& fp);
 
     obj_material* GetMaterial(const unsigned int objNum);
@@ -127,6 +152,7 @@ public:
 
     void UpdateGL(GLShader* shader);
 
+    ObjTexture GetObjTexture();
     void SetObjTexture(ObjTexture objtex);
     void SetObjTextureByName(const char* name);
 
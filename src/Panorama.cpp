@@ -0,0 +1,257 @@
+/**
+ * File:    Panorama.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "Panorama.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// see shader/panorama_resample.comp
+constexpr int ResampleGroupSize = 16;
+
+static bool hasLayerFromVertexShader()
+{
+    GLint numExt = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExt);
+    for (GLint i = 0; i < numExt; i++) {
+        const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (ext != nullptr && strcmp(ext, "GL_ARB_shader_viewport_layer_array") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Panorama::Panorama()
+    : m_fbo(0)
+    , m_faceFBO(0)
+    , m_panoFBO(0)
+    , m_faceTex(0)
+    , m_depthTex(0)
+    , m_panoTex(0)
+    , m_faceSize(0)
+    , m_width(0)
+    , m_height(0)
+    , m_isSupported(false)
+    , m_faceProjMX(1.0f)
+{
+    for (int i = 0; i < NumFaces; i++) {
+        m_faceViewMX[i] = m_faceViewProjMX[i] = glm::mat4(1.0f);
+    }
+}
+
+Panorama::~Panorama()
+{
+    //
+}
+
+void Panorama::Bind()
+{
+    const GLfloat one = 1.0f;
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+    // a layered framebuffer clears all layers at once
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_faceSize, m_faceSize);
+    glClearBufferfv(GL_COLOR, 0, clearColor);
+    glClearBufferfv(GL_DEPTH, 0, &one);
+}
+
+void Panorama::BindFace(int face)
+{
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_faceFBO);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_faceTex, 0, face);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTex, 0, face);
+    glViewport(0, 0, m_faceSize, m_faceSize);
+}
+
+void Panorama::Blit(double x0, double y0, double x1, double y1, const GLint* viewport)
+{
+    GLint readFBO = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFBO);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_panoFBO);
+    glBlitFramebuffer(static_cast<GLint>(x0 * m_width), static_cast<GLint>(y0 * m_height),
+        static_cast<GLint>(x1 * m_width), static_cast<GLint>(y1 * m_height), viewport[0], viewport[1],
+        viewport[0] + viewport[2], viewport[1] + viewport[3], GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFBO));
+}
+
+void Panorama::Delete()
+{
+    GLuint fbos[] = { m_fbo, m_faceFBO, m_panoFBO };
+    for (GLuint& fbo : fbos) {
+        if (glIsFramebuffer(fbo)) {
+            glDeleteFramebuffers(1, &fbo);
+        }
+    }
+    m_fbo = m_faceFBO = m_panoFBO = 0;
+
+    GLuint texIDs[] = { m_faceTex, m_depthTex, m_panoTex };
+    for (GLuint& texID : texIDs) {
+        if (glIsTexture(texID)) {
+            glDeleteTextures(1, &texID);
+        }
+    }
+    m_faceTex = m_depthTex = m_panoTex = 0;
+    m_faceSize = m_width = m_height = 0;
+}
+
+int Panorama::GetFaceSize()
+{
+    return m_faceSize;
+}
+
+const float* Panorama::GetFaceProjMatrixPtr()
+{
+    return glm::value_ptr(m_faceProjMX);
+}
+
+const float* Panorama::GetFaceViewMatrixPtr(int face)
+{
+    return glm::value_ptr(m_faceViewMX[face]);
+}
+
+const float* Panorama::GetFaceViewProjMatrixPtr()
+{
+    return glm::value_ptr(m_faceViewProjMX[0]);
+}
+
+void Panorama::Init()
+{
+    std::string myPath = std::string(".");
+    m_shaderResample.SetFileName(GLShader::Type::Comp, "shader/panorama_resample.comp");
+    m_shaderResample.SetLocalPath(myPath.c_str());
+
+    m_isSupported = hasLayerFromVertexShader();
+    if (!m_isSupported) {
+        fprintf(stderr, "Panorama not available: GL_ARB_shader_viewport_layer_array is missing.\n");
+    }
+}
+
+bool Panorama::IsSupported()
+{
+    return m_isSupported;
+}
+
+bool Panorama::ReloadShaders()
+{
+    return m_shaderResample.ReloadShaders();
+}
+
+void Panorama::Resample()
+{
+    TRACE_SCOPE("Panorama::Resample");
+    m_shaderResample.Bind();
+    SetFaceUniforms(&m_shaderResample);
+    m_shaderResample.SetInt("panoSize", m_width, m_height);
+    glBindImageTexture(0, m_panoTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glDispatchCompute(static_cast<GLuint>((m_width + ResampleGroupSize - 1) / ResampleGroupSize),
+        static_cast<GLuint>((m_height + ResampleGroupSize - 1) / ResampleGroupSize), 1);
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    m_shaderResample.Release();
+}
+
+bool Panorama::Resize(int width, int height)
+{
+    // A face pixel at the face center subtends the same angle as a pixel of the equirectangular image.
+    GLint maxTexSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+    int faceSize = static_cast<int>(std::ceil(width / glm::pi<double>() / ResampleGroupSize)) * ResampleGroupSize;
+    faceSize = std::max(ResampleGroupSize, std::min(faceSize, static_cast<int>(maxTexSize)));
+
+    if (m_fbo != 0 && faceSize == m_faceSize && width == m_width && height == m_height) {
+        return true;
+    }
+
+    TRACE_SCOPE("Panorama::Resize");
+    Delete();
+    m_faceSize = faceSize;
+    m_width = width;
+    m_height = height;
+
+    m_faceTex = genTexture(GL_TEXTURE_2D_ARRAY, GL_RGBA8, m_faceSize, m_faceSize, NumFaces);
+    m_depthTex = genTexture(GL_TEXTURE_2D_ARRAY, GL_DEPTH_COMPONENT24, m_faceSize, m_faceSize, NumFaces);
+    m_panoTex = genTexture(GL_TEXTURE_2D, GL_RGBA8, m_width, m_height, 1);
+
+    glGenFramebuffers(1, &m_fbo);
+    glGenFramebuffers(1, &m_faceFBO);
+    glGenFramebuffers(1, &m_panoFBO);
+
+    // attaching the whole texture array makes the framebuffer layered
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_faceTex, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTex, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_panoFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_panoTex, 0);
+    GLenum panoStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE || panoStatus != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Panorama framebuffer incomplete!\n");
+        Delete();
+        return false;
+    }
+    return true;
+}
+
+void Panorama::SetFaceUniforms(GLShader* shader)
+{
+    glm::mat3 faceRotMX[NumFaces];
+    for (int i = 0; i < NumFaces; i++) {
+        faceRotMX[i] = glm::mat3(m_faceViewMX[i]);
+    }
+
+    glActiveTexture(GL_TEXTURE0 + TexUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_faceTex);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader->SetInt("faceTex", static_cast<int>(TexUnit));
+    shader->SetFloatMatrix("faceRotMX", 3, NumFaces, GL_FALSE, glm::value_ptr(faceRotMX[0]));
+}
+
+void Panorama::SetFaces(const Camera& camera)
+{
+    Camera faceCam(camera);
+    double zNear, zFar;
+    faceCam.GetClipPlanes(zNear, zFar);
+    m_faceProjMX = glm::perspective(0.5f * glm::pi<float>(), 1.0f, static_cast<float>(zNear),
+        static_cast<float>(zFar));
+
+    for (int i = 0; i < NumFaces; i++) {
+        faceCam.SetCurrentView(static_cast<Camera::CMView>(i));
+        m_faceViewMX[i] = glm::make_mat4(faceCam.GetViewMatrixPtr());
+        m_faceViewProjMX[i] = m_faceProjMX * m_faceViewMX[i];
+    }
+}
+
+GLuint Panorama::genTexture(GLenum target, GLenum internalFormat, int width, int height, int depth)
+{
+    GLuint texID;
+    glGenTextures(1, &texID);
+    glBindTexture(target, texID);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (target == GL_TEXTURE_2D_ARRAY) {
+        glTexStorage3D(target, 1, internalFormat, width, height, depth);
+    }
+    else {
+        glTexStorage2D(target, 1, internalFormat, width, height);
+    }
+    glBindTexture(target, 0);
+    return texID;
+}
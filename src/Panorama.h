@@ -0,0 +1,112 @@
+/**
+ * File:    Panorama.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_PANORAMA_H
+#define GRPR_PANORAMA_H
+
+#include "glad/glad.h"
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "GLShader.h"
+
+/**
+ * @brief Full-sky view of the observer.
+ *
+ *   The six faces of a cubemap (Camera::CMView) are layers of one layered
+ *   framebuffer. The GR programs draw every object once with one instance
+ *   per face; with PANORAMA defined, the vertex or tessellation evaluation
+ *   shader writes gl_Layer (GL_ARB_shader_viewport_layer_array), and the
+ *   tessellation control shader culls the patch for faces it does not reach.
+ *   shader/panorama_resample.comp resamples the faces to an equirectangular
+ *   image, whose center is the view direction of the camera.
+ */
+class Panorama
+{
+public:
+    static const int NumFaces = 6;
+    static const GLuint TexUnit = 7;
+
+public:
+    Panorama();
+    ~Panorama();
+
+    /// Bind the layered framebuffer, set viewport to the face size, and clear all faces.
+    void Bind();
+
+    /// Bind a single face, e.g. for objects that are drawn per face.
+    void BindFace(int face);
+
+    /**
+     * @brief Copy a region of the equirectangular image into the current draw framebuffer.
+     * @param x0,y0,x1,y1  Region relative to the image size, see Camera::GetTileRegion.
+     * @param viewport     Viewport of the current draw framebuffer.
+     */
+    void Blit(double x0, double y0, double x1, double y1, const GLint* viewport);
+
+    void Delete();
+
+    int GetFaceSize();
+
+    /// Projection matrix of all faces (90 degrees field of view).
+    const float* GetFaceProjMatrixPtr();
+
+    const float* GetFaceViewMatrixPtr(int face);
+
+    /// View-projection matrices of all faces, consecutively.
+    const float* GetFaceViewProjMatrixPtr();
+
+    void Init();
+
+    /// Whether gl_Layer can be written outside of geometry shaders.
+    bool IsSupported();
+
+    bool ReloadShaders();
+
+    /// Resample the faces to the equirectangular image.
+    void Resample();
+
+    /// Bind the faces to unit 'TexUnit' and set the uniforms of shader/cubefaces.glsl.
+    void SetFaceUniforms(GLShader* shader);
+
+    /**
+     * @brief Create framebuffer and images, or recreate them if a size differs.
+     * @param width    Width of the equirectangular image in pixels.
+     * @param height   Height of the equirectangular image in pixels.
+     * @return true if framebuffer is complete.
+     */
+    bool Resize(int width, int height);
+
+    /**
+     * @brief Set face matrices.
+     * @param camera  Position, orientation, and clip planes of the observer.
+     */
+    void SetFaces(const Camera& camera);
+
+protected:
+    GLuint genTexture(GLenum target, GLenum internalFormat, int width, int height, int depth);
+
+protected:
+    GLShader m_shaderResample;
+    GLuint m_fbo;
+    GLuint m_faceFBO;
+    GLuint m_panoFBO;
+    GLuint m_faceTex;
+    GLuint m_depthTex;
+    GLuint m_panoTex;
+
+    int m_faceSize;
+    int m_width;
+    int m_height;
+    bool m_isSupported;
+
+    glm::mat4 m_faceProjMX;
+    glm::mat4 m_faceViewMX[NumFaces];
+    glm::mat4 m_faceViewProjMX[NumFaces];
+};
+
+#endif // GRPR_PANORAMA_H
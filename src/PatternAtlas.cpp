@@ -0,0 +1,134 @@
+/**
+ * File:    PatternAtlas.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "PatternAtlas.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+// must match 'local_size_x/y' of shader/pattern_bake.comp
+constexpr int BakeGroupSize = 16;
+
+/// Anisotropic filtering is core since OpenGL 4.6, before it is an extension.
+static bool hasAnisotropicFiltering()
+{
+    if (GLAD_GL_VERSION_4_6 != 0) {
+        return true;
+    }
+    GLint numExt = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExt);
+    for (GLint i = 0; i < numExt; i++) {
+        const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (ext != nullptr
+            && (strcmp(ext, "GL_ARB_texture_filter_anisotropic") == 0
+                || strcmp(ext, "GL_EXT_texture_filter_anisotropic") == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+PatternAtlas::PatternAtlas()
+    : m_texID(0)
+    , m_isValid(false)
+{
+    m_patFreq[0] = m_patFreq[1] = 0;
+}
+
+PatternAtlas::~PatternAtlas()
+{
+    //
+}
+
+bool PatternAtlas::Bake(const int* patFreq)
+{
+    if (m_isValid && patFreq[0] == m_patFreq[0] && patFreq[1] == m_patFreq[1]) {
+        return true;
+    }
+    if (!m_shaderBake.IsValid()) {
+        return false;
+    }
+
+    TRACE_SCOPE("PatternAtlas::Bake");
+    if (m_texID == 0) {
+        genTexture();
+    }
+
+    m_shaderBake.Bind();
+    m_shaderBake.SetFloat("patFreq", static_cast<float>(patFreq[0]), static_cast<float>(patFreq[1]));
+    glBindImageTexture(0, m_texID, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    GLuint numGroups = static_cast<GLuint>((Size + BakeGroupSize - 1) / BakeGroupSize);
+    glDispatchCompute(numGroups, numGroups, NumLayers);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindImageTexture(0, 0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    m_shaderBake.Release();
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texID);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    m_patFreq[0] = patFreq[0];
+    m_patFreq[1] = patFreq[1];
+    m_isValid = true;
+    return true;
+}
+
+void PatternAtlas::Bind()
+{
+    glActiveTexture(GL_TEXTURE0 + TexUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texID);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void PatternAtlas::Delete()
+{
+    if (glIsTexture(m_texID)) {
+        glDeleteTextures(1, &m_texID);
+    }
+    m_texID = 0;
+    m_isValid = false;
+}
+
+void PatternAtlas::Init()
+{
+    std::string myPath = std::string(".");
+    m_shaderBake.SetFileName(GLShader::Type::Comp, "shader/pattern_bake.comp");
+    m_shaderBake.SetLocalPath(myPath.c_str());
+}
+
+void PatternAtlas::Invalidate()
+{
+    m_isValid = false;
+}
+
+bool PatternAtlas::ReloadShaders()
+{
+    m_isValid = false;
+    return m_shaderBake.ReloadShaders();
+}
+
+void PatternAtlas::genTexture()
+{
+    GLsizei numLevels = static_cast<GLsizei>(std::log2(static_cast<double>(Size))) + 1;
+
+    glGenTextures(1, &m_texID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texID);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, numLevels, GL_RGBA8, Size, Size, NumLayers);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (hasAnisotropicFiltering()) {
+        GLfloat maxAniso = 1.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAniso);
+        glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY, std::min(maxAniso, 16.0f));
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
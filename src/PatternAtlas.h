@@ -0,0 +1,64 @@
+/**
+ * File:    PatternAtlas.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_PATTERN_ATLAS_H
+#define GRPR_PATTERN_ATLAS_H
+
+#include "glad/glad.h"
+
+#include "GLShader.h"
+
+/**
+ * @brief Procedural object patterns baked into a mipmapped texture array.
+ *
+ *   Layer i holds the pattern of OBJLoader::ObjTexture i+1 (disk, sphere,
+ *   colored sphere, triangle) for the current pattern frequency, evaluated by
+ *   shader/pattern_bake.comp with 2x2 samples per texel. The fragment shaders
+ *   only fetch the pattern with trilinear and, if available, anisotropic
+ *   filtering (shader/objectcolor.glsl), which avoids aliasing where the
+ *   GR images are strongly demagnified.
+ */
+class PatternAtlas
+{
+public:
+    static const GLuint TexUnit = 6;
+    static const int Size = 1024;
+    static const int NumLayers = 4;
+
+public:
+    PatternAtlas();
+    ~PatternAtlas();
+
+    /**
+     * @brief Bake patterns if the frequency changed since the last call.
+     * @param patFreq  Number of checkers along both texture coordinates.
+     * @return true if the atlas is valid.
+     */
+    bool Bake(const int* patFreq);
+
+    /// Bind texture array to unit 'TexUnit'.
+    void Bind();
+
+    void Delete();
+
+    void Init();
+
+    /// Force re-baking with the next call of Bake().
+    void Invalidate();
+
+    bool ReloadShaders();
+
+protected:
+    void genTexture();
+
+protected:
+    GLShader m_shaderBake;
+    GLuint m_texID;
+    int m_patFreq[2];
+    bool m_isValid;
+};
+
+#endif // GRPR_PATTERN_ATLAS_H
@@ -9,38 +9,65 @@
 #include "FileTokenizer.h"
 #include "Renderer.h"
 #include "StringUtils.h"
+#include "Trace.h"
 #include "Utilities.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 constexpr float r_s = 2.0f;
 
+// see shader/warp_deflection.comp
+constexpr int WarpGroupSize = 16;
+
 #ifdef HAVE_IMGUI
 #include "imgui.h"
 #endif // HAVE_IMGUI
 
 const char* const Renderer::MouseCtrlNames[] = { "Camera", "Object" };
-const char* const Renderer::ViewModeNames[] = { "Flat", "GR", "GRgeom", "GRtess" };
+const char* const Renderer::ViewModeNames[] = { "Flat", "GR", "GRgeom", "GRtess", "Warp" };
 
 Renderer::Renderer()
     : m_activeShader(nullptr)
     , prevTime(0.0)
     , m_mouseCtrl(MouseCtrl::Object)
+    , m_guiLight(0)
     , m_viewMode(ViewMode::Flat)
     , m_maxTessLevel(32)
     , m_tessFactor(1.0f)
     , m_tessExpon(0.75f)
     , m_distRelation(100.0f)
+    , m_useGeometryCache(true)
+    , m_autoTess(false)
+    , m_tessTargetError(0.5)
+    , m_tessLevelScale(1.0f)
+    , m_lightCutoff(1.0f / 256.0f)
+    , m_deferredLighting(false)
+    , m_renderPanorama(false)
+    , m_warpRadius(0.0f)
+    , m_orbitVel(0.0f)
+    , m_lutFilter(LUT::Filter::Bilinear)
     , m_wireframe(false)
     , m_isInitialized(false)
 {
     m_patFreq[0] = m_patFreq[1] = 8;
 
-    m_lights[0].SetUniformName("light1");
-    m_lights[0].SetFactor(1.0f);
+    // only the first light source is active by default
+    m_lights.resize(4);
+    for (size_t i = 0; i < m_lights.size(); i++) {
+        m_lights[i].Set(90.0f, 90.0f * static_cast<float>(i));
+        m_lights[i].SetFactor(1.0f);
+        m_lights[i].SetActive(i == 0);
+    }
 
     m_clearColor[0] = m_clearColor[1] = m_clearColor[2] = 0.0f;
+    memset(m_tessCacheParams, 0, sizeof(m_tessCacheParams));
+    memset(m_lastViewState, 0, sizeof(m_lastViewState));
+    m_viewChanged = true;
+    m_isDirty = true;
 }
 
 Renderer::~Renderer()
@@ -50,9 +77,13 @@ Renderer::~Renderer()
 
 bool Renderer::Display()
 {
+    TRACE_SCOPE("Renderer::Display");
     if (m_activeShader == nullptr || !m_isInitialized) {
         return false;
     }
+    m_isDirty = false;
+
+    m_profiler.BeginFrame();
 
     glClearColor(m_clearColor[0], m_clearColor[1], m_clearColor[2], 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -66,24 +97,12 @@ bool Renderer::Display()
     //modelMX = transMX * scaleMX * rotMX;
     modelMX = transMX * rotMX * scaleMX;
 
-    m_activeShader->Bind();
-    m_activeShader->SetFloatMatrix("projMX", 4, 1, GL_FALSE, m_camera.GetProjMatrixPtr());
-    m_activeShader->SetFloatMatrix("viewMX", 4, 1, GL_FALSE, m_camera.GetViewMatrixPtr());
-    m_activeShader->SetFloatMatrix("modelMX", 4, 1, GL_FALSE, glm::value_ptr(modelMX));
-
-    m_activeShader->SetFloat("obsCamPos", m_lut.GetCameraPos(), 0.0f, 0.0f);
-
-    float xmin, xscale;
-    m_lut.GetScaledRange(r_s, xmin, xscale);
-    m_activeShader->SetFloat("xmin", xmin);
-    m_activeShader->SetFloat("xscale", xscale);
-
-    m_activeShader->SetInt("maxTessLevel", m_maxTessLevel);
-    m_activeShader->SetFloat("tessFactor", m_tessFactor);
-    m_activeShader->SetFloat("tessExpon", m_tessExpon);
-    m_activeShader->SetFloat("distRelation", m_distRelation);
-
-    m_activeShader->SetFloat("patFreq", static_cast<float>(m_patFreq[0]), static_cast<float>(m_patFreq[1]));
+    float viewState[48];
+    memcpy(&viewState[0], m_camera.GetViewMatrixPtr(), 16 * sizeof(float));
+    memcpy(&viewState[16], m_camera.GetProjMatrixPtr(), 16 * sizeof(float));
+    memcpy(&viewState[32], glm::value_ptr(modelMX), 16 * sizeof(float));
+    m_viewChanged = (memcmp(viewState, m_lastViewState, sizeof(viewState)) != 0);
+    memcpy(m_lastViewState, viewState, sizeof(viewState));
 
     GLenum filter = GL_LINEAR;
     if (glIsTexture(m_lut.GetTexID(0)) && glIsTexture(m_lut.GetTexID(1))) {
@@ -93,7 +112,6 @@ bool Renderer::Display()
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
-        m_activeShader->SetInt("lutTex0", 10);
 
         glActiveTexture(GL_TEXTURE11);
         glBindTexture(GL_TEXTURE_2D, m_lut.GetTexID(1));
@@ -101,42 +119,183 @@ bool Renderer::Display()
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
-        m_activeShader->SetInt("lutTex1", 11);
-    }
 
-    for(size_t i = 0; i < m_numLights; i++) {
-        m_lights[i].UpdateGL(m_activeShader);
+        // derivatives for Hermite interpolation, bound in any case to keep the sampler units distinct
+        glActiveTexture(GL_TEXTURE12);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_lut.GetDerivTexID(0));
+        glActiveTexture(GL_TEXTURE13);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_lut.GetDerivTexID(1));
     }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LUT::FitBinding, m_lut.GetFitBuffer());
 
-    if (m_viewMode == ViewMode::GRtess) {
-        Camera obsCam(m_camera);
-        obsCam.SetPositionF(m_lut.GetCameraPos(), 0.0f, 0.0f);
-        m_activeShader->SetFloatMatrix("obsCamViewMX", 4, 1, GL_FALSE, obsCam.GetViewMatrixPtr());
-    }
+    // The observer camera sits at the LUT position and looks at the black hole. It is
+    // independent of the interactive camera, so that the projected and tessellated
+    // geometry only depends on the object and the LUT and can be cached.
+    Camera obsCam(m_camera);
+    obsCam.SetPosRFrame(m_lut.GetCameraPos(), 0.0, 0.0, -1.0, 0.0, 0.0, 0.0, 0.0, 1.0);
+    glm::mat4 obsCamViewMX = glm::make_mat4(obsCam.GetViewMatrixPtr());
 
     bool asPatch = (m_viewMode == ViewMode::GRtess);
+    bool useTessCache = false;
+
+    // The Warp mode draws the scene flat into the observer's cubemap and warps it via the
+    // deflection map; without layered rendering, it falls back to the Flat mode.
+    bool isWarp = (m_viewMode == ViewMode::Warp && m_panorama.IsSupported());
+    bool isGR = (m_viewMode != ViewMode::Flat && m_viewMode != ViewMode::Warp);
+
+    // The panorama has the size of the whole image, tiles only copy their part of it.
+    bool isPanorama = (m_renderPanorama && !isWarp && m_panorama.IsSupported());
+    bool useFaces = (isPanorama || isWarp);
+    if (useFaces) {
+        int width, height;
+        m_camera.GetResolution(width, height);
+        useFaces = m_panorama.Resize(width, height);
+        isPanorama &= useFaces;
+        isWarp &= useFaces;
+    }
+
+    if (isGR) {
+        m_profiler.BeginPass(GPUProfiler::Pass::Projection);
+        float xmin, xscale;
+        m_lut.GetScaledRange(r_s, xmin, xscale);
+        glm::mat4 obsViewProjMX = glm::make_mat4(m_camera.GetFullProjMatrixPtr()) * obsCamViewMX;
+        bool isProjected = m_projector.Project(m_objVA, glm::value_ptr(modelMX), m_lut.GetCameraPos(), xmin,
+            xscale, 10, 11, static_cast<int>(getLUTFilter()), static_cast<int>(m_lut.GetLayout()),
+            (asPatch ? glm::value_ptr(obsViewProjMX) : nullptr));
+
+        if (asPatch && m_useGeometryCache && !isPanorama) {
+            float tessParams[] = { static_cast<float>(getMaxTessLevel()), m_tessFactor, m_tessExpon, m_distRelation };
+            if (isProjected || memcmp(tessParams, m_tessCacheParams, sizeof(tessParams)) != 0) {
+                memcpy(m_tessCacheParams, tessParams, sizeof(tessParams));
+                m_tessCache.Invalidate();
+            }
 
-    m_activeShader->SetFloat("imageOrder", 0.0f);
-    drawObject(m_activeShader, asPatch);
+            if (!m_tessCache.IsValid() && !m_tessCache.HasFailed()) {
+                captureTessGeometry(modelMX, obsCamViewMX);
+            }
+            useTessCache = m_tessCache.IsValid();
+        }
+        m_profiler.EndPass(GPUProfiler::Pass::Projection);
+    }
+
+    GLShader* shader = (useTessCache ? &m_shaderGRcached : m_activeShader);
+    if (isGR) {
+        m_projector.Bind();
+    }
+    m_lightList.Upload(m_lights);
+    m_lightList.Bind();
+    m_patternAtlas.Bake(m_patFreq);
+    m_patternAtlas.Bind();
+
+    // with deferred lighting, both image orders only fill the G-buffer, which is lit afterwards
+    bool isDeferred = (m_deferredLighting && m_viewMode == ViewMode::GRtess && isAnyLightActive() && !useFaces);
+    GLint targetFBO = 0;
+    GLint viewport[4];
+    if (isDeferred || useFaces) {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFBO);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+    }
+    if (isDeferred) {
+        isDeferred = m_gbuffer.Resize(viewport[2], viewport[3]);
+    }
+    if (isDeferred) {
+        m_gbuffer.Bind();
+        m_gbuffer.Clear();
+    }
+
+    // all six faces of the observer's cubemap are drawn with one instance each
+    int numInstances = 1;
+    if (useFaces) {
+        m_panorama.SetFaces(obsCam);
+        m_panorama.Bind();
+        numInstances = Panorama::NumFaces;
+    }
+
+    // every image order has its own shader variant, so the uniforms are set per order
+    int numOrders = (isGR ? 2 : 1);
+    for (int order = 0; order < numOrders; order++) {
+        GPUProfiler::Pass pass = (order == 0 ? GPUProfiler::Pass::Order0 : GPUProfiler::Pass::Order1);
+        m_profiler.BeginPass(pass);
+        selectVariant(shader, order, isDeferred, useFaces);
+        shader->Bind();
+        setUniforms(shader, modelMX, obsCamViewMX);
+        if (useFaces) {
+            shader->SetFloatMatrix(
+                "faceViewProjMX", 4, Panorama::NumFaces, GL_FALSE, m_panorama.GetFaceViewProjMatrixPtr());
+        }
 
-    if (m_viewMode == ViewMode::GR || m_viewMode == ViewMode::GRgeom || m_viewMode == ViewMode::GRtess) {
-        m_activeShader->SetFloat("imageOrder", 1.0f);
-        drawObject(m_activeShader, asPatch);
+        if (useTessCache) {
+            drawCachedObject(shader, order);
+        }
+        else {
+            drawObject(shader, asPatch, numInstances);
+        }
+        m_profiler.EndPass(pass);
     }
 
     glBindTexture(GL_TEXTURE_2D, 0);
-    m_activeShader->Release();
+    shader->Release();
 
-    m_crossHairs.Draw(m_camera.GetProjMatrixPtr(), m_camera.GetViewMatrixPtr());
-    m_blackhole.Draw(m_camera.GetProjMatrixPtr(), m_camera.GetViewMatrixPtr());
+    if (isDeferred) {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(targetFBO));
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        m_profiler.BeginPass(GPUProfiler::Pass::Lighting);
+        renderLighting(modelMX, obsCamViewMX, viewport);
+        m_profiler.EndPass(GPUProfiler::Pass::Lighting);
+    }
+
+    if (isWarp) {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(targetFBO));
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        m_profiler.BeginPass(GPUProfiler::Pass::Warp);
+        renderWarp(modelMX, obsCamViewMX, viewport);
+        m_profiler.EndPass(GPUProfiler::Pass::Warp);
+    }
 
+    // the shadow is a single screen-space quad, a wireframe would only show its outline
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    if (m_coordSystem.IsVisible()) {
-        Camera sysCam(m_camera);
-        sysCam.MovePOItoOrigin();
-        sysCam.SetDistance(0.0);
-        m_coordSystem.Draw(nullptr, sysCam.GetViewMatrixPtr());
+    m_profiler.BeginPass(GPUProfiler::Pass::BlackHole);
+    if (isPanorama) {
+        for (int face = 0; face < Panorama::NumFaces; face++) {
+            m_panorama.BindFace(face);
+            m_blackhole.Draw(m_panorama.GetFaceProjMatrixPtr(), m_panorama.GetFaceViewMatrixPtr(face));
+        }
+    }
+    else {
+        double camPos[3];
+        m_camera.GetPosition(camPos);
+        double camDist = sqrt(camPos[0] * camPos[0] + camPos[1] * camPos[1] + camPos[2] * camPos[2]);
+        m_blackhole.SetApparentSize(m_camera.GetApparentSphereSize(m_blackhole.GetRadius(), camDist));
+        m_blackhole.Draw(m_camera.GetProjMatrixPtr(), m_camera.GetViewMatrixPtr());
+    }
+    m_profiler.EndPass(GPUProfiler::Pass::BlackHole);
+
+    double tx0, ty0, tx1, ty1;
+    m_camera.GetTileRegion(tx0, ty0, tx1, ty1);
+
+    if (isPanorama) {
+        m_profiler.BeginPass(GPUProfiler::Pass::Panorama);
+        m_panorama.Resample();
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(targetFBO));
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        m_panorama.Blit(tx0, ty0, tx1, ty1, viewport);
+        m_profiler.EndPass(GPUProfiler::Pass::Panorama);
+    }
+    else {
+        m_profiler.BeginPass(GPUProfiler::Pass::Overlays);
+        m_crossHairs.Draw(m_camera.GetProjMatrixPtr(), m_camera.GetViewMatrixPtr());
+
+        // when rendering tiles, the coordinate system belongs to the lower left tile only
+        if (m_coordSystem.IsVisible() && tx0 == 0.0 && ty0 == 0.0) {
+            Camera sysCam(m_camera);
+            sysCam.MovePOItoOrigin();
+            sysCam.SetDistance(0.0);
+            m_coordSystem.Draw(nullptr, sysCam.GetViewMatrixPtr());
+        }
+        m_profiler.EndPass(GPUProfiler::Pass::Overlays);
     }
+
+    m_profiler.EndFrame();
     return true;
 }
 
@@ -148,10 +307,18 @@ bool Renderer::Idle(double time)
 
     double dt = time - prevTime;
 
-    m_animCam.Idle(&m_camera, dt);
+    bool isAnimating = m_animCam.Idle(&m_camera, dt);
+    if (fabsf(m_orbitVel) > 1e-5f) {
+        m_transScale.Rotate(m_orbitVel);
+        isAnimating = true;
+    }
 
     prevTime = time;
-    return true;
+    m_isDirty |= isAnimating;
+
+    // textures are streamed in while the loop keeps running
+    m_isDirty |= m_textureLoader.Update();
+    return isAnimating || m_textureLoader.IsLoading();
 }
 
 bool Renderer::Init(int width, int height)
@@ -181,15 +348,40 @@ bool Renderer::Init(int width, int height)
     std::string vGRAdaptShaderName = "shader/grpr.vert";
     std::string tcGRAdaptShaderName = "shader/grpr.tc";
     std::string teGRAdaptShaderName = "shader/grpr.te";
-    std::string gGRAdaptShaderName = "shader/grpr.geom";
     std::string fGRAdaptShaderName = "shader/grpr.frag";
     m_shaderGRtess.SetFileName(GLShader::Type::Vert, vGRAdaptShaderName.c_str());
     m_shaderGRtess.SetFileName(GLShader::Type::TCtrl, tcGRAdaptShaderName.c_str());
     m_shaderGRtess.SetFileName(GLShader::Type::TEval, teGRAdaptShaderName.c_str());
-    m_shaderGRtess.SetFileName(GLShader::Type::Geom, gGRAdaptShaderName.c_str());
     m_shaderGRtess.SetFileName(GLShader::Type::Frag, fGRAdaptShaderName.c_str());
     m_shaderGRtess.SetLocalPath(myPath.c_str());
 
+    // same pipeline as GRtess, but captures the tessellation evaluation output
+    m_shaderGRtessCapture.SetFileName(GLShader::Type::Vert, vGRAdaptShaderName.c_str());
+    m_shaderGRtessCapture.SetFileName(GLShader::Type::TCtrl, tcGRAdaptShaderName.c_str());
+    m_shaderGRtessCapture.SetFileName(GLShader::Type::TEval, teGRAdaptShaderName.c_str());
+    m_shaderGRtessCapture.SetFileName(GLShader::Type::Frag, fGRAdaptShaderName.c_str());
+    m_shaderGRtessCapture.SetLocalPath(myPath.c_str());
+    m_shaderGRtessCapture.SetTransformFeedbackVaryings(TessGeometryCache::GetVaryings());
+
+    std::string vGRCachedShaderName = "shader/grpr_cached.vert";
+    m_shaderGRcached.SetFileNames(vGRCachedShaderName.c_str(), fGRAdaptShaderName.c_str());
+    m_shaderGRcached.SetLocalPath(myPath.c_str());
+
+    std::string vLightingShaderName = "shader/grpr_lighting.vert";
+    std::string fLightingShaderName = "shader/grpr_lighting.frag";
+    m_shaderLighting.SetFileNames(vLightingShaderName.c_str(), fLightingShaderName.c_str());
+    m_shaderLighting.SetLocalPath(myPath.c_str());
+
+    m_shaderLightCull.SetFileName(GLShader::Type::Comp, "shader/grpr_lightcull.comp");
+    m_shaderLightCull.SetLocalPath(myPath.c_str());
+
+    std::string fWarpShaderName = "shader/warp.frag";
+    m_shaderWarp.SetFileNames(vLightingShaderName.c_str(), fWarpShaderName.c_str());
+    m_shaderWarp.SetLocalPath(myPath.c_str());
+
+    m_shaderWarpMap.SetFileName(GLShader::Type::Comp, "shader/warp_deflection.comp");
+    m_shaderWarpMap.SetLocalPath(myPath.c_str());
+
     // -----------------------------
     //  initialize camera
     // -----------------------------
@@ -220,14 +412,24 @@ bool Renderer::Init(int width, int height)
     m_crossHairs.SetLineLength(0.5f);
 
     m_blackhole.Init();
-    m_blackhole.SetSubdivisions(5);
     m_blackhole.SetColor(0.3f);
-    m_blackhole.SetRadius(r_s);
+    m_blackhole.SetSchwarzschildRadius(r_s);
+
+    m_panorama.Init();
 
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
 
+    m_profiler.Init();
+    m_projector.Init();
+    m_patternAtlas.Init();
+    m_tessCache.Init();
+
+    if (FileExists("tess_presets.json")) {
+        LoadTessPresets("tess_presets.json");
+    }
+
     ReloadShaders();
     SetViewMode(m_viewMode);
 
@@ -308,6 +510,9 @@ bool Renderer::KeyPressEvent(int key, int mods)
     else if (key == 0x34) { // 4
         SetViewMode(ViewMode::GRtess);
     }
+    else if (key == 0x35) { // 5
+        SetViewMode(ViewMode::Warp);
+    }
     else if (key == 0x106) { // right arrow
         m_transScale.Rotate(0.01);
     }
@@ -315,11 +520,15 @@ bool Renderer::KeyPressEvent(int key, int mods)
         m_transScale.Rotate(-0.01);
     }
 
+    m_isDirty = true;
     return true;
 }
 
 bool Renderer::LoadLUT(const char* filename)
 {
+    m_projector.Invalidate();
+    m_deflectionMap.Invalidate();
+    m_isDirty = true;
     return m_lut.Load(filename);
 }
 
@@ -336,6 +545,7 @@ bool Renderer::LoadObjOrSetting(const char* filename)
 
 bool Renderer::LoadObject(const char* filename)
 {
+    TRACE_SCOPE("Renderer::LoadObject");
     if (filename == nullptr) {
         return false;
     }
@@ -344,7 +554,8 @@ bool Renderer::LoadObject(const char* filename)
     char* fname = nullptr;
     SplitFilePath(filename, fpath, fname);
 
-    m_objTexIDs.clear();
+    m_objTexHandles.clear();
+    m_textureLoader.Clear();
     m_obj.ClearAll();
 
     unsigned int numTriangles;
@@ -354,12 +565,7 @@ bool Renderer::LoadObject(const char* filename)
         float *verts = nullptr, *norm = nullptr, *tc = nullptr;
 
         if (m_obj.GenDrawObjects(verts, norm, tc)) {
-            m_objVA.Delete();
-            m_objVA.Create(m_obj.GetNumDrawVertices());
-            m_objVA.SetArrayBuffer(0, GL_FLOAT, 4, verts);
-            m_objVA.SetArrayBuffer(1, GL_FLOAT, 3, norm);
-            m_objVA.SetArrayBuffer(2, GL_FLOAT, 2, tc);
-
+            uploadObject(verts, norm, tc);
             numTriangles = m_obj.GetNumDrawVertices() / 3;
         }
 
@@ -367,12 +573,9 @@ bool Renderer::LoadObject(const char* filename)
         SafeDelete<float>(norm);
         SafeDelete<float>(tc);
 
+        // textures are decoded in the background, drawObject() uses them once they are uploaded
         unsigned int numTextures = m_obj.GetNumTextures();
-        for (unsigned int i = 0; i < numTextures; i++) {
-            m_objTexIDs.push_back(0);
-        }
-
-        char* buf = nullptr;
+        m_objTexHandles.assign(numTextures, -1);
         int texIDref;
 
         for (unsigned int i = 0; i < numTextures; i++) {
@@ -382,17 +585,11 @@ bool Renderer::LoadObject(const char* filename)
             }
 
             std::string texFilename = std::string(fpath) + "/" + std::string(fn);
-            if (texIDref >= 0 && texIDref < static_cast<int>(m_objTexIDs.size())) {
-                GLuint texID = 0;
-                //glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-                // if (oglview::utils::ImageIO::Upload(texFilename.c_str(), texID)) {
-                //    m_texIDs[static_cast<size_t>(texIDref)] = texID;
-                //}
+            if (texIDref >= 0 && texIDref < static_cast<int>(m_objTexHandles.size())) {
+                m_objTexHandles[static_cast<size_t>(texIDref)] = m_textureLoader.Request(texFilename.c_str());
             }
         }
 
-        SafeDelete<char>(buf);
-
         // m_centerOfVertices = m_obj.CenterOfVertices();
         isOkay = true;
     }
@@ -402,9 +599,29 @@ bool Renderer::LoadObject(const char* filename)
     return isOkay;
 }
 
+bool Renderer::LoadDisk(unsigned int numTriangles, float rIn, float rOut)
+{
+    TRACE_SCOPE("Renderer::LoadDisk");
+    m_objTexHandles.clear();
+    m_textureLoader.Clear();
+
+    float *verts = nullptr, *norm = nullptr, *tc = nullptr;
+    bool isOkay = m_obj.GenDisk(numTriangles, rIn, rOut, verts, norm, tc);
+    if (isOkay) {
+        uploadObject(verts, norm, tc);
+    }
+
+    SafeDelete<float>(verts);
+    SafeDelete<float>(norm);
+    SafeDelete<float>(tc);
+    return isOkay;
+}
+
 bool Renderer::LoadSetting(const char* filename)
 {
+    TRACE_SCOPE("Renderer::LoadSetting");
     loadSetting(filename);
+    m_isDirty = true;
     return true;
 }
 
@@ -420,6 +637,7 @@ bool Renderer::Motion(double x, double y)
     }
 
     UpdateMousePos(x, y);
+    m_isDirty |= postRedisplay;
     return postRedisplay;
 }
 
@@ -433,11 +651,24 @@ bool Renderer::Mouse(int button, int action, int mods)
 
 bool Renderer::ReloadShaders()
 {
+    TRACE_SCOPE("Renderer::ReloadShaders");
+    GLShader* shaders[] = { &m_shaderFlat, &m_shaderGR, &m_shaderGRgeom, &m_shaderGRtess, &m_shaderGRtessCapture,
+        &m_shaderGRcached, &m_shaderLighting, &m_shaderLightCull, &m_shaderWarp, &m_shaderWarpMap };
+
+    // issue all programs before waiting for the first one, see GLShader::EnableParallelCompile
     bool isOkay = true;
-    isOkay &= m_shaderFlat.ReloadShaders();
-    isOkay &= m_shaderGR.ReloadShaders();
-    isOkay &= m_shaderGRgeom.ReloadShaders();
-    isOkay &= m_shaderGRtess.ReloadShaders();
+    for (GLShader* shader : shaders) {
+        isOkay &= shader->BeginReload();
+    }
+    isOkay &= m_projector.ReloadShaders();
+    isOkay &= m_patternAtlas.ReloadShaders();
+    isOkay &= m_panorama.ReloadShaders();
+    for (GLShader* shader : shaders) {
+        isOkay &= shader->FinishReload();
+    }
+    m_tessCache.Invalidate();
+    m_deflectionMap.Invalidate();
+    m_isDirty = true;
     isOkay &= m_coordSystem.ReloadShaders();
     isOkay &= m_crossHairs.ReloadShaders();
     isOkay &= m_blackhole.ReloadShaders();
@@ -448,15 +679,51 @@ bool Renderer::ReloadShaders()
     return isOkay;
 }
 
+bool Renderer::LoadTessPresets(const char* filename)
+{
+    bool isOkay = m_tessPresets.Load(filename);
+    if (isOkay && m_autoTess) {
+        applyTessPreset();
+    }
+    return isOkay;
+}
+
 void Renderer::SaveSetting(const char* filename)
 {
     saveSetting(filename);
 }
 
+void Renderer::SetTessTargetError(double targetError)
+{
+    m_tessTargetError = std::max(0.0, targetError);
+    m_autoTess = true;
+    if (m_tessPresets.GetNumPresets() == 0) {
+        fprintf(stderr, "No tessellation presets loaded, keep current tessellation parameters.\n");
+        return;
+    }
+    applyTessPreset();
+}
+
 void Renderer::SetWindowSize(int width, int height)
 {
     std::cerr << "window size: " << width << " " << height << std::endl;
     m_camera.SetResolution(width, height);
+    m_isDirty = true;
+}
+
+bool Renderer::IsDirty()
+{
+    return m_isDirty;
+}
+
+void Renderer::SetDirty()
+{
+    m_isDirty = true;
+}
+
+bool Renderer::ViewChanged()
+{
+    return m_viewChanged;
 }
 
 void Renderer::UpdateMousePos(double x, double y)
@@ -555,7 +822,291 @@ bool Renderer::mouseObjectCtrl(double x, double y)
     return postRedisplay;
 }
 
-void Renderer::drawObject(GLShader* shader, bool drawAsPatch)
+void Renderer::applyTessPreset()
+{
+    const TessPresets::Preset* preset = m_tessPresets.Select(m_tessTargetError);
+    if (preset == nullptr) {
+        return;
+    }
+
+    m_maxTessLevel = preset->maxTessLevel;
+    m_tessFactor = preset->tessFactor;
+    m_tessExpon = preset->tessExpon;
+    m_distRelation = preset->distRelation;
+    m_isDirty = true;
+}
+
+LUT::Filter Renderer::getLUTFilter()
+{
+    if (m_lut.GetLayout() == LUT::Layout::CosPhi) {
+        return LUT::Filter::Bilinear;
+    }
+    if (m_lutFilter == LUT::Filter::Hermite && !m_lut.HasDerivatives()) {
+        return LUT::Filter::Bicubic;
+    }
+    if (m_lutFilter == LUT::Filter::Chebyshev && !m_lut.HasFit()) {
+        return LUT::Filter::Bilinear;
+    }
+    return m_lutFilter;
+}
+
+int Renderer::getMaxTessLevel()
+{
+    return std::max(1, static_cast<int>(m_maxTessLevel * m_tessLevelScale + 0.5f));
+}
+
+float Renderer::getWarpRadius()
+{
+    float rmin, rmax;
+    m_lut.GetRadialRange(rmin, rmax);
+    if (m_warpRadius <= 0.0f) {
+        return rmax;
+    }
+    return std::min(std::max(m_warpRadius, rmin), rmax);
+}
+
+void Renderer::captureTessGeometry(const glm::mat4& modelMX, const glm::mat4& obsCamViewMX)
+{
+    TRACE_SCOPE("Renderer::captureTessGeometry");
+    m_projector.Bind();
+
+    // every patch yields at least one triangle
+    size_t minNumVertices = 3 * static_cast<size_t>(m_projector.GetNumTriangles());
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    for (int order = 0; order < 2; order++) {
+        selectVariant(&m_shaderGRtessCapture, order);
+        m_shaderGRtessCapture.Bind();
+        setUniforms(&m_shaderGRtessCapture, modelMX, obsCamViewMX);
+        do {
+            m_tessCache.BeginCapture(order, minNumVertices);
+            drawObject(&m_shaderGRtessCapture, true);
+        } while (!m_tessCache.EndCapture(order));
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+    m_shaderGRtessCapture.Release();
+}
+
+bool Renderer::selectVariant(GLShader* shader, int order, bool deferred, bool panorama)
+{
+    int objTexture = static_cast<int>(m_obj.GetObjTexture());
+    bool isLightActive = (!deferred && isAnyLightActive());
+
+    // bit 0 is set for all variants, key 0 is the program without defines
+    unsigned int key = 1U | (static_cast<unsigned int>(order) << 1) | (isLightActive ? (1U << 2) : 0U)
+        | (deferred ? (1U << 3) : 0U) | (static_cast<unsigned int>(objTexture) << 4) | (panorama ? (1U << 7) : 0U);
+    if (key == shader->GetVariant()) {
+        return shader->IsValid();
+    }
+
+    char defines[192];
+    snprintf(defines, sizeof(defines), "#define IMAGE_ORDER %d.0\n#define LIGHT_ACTIVE %s\n#define OBJ_TEXTURE %d%s%s",
+        order, (isLightActive ? "true" : "false"), objTexture, (deferred ? "\n#define DEFERRED_LIGHTING" : ""),
+        (panorama ? "\n#define PANORAMA" : ""));
+    return shader->SelectVariant(key, defines);
+}
+
+bool Renderer::isAnyLightActive()
+{
+    for (LightSource& light : m_lights) {
+        if (light.IsActive()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Renderer::renderLighting(const glm::mat4& modelMX, const glm::mat4& obsCamViewMX, const GLint* viewport)
+{
+    TRACE_SCOPE("Renderer::renderLighting");
+    // units 10-13 hold the lookup table
+    const GLuint gbufferUnit = 2;
+    m_gbuffer.BindTextures(gbufferUnit);
+
+    // Every tile keeps only the lights that exceed the cutoff somewhere in the tile. The light
+    // rays are looked up once per light and tile, the lighting pass looks them up per pixel.
+    int numTilesX, numTilesY;
+    m_lightList.GetNumTiles(viewport[2], viewport[3], numTilesX, numTilesY);
+    m_lightList.ResizeTiles(viewport[2], viewport[3]);
+    m_lightList.Bind();
+
+    m_shaderLightCull.Bind();
+    setUniforms(&m_shaderLightCull, modelMX, obsCamViewMX);
+    m_shaderLightCull.SetInt("gbNormal", static_cast<int>(gbufferUnit) + 1);
+    m_shaderLightCull.SetInt("gbPosition", static_cast<int>(gbufferUnit) + 2);
+    m_shaderLightCull.SetInt("gbSize", viewport[2], viewport[3]);
+    m_shaderLightCull.SetFloat("lightCutoff", m_lightCutoff);
+    m_shaderLightCull.SetInt("maxLightsPerTile", static_cast<int>(m_lightList.GetMaxLightsPerTile()));
+    glDispatchCompute(static_cast<GLuint>(numTilesX), static_cast<GLuint>(numTilesY), 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_shaderLightCull.Release();
+
+    m_shaderLighting.Bind();
+    setUniforms(&m_shaderLighting, modelMX, obsCamViewMX);
+    m_shaderLighting.SetInt("gbAlbedo", static_cast<int>(gbufferUnit));
+    m_shaderLighting.SetInt("gbNormal", static_cast<int>(gbufferUnit) + 1);
+    m_shaderLighting.SetInt("gbPosition", static_cast<int>(gbufferUnit) + 2);
+    m_shaderLighting.SetInt("gbDepth", static_cast<int>(gbufferUnit) + 3);
+    m_shaderLighting.SetInt("viewOrigin", viewport[0], viewport[1]);
+    m_shaderLighting.SetInt("numTilesX", numTilesX);
+    m_shaderLighting.SetInt("maxLightsPerTile", static_cast<int>(m_lightList.GetMaxLightsPerTile()));
+
+    // the pass writes the depth of the G-buffer for the black hole and the overlays
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    glDepthFunc(GL_ALWAYS);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    m_gbuffer.DrawFullScreen();
+    glDepthFunc(static_cast<GLenum>(depthFunc));
+
+    m_shaderLighting.Release();
+}
+
+void Renderer::renderWarp(const glm::mat4& modelMX, const glm::mat4& obsCamViewMX, const GLint* viewport)
+{
+    TRACE_SCOPE("Renderer::renderWarp");
+    float warpRadius = getWarpRadius();
+    float key[DeflectionMap::KeySize];
+    memcpy(&key[0], m_camera.GetViewMatrixPtr(), 16 * sizeof(float));
+    memcpy(&key[16], m_camera.GetProjMatrixPtr(), 16 * sizeof(float));
+    key[32] = m_lut.GetCameraPos();
+    key[33] = warpRadius;
+    key[34] = static_cast<float>(getLUTFilter());
+    key[35] = static_cast<float>(m_lut.GetLayout());
+    key[36] = static_cast<float>(viewport[2]);
+    key[37] = static_cast<float>(viewport[3]);
+
+    // The source directions of every pixel are searched in the lookup table once per
+    // observer, camera, and resolution; afterwards, a frame costs one texture warp.
+    // A change of the resolution scale only recomputes the map, it keeps the texture.
+    m_deflectionMap.Resize(viewport[2], viewport[3]);
+    if (!m_deflectionMap.IsValidFor(key)) {
+        glm::mat4 viewProjMX
+            = glm::make_mat4(m_camera.GetProjMatrixPtr()) * glm::make_mat4(m_camera.GetViewMatrixPtr());
+
+        m_shaderWarpMap.Bind();
+        setUniforms(&m_shaderWarpMap, modelMX, obsCamViewMX);
+        m_shaderWarpMap.SetFloatMatrix("invViewProjMX", 4, 1, GL_FALSE, glm::value_ptr(glm::inverse(viewProjMX)));
+        m_shaderWarpMap.SetInt("mapSize", viewport[2], viewport[3]);
+        m_shaderWarpMap.SetFloat("srcRadius", warpRadius);
+        m_deflectionMap.BindImage(0);
+        GLuint numGroupsX = static_cast<GLuint>((viewport[2] + WarpGroupSize - 1) / WarpGroupSize);
+        GLuint numGroupsY = static_cast<GLuint>((viewport[3] + WarpGroupSize - 1) / WarpGroupSize);
+        glDispatchCompute(numGroupsX, numGroupsY, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        glBindImageTexture(0, 0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        m_shaderWarpMap.Release();
+        m_deflectionMap.Validate(key);
+    }
+
+    m_deflectionMap.BindTexture();
+    m_shaderWarp.Bind();
+    m_panorama.SetFaceUniforms(&m_shaderWarp);
+    m_shaderWarp.SetInt("deflectionMap", static_cast<int>(DeflectionMap::TexUnit));
+    m_shaderWarp.SetInt("viewOrigin", viewport[0], viewport[1]);
+    m_shaderWarp.SetFloat("clearColor", m_clearColor[0], m_clearColor[1], m_clearColor[2]);
+
+    // the warped image has no depth, the black hole and the overlays are drawn on top
+    glDisable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    m_deflectionMap.DrawFullScreen();
+    glEnable(GL_DEPTH_TEST);
+
+    m_shaderWarp.Release();
+}
+
+void Renderer::setMaterial(GLShader* shader, unsigned int i)
+{
+    OBJLoader::obj_material* mat = m_obj.GetMaterial(i);
+    if (mat != nullptr) {
+        shader->SetFloatArray("ambient", 3, 1, mat->Ka);
+        shader->SetFloatArray("diffuse", 3, 1, mat->Kd);
+        shader->SetInt("useTexs", 0);
+
+        if (mat->mapID >= 0 && mat->mapID < static_cast<int>(m_objTexHandles.size())) {
+            GLuint texID = m_textureLoader.GetTexID(m_objTexHandles[static_cast<size_t>(mat->mapID)]);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, texID);
+            glActiveTexture(GL_TEXTURE0);
+            shader->SetInt("tex", 1);
+            shader->SetInt("useTexs", (texID > 0 ? 1 : 0));
+        }
+    }
+    else {
+        shader->SetFloat("Ka", 0.1f, 0.1f, 0.1f);
+        shader->SetFloat("Kd", 0.8f, 0.8f, 0.8f);
+        shader->SetInt("useTexs", 0);
+    }
+}
+
+void Renderer::setUniforms(GLShader* shader, const glm::mat4& modelMX, const glm::mat4& obsCamViewMX)
+{
+    shader->SetFloatMatrix("projMX", 4, 1, GL_FALSE, m_camera.GetProjMatrixPtr());
+    shader->SetFloatMatrix("tessProjMX", 4, 1, GL_FALSE, m_camera.GetFullProjMatrixPtr());
+    shader->SetFloatMatrix("viewMX", 4, 1, GL_FALSE, m_camera.GetViewMatrixPtr());
+    shader->SetFloatMatrix("modelMX", 4, 1, GL_FALSE, glm::value_ptr(modelMX));
+    shader->SetFloatMatrix("obsCamViewMX", 4, 1, GL_FALSE, glm::value_ptr(obsCamViewMX));
+
+    shader->SetFloat("obsCamPos", m_lut.GetCameraPos(), 0.0f, 0.0f);
+
+    float xmin, xscale;
+    m_lut.GetScaledRange(r_s, xmin, xscale);
+    shader->SetFloat("xmin", xmin);
+    shader->SetFloat("xscale", xscale);
+    shader->SetInt("lutTex0", 10);
+    shader->SetInt("lutTex1", 11);
+    shader->SetInt("lutDeriv0", 12);
+    shader->SetInt("lutDeriv1", 13);
+    shader->SetInt("lutFilter", static_cast<int>(getLUTFilter()));
+    shader->SetInt("lutLayout", static_cast<int>(m_lut.GetLayout()));
+
+    shader->SetInt("maxTessLevel", getMaxTessLevel());
+    shader->SetFloat("tessFactor", m_tessFactor);
+    shader->SetFloat("tessExpon", m_tessExpon);
+    shader->SetFloat("distRelation", m_distRelation);
+
+    shader->SetInt("patternTex", static_cast<int>(PatternAtlas::TexUnit));
+
+    shader->SetUInt("numVertices", m_projector.GetNumVertices());
+    shader->SetUInt("numEdges", m_projector.GetNumEdges());
+
+    shader->SetInt("numLights", static_cast<int>(m_lightList.GetNumLights()));
+}
+
+void Renderer::uploadObject(float*& verts, float*& norm, float*& tc)
+{
+    unsigned int numDrawVertices = m_obj.GetNumDrawVertices();
+    unsigned int* indices = nullptr;
+    unsigned int numVertices = OBJLoader::IndexDrawVertices(numDrawVertices, verts, norm, tc, indices);
+
+    m_objVA.Delete();
+    m_objVA.Create(numVertices);
+    m_objVA.SetArrayBuffer(0, GL_FLOAT, 4, verts);
+    m_objVA.SetArrayBuffer(1, GL_FLOAT, 3, norm);
+    m_objVA.SetArrayBuffer(2, GL_FLOAT, 2, tc);
+    m_objVA.SetElementBuffer(GRProjector::IndexBinding, numDrawVertices, indices);
+    m_projector.SetEdges(indices, numDrawVertices);
+    m_isDirty = true;
+
+    SafeDelete<unsigned int>(indices);
+}
+
+void Renderer::drawCachedObject(GLShader* shader, int order)
+{
+    if (shader == nullptr) {
+        return;
+    }
+
+    // the cache holds one range per part, see drawObject
+    size_t numRanges = m_tessCache.GetNumRanges(order);
+    for (size_t i = 0; i < numRanges && i < m_obj.GetNumDrawObjects(); i++) {
+        setMaterial(shader, static_cast<unsigned int>(i));
+        m_obj.UpdateGL(shader);
+        m_tessCache.Draw(order, i);
+    }
+}
+
+void Renderer::drawObject(GLShader* shader, bool drawAsPatch, int numInstances)
 {
     if (shader == nullptr) {
         return;
@@ -563,40 +1114,31 @@ void Renderer::drawObject(GLShader* shader, bool drawAsPatch)
 
     unsigned int* objOffsets = m_obj.GetDrawOffsets();
     if (objOffsets != nullptr) {
-        OBJLoader::obj_material* mat = nullptr;
+        bool isCapturing = m_tessCache.IsCapturing();
 
         m_objVA.Bind();
         for (unsigned int i = 0; i < m_obj.GetNumDrawObjects(); i++) {
-            mat = m_obj.GetMaterial(i);
-
-            if (mat != nullptr) {
-                shader->SetFloatArray("ambient", 3, 1, mat->Ka);
-                shader->SetFloatArray("diffuse", 3, 1, mat->Kd);
-                shader->SetInt("useTexs", 0);
-
-                if (mat->mapID >= 0 && mat->mapID < static_cast<int>(m_objTexIDs.size())) {
-                    size_t mID = static_cast<size_t>(mat->mapID);
-                    glActiveTexture(GL_TEXTURE1);
-                    glBindTexture(GL_TEXTURE_2D, m_objTexIDs[mID]);
-                    shader->SetInt("tex", 1);
-                    shader->SetInt("useTexs", (m_objTexIDs[mID] > 0 ? 1 : 0));
-                }
-            }
-            else {
-                shader->SetFloat("Ka", 0.1f, 0.1f, 0.1f);
-                shader->SetFloat("Kd", 0.8f, 0.8f, 0.8f);
-            }
-
+            setMaterial(shader, i);
             m_obj.UpdateGL(shader);
 
+            // draw offsets are also index offsets, see OBJLoader::IndexDrawVertices
+            GLsizei count = static_cast<GLsizei>(objOffsets[i + 1] - objOffsets[i]);
+            const void* offset = reinterpret_cast<const void*>(objOffsets[i] * sizeof(GLuint));
+
+            if (isCapturing) {
+                m_tessCache.BeginRange();
+            }
             if (drawAsPatch) {
+                // gl_PrimitiveID starts at zero for every draw call
+                shader->SetUInt("primitiveOffset", objOffsets[i] / 3);
                 glPatchParameteri(GL_PATCH_VERTICES, 3);
-                glDrawArrays(GL_PATCHES, static_cast<GLsizei>(objOffsets[i]),
-                    static_cast<GLsizei>(objOffsets[i + 1] - objOffsets[i]));
+                glDrawElementsInstanced(GL_PATCHES, count, GL_UNSIGNED_INT, offset, numInstances);
             }
             else {
-                glDrawArrays(GL_TRIANGLES, static_cast<GLsizei>(objOffsets[i]),
-                    static_cast<GLsizei>(objOffsets[i + 1] - objOffsets[i]));
+                glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_INT, offset, numInstances);
+            }
+            if (isCapturing) {
+                m_tessCache.EndRange();
             }
         }
         m_objVA.Release();
@@ -622,6 +1164,8 @@ void Renderer::RenderGUI()
     ImGui::Dummy(spacing);
     renderGUIBackground();
     ImGui::Dummy(spacing);
+    renderGUIprofiler();
+    ImGui::Dummy(spacing);
 #endif    
 }
 
@@ -644,12 +1188,18 @@ void Renderer::SetViewMode(ViewMode mode)
             m_activeShader = &m_shaderGRtess;
             break;
         }
+        case ViewMode::Warp: {
+            // the scene is drawn flat into the observer's cubemap
+            m_activeShader = &m_shaderFlat;
+            break;
+        }
         case ViewMode::Count: {
             return;
         }
     }
 
     m_viewMode = mode;
+    m_isDirty = true;
 }
 
 void Renderer::SetViewModeByName(const char* mode)
@@ -667,11 +1217,35 @@ void Renderer::SetViewModeByName(const char* mode)
     }
 }
 
+void Renderer::SetLUTFilter(LUT::Filter filter)
+{
+    if (filter == LUT::Filter::Count) {
+        return;
+    }
+    m_lutFilter = filter;
+    m_isDirty = true;
+}
+
+void Renderer::SetLUTFilterByName(const char* filter)
+{
+    if (filter == nullptr) {
+        return;
+    }
+
+    for(int i = 0; i < static_cast<int>(LUT::Filter::Count); i++) {
+        if (strcmp(filter, LUT::FilterNames[i]) == 0) {
+            SetLUTFilter(static_cast<LUT::Filter>(i));
+            break;
+        }
+    }
+}
+
 void Renderer::SetClearColor(float r, float g, float b)
 {
     m_clearColor[0] = r;
     m_clearColor[1] = g;
     m_clearColor[2] = b;
+    m_isDirty = true;
 }
 
 void Renderer::GetClearColor(float* rgb)
@@ -686,6 +1260,7 @@ void Renderer::SetClearColor(float* rgb)
     m_clearColor[0] = rgb[0];
     m_clearColor[1] = rgb[1];
     m_clearColor[2] = rgb[2];
+    m_isDirty = true;
 }
 
 #ifdef HAVE_IMGUI
@@ -779,8 +1354,6 @@ void Renderer::renderGUIobject()
     m_eulerRot.Get(rot);
     int patFreq[2] = {m_patFreq[0], m_patFreq[1]};
 
-static float phi = 0.0f;
-
     if (ImGui::CollapsingHeader("Object", headerFlags)) {
         if (ImGui::InputFloat3("trans", trans, "%6.3f", flags)) {
             m_transScale.SetTrans(trans);
@@ -827,12 +1400,8 @@ static float phi = 0.0f;
             m_patFreq[1] = patFreq[1];
         }
 
-        if (ImGui::DragFloat("orbit-rotate", &phi, 0.0001f, -0.1f, 0.1f, "%.4f")) {
-            phi = Clamp(phi, -1.0f, 1.0f);
-        }
-
-        if (fabsf(phi) > 1e-5f) {
-            m_transScale.Rotate(phi);
+        if (ImGui::DragFloat("orbit-rotate", &m_orbitVel, 0.0001f, -0.1f, 0.1f, "%.4f")) {
+            m_orbitVel = Clamp(m_orbitVel, -1.0f, 1.0f);
         }
     }
 }
@@ -849,7 +1418,7 @@ void Renderer::renderGUIblackhole()
 
     if (ImGui::CollapsingHeader("BlackHole", headerFlags)) {
         
-        if (ImGui::InputFloat("radius", &radius, 0.01f, 0.1f, "%0.2f", flags)) {
+        if (ImGui::InputFloat("radius (0: shadow)", &radius, 0.01f, 0.1f, "%0.2f", flags)) {
             m_blackhole.SetRadius(radius);
         }
 
@@ -886,6 +1455,45 @@ void Renderer::renderGUIview()
             ImGui::EndCombo();
         }
 
+        const char* currFilterItem = LUT::FilterNames[static_cast<int>(m_lutFilter)];
+        if (ImGui::BeginCombo("lut filter", currFilterItem)) {
+            for (int n = 0; n < static_cast<int>(LUT::Filter::Count); n++) {
+                bool is_selected = (currFilterItem == LUT::FilterNames[n]);
+                if (ImGui::Selectable(LUT::FilterNames[n], is_selected)) {
+                    currFilterItem = LUT::FilterNames[n];
+                    SetLUTFilter(static_cast<LUT::Filter>(n));
+                }
+                if (is_selected) {
+                    ImGui::SetItemDefaultFocus();
+                }
+            }
+            ImGui::EndCombo();
+        }
+        if (m_lutFilter != getLUTFilter()) {
+            ImGui::Text("not supported by lookup table, using %s", LUT::FilterNames[static_cast<int>(getLUTFilter())]);
+        }
+
+        if (m_viewMode == ViewMode::Warp) {
+            if (!m_panorama.IsSupported()) {
+                ImGui::Text("layered rendering not supported, drawn flat");
+            }
+            if (ImGui::InputFloat("warp radius (0: lut)", &m_warpRadius, 0.5f, 5.0f, "%0.1f", flags)) {
+                m_warpRadius = std::max(0.0f, m_warpRadius);
+            }
+        }
+
+        if (m_tessPresets.GetNumPresets() > 0) {
+            if (ImGui::Checkbox("auto tessellation", &m_autoTess) && m_autoTess) {
+                applyTessPreset();
+            }
+            if (m_autoTess) {
+                float targetError = static_cast<float>(m_tessTargetError);
+                if (ImGui::SliderFloat("target error [%]", &targetError, 0.0f, 5.0f, "%.2f")) {
+                    SetTessTargetError(targetError);
+                }
+            }
+        }
+
         ImGui::SliderInt("maxTessLevel", &m_maxTessLevel, 1, 64);
         
         if (ImGui::InputFloat("tessFactor", &m_tessFactor, 0.1f, 1.0f, "%0.1f", flags)) {
@@ -903,6 +1511,21 @@ void Renderer::renderGUIview()
         if (ImGui::Checkbox("wireframe", &wireframe)) {
             m_wireframe = wireframe;
         }
+
+        if (m_panorama.IsSupported()) {
+            ImGui::Checkbox("panorama", &m_renderPanorama);
+        }
+
+        ImGui::Checkbox("cache tessellation", &m_useGeometryCache);
+        if (m_viewMode == ViewMode::GRtess && m_useGeometryCache) {
+            if (m_tessCache.IsValid()) {
+                ImGui::Text("cached: %zu + %zu triangles (%.1f MB)", m_tessCache.GetNumTriangles(0),
+                    m_tessCache.GetNumTriangles(1), m_tessCache.GetMemorySize() / 1048576.0);
+            }
+            else if (m_tessCache.HasFailed()) {
+                ImGui::Text("cache disabled: geometry too large");
+            }
+        }
     }
 }
 
@@ -911,27 +1534,54 @@ void Renderer::renderGUIlights()
     //const ImGuiTreeNodeFlags headerFlags = ImGuiTreeNodeFlags_DefaultOpen;
     const ImGuiTreeNodeFlags headerFlags = ImGuiTreeNodeFlags_None;
 
-    float lightPos[2];
-    m_lights[0].Get(lightPos[0], lightPos[1]);
+    if (ImGui::CollapsingHeader("LightSource", headerFlags)) {
+        // the number of lights may also be changed by settings or Lua
+        int numLights = static_cast<int>(m_lights.size());
+        m_guiLight = std::min(m_guiLight, numLights - 1);
+        int lightNum = m_guiLight + 1;
+        if (ImGui::SliderInt("light", &lightNum, 1, numLights)) {
+            m_guiLight = Clamp(lightNum, 1, numLights) - 1;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("+")) {
+            m_lights.push_back(m_lights[m_guiLight]);
+            m_guiLight = numLights;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("-") && numLights > 1) {
+            m_lights.erase(m_lights.begin() + m_guiLight);
+            m_guiLight = std::min(m_guiLight, numLights - 2);
+        }
+        LightSource& light = m_lights[m_guiLight];
 
-    float lightFactor = m_lights[0].GetFactor();
-    bool isActive = m_lights[0].IsActive();
+        float lightPos[2];
+        light.Get(lightPos[0], lightPos[1]);
+
+        float lightFactor = light.GetFactor();
+        bool isActive = light.IsActive();
 
-    if (ImGui::CollapsingHeader("LightSource", headerFlags)) {
         if (ImGui::Checkbox("active", &isActive)) {
-            m_lights[0].SetActive(isActive);
+            light.SetActive(isActive);
         }
 
         if (ImGui::SliderFloat("theta", &lightPos[0], 0.01f, 179.99f, "%.2f")) {
-            m_lights[0].Set(lightPos[0], lightPos[1]);
+            light.Set(lightPos[0], lightPos[1]);
         }
 
         if (ImGui::SliderFloat("phi", &lightPos[1], 0.0f, 360.0f, "%.2f")) {
-            m_lights[0].Set(lightPos[0], lightPos[1]);
+            light.Set(lightPos[0], lightPos[1]);
         }
 
         if (ImGui::SliderFloat("factor", &lightFactor, 0.0f, 1.0f, "%.3f")) {
-            m_lights[0].SetFactor(lightFactor);
+            light.SetFactor(lightFactor);
+        }
+
+        ImGui::Checkbox("deferred lighting", &m_deferredLighting);
+        if (m_deferredLighting && m_viewMode != ViewMode::GRtess) {
+            ImGui::Text("only used in GRtess mode");
+        }
+        if (m_deferredLighting) {
+            ImGui::SliderFloat("cutoff", &m_lightCutoff, 0.0f, 0.05f, "%.4f");
         }
     }
 }
@@ -950,6 +1600,64 @@ void Renderer::renderGUIBackground()
     }
 }
 
+void Renderer::renderGUIprofiler()
+{
+    const ImGuiTreeNodeFlags headerFlags = ImGuiTreeNodeFlags_None;
+
+    bool enabled = m_profiler.IsEnabled();
+
+    if (ImGui::CollapsingHeader("GPU Profiler", headerFlags)) {
+        if (ImGui::Checkbox("enabled", &enabled)) {
+            m_profiler.SetEnabled(enabled);
+        }
+
+        if (!m_profiler.HasPipelineStatistics()) {
+            ImGui::Text("pipeline statistics need OpenGL 4.6");
+        }
+
+        ImGui::Columns(6, "profiler");
+        ImGui::Text("pass");
+        ImGui::NextColumn();
+        ImGui::Text("ms");
+        ImGui::NextColumn();
+        ImGui::Text("prims");
+        ImGui::NextColumn();
+        ImGui::Text("TES inv");
+        ImGui::NextColumn();
+        ImGui::Text("GS prims");
+        ImGui::NextColumn();
+        ImGui::Text("FS inv");
+        ImGui::NextColumn();
+        ImGui::Separator();
+
+        double totalTime = 0.0;
+        for (int p = 0; p < GPUProfiler::NumPasses; p++) {
+            GPUProfiler::Pass pass = static_cast<GPUProfiler::Pass>(p);
+            totalTime += m_profiler.GetTime(pass);
+
+            ImGui::Text("%s", GPUProfiler::PassNames[p]);
+            ImGui::NextColumn();
+            ImGui::Text("%.3f", m_profiler.GetTime(pass));
+            ImGui::NextColumn();
+            for (int s = 0; s < GPUProfiler::NumStats; s++) {
+                ImGui::Text("%.0f", m_profiler.GetStat(pass, static_cast<GPUProfiler::Stat>(s)));
+                ImGui::NextColumn();
+            }
+        }
+        ImGui::Columns(1);
+        ImGui::Separator();
+        ImGui::Text("total: %.3f ms  (%d frames)", totalTime, static_cast<int>(m_profiler.GetNumFrames()));
+
+        if (ImGui::Button("save csv")) {
+            m_profiler.WriteCSV("gpu_profile.csv");
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("save json")) {
+            m_profiler.WriteJSON("gpu_profile.json");
+        }
+    }
+}
+
 #endif // HAVE_IMGUI
 
 void Renderer::loadSetting(const char* filename)
@@ -1011,22 +1719,38 @@ void Renderer::loadSetting(const char* filename)
         SetViewModeByName(buf);
     }
 
+    if (ft.GetSubToken("VIEW_LUT_FILTER", 1, buf)) {
+        SetLUTFilterByName(buf);
+    }
+
     ft.GetSubToken<int>("VIEW_MAX_TESS_LEVEL", 1, m_maxTessLevel);
     ft.GetSubToken<float>("VIEW_TESS_FACTOR", 1, m_tessFactor);
     ft.GetSubToken<float>("VIEW_TESS_EXPON", 1, m_tessExpon);
     ft.GetSubBoolToken("VIEW_WIREFRAME", 1, m_wireframe);
+    ft.GetSubBoolToken("VIEW_PANORAMA", 1, m_renderPanorama);
+    ft.GetSubToken<float>("VIEW_WARP_RADIUS", 1, m_warpRadius);
 
-    if (ft.GetSubToken<int>("LIGHT_SOURCE_ACTIVE", 1, ival)) {
-        m_lights[0].SetActive(ival == 1);
+    if (ft.GetSubToken<int>("LIGHT_SOURCE_NUM", 1, ival) && ival > 0) {
+        m_lights.resize(static_cast<size_t>(ival));
     }
 
-    if (ft.GetSubTokens<float>("LIGHT_SOURCE_ANGLES", 1, 2, angles)) {
-        m_lights[0].Set(angles[0], angles[1]);
-    }
+    // the first light source has no number
+    for (size_t i = 0; i < m_lights.size(); i++) {
+        std::string prefix = "LIGHT_SOURCE" + (i > 0 ? std::to_string(i + 1) : std::string()) + "_";
+        if (ft.GetSubToken<int>((prefix + "ACTIVE").c_str(), 1, ival)) {
+            m_lights[i].SetActive(ival == 1);
+        }
 
-    if (ft.GetSubToken<float>("LIGHT_SOURCE_FACTOR", 1, fval)) {
-        m_lights[0].SetFactor(fval);
+        if (ft.GetSubTokens<float>((prefix + "ANGLES").c_str(), 1, 2, angles)) {
+            m_lights[i].Set(angles[0], angles[1]);
+        }
+
+        if (ft.GetSubToken<float>((prefix + "FACTOR").c_str(), 1, fval)) {
+            m_lights[i].SetFactor(fval);
+        }
     }
+    ft.GetSubBoolToken("LIGHT_DEFERRED", 1, m_deferredLighting);
+    ft.GetSubToken<float>("LIGHT_CUTOFF", 1, m_lightCutoff);
 
     if (ft.GetSubTokens<float>("BACKGROUND_COLOR", 1, 3, color)) {
         m_clearColor[0] = color[0];
@@ -1062,9 +1786,6 @@ void Renderer::saveSetting(const char* filename)
     m_eulerRot.Get(rot);
     m_blackhole.GetColor(color);
 
-    float theta,phi;
-    m_lights[0].Get(theta, phi);
-
     fprintf(fptr, "CAMERA_PROJ %s\n", m_camera.GetProjectionName());
     fprintf(fptr, "CAMERA_POS  %6.3f %6.3f %6.3f\n", pos[0], pos[1], pos[2]);
     fprintf(fptr, "CAMERA_POI  %6.3f %6.3f %6.3f\n", poi[0], poi[1], poi[2]);
@@ -1085,15 +1806,26 @@ void Renderer::saveSetting(const char* filename)
     fprintf(fptr, "\n");
 
     fprintf(fptr, "VIEW_MODE            %s\n", ViewModeNames[static_cast<int>(m_viewMode)]);
+    fprintf(fptr, "VIEW_LUT_FILTER      %s\n", LUT::FilterNames[static_cast<int>(m_lutFilter)]);
     fprintf(fptr, "VIEW_MAX_TESS_LEVEL  %d\n", m_maxTessLevel);
     fprintf(fptr, "VIEW_TESS_FACTOR     %.1f\n", m_tessFactor);
     fprintf(fptr, "VIEW_TESS_EXPON      %.2f\n", m_tessExpon);
     fprintf(fptr, "VIEW_WIREFRAME       %d\n", (m_wireframe ? 1 : 0));
+    fprintf(fptr, "VIEW_PANORAMA        %d\n", (m_renderPanorama ? 1 : 0));
+    fprintf(fptr, "VIEW_WARP_RADIUS     %.2f\n", m_warpRadius);
     fprintf(fptr, "\n");
 
-    fprintf(fptr, "LIGHT_SOURCE_ACTIVE  %d\n", (m_lights[0].IsActive() ? 1 : 0));
-    fprintf(fptr, "LIGHT_SOURCE_ANGLES  %5.2f %5.2f\n", theta, phi);
-    fprintf(fptr, "LIGHT_SOURCE_FACTOR  %5.3f\n", m_lights[0].GetFactor());
+    fprintf(fptr, "LIGHT_SOURCE_NUM     %d\n", static_cast<int>(m_lights.size()));
+    for (size_t i = 0; i < m_lights.size(); i++) {
+        float theta, phi;
+        m_lights[i].Get(theta, phi);
+        std::string prefix = "LIGHT_SOURCE" + (i > 0 ? std::to_string(i + 1) : std::string()) + "_";
+        fprintf(fptr, "%-20s %d\n", (prefix + "ACTIVE").c_str(), (m_lights[i].IsActive() ? 1 : 0));
+        fprintf(fptr, "%-20s %5.2f %5.2f\n", (prefix + "ANGLES").c_str(), theta, phi);
+        fprintf(fptr, "%-20s %5.3f\n", (prefix + "FACTOR").c_str(), m_lights[i].GetFactor());
+    }
+    fprintf(fptr, "LIGHT_DEFERRED       %d\n", (m_deferredLighting ? 1 : 0));
+    fprintf(fptr, "LIGHT_CUTOFF         %.5f\n", m_lightCutoff);
     fprintf(fptr, "\n");
 
     fprintf(fptr, "BACKGROUND_COLOR     %5.3f %5.3f %5.3f\n", m_clearColor[0], m_clearColor[1], m_clearColor[2]);
@@ -10,17 +10,29 @@
 #include <iostream>
 #include <vector>
 
+#include <glm/glm.hpp>
+
 #include "AnimOrbitCam.h"
+#include "BlackHoleShadow.h"
 #include "Camera.h"
 #include "CoordSystem.h"
 #include "CrossHairs3D.h"
+#include "DeflectionMap.h"
 #include "EulerRotation.h"
+#include "GBuffer.h"
 #include "GLShader.h"
+#include "GPUProfiler.h"
+#include "GRProjector.h"
+#include "LightList.h"
 #include "LightSource.h"
 #include "LUT.h"
 #include "Mouse.h"
 #include "OBJLoader.h"
-#include "SDSphere.h"
+#include "Panorama.h"
+#include "PatternAtlas.h"
+#include "TessGeometryCache.h"
+#include "TessPresets.h"
+#include "TextureLoader.h"
 #include "TransScale.h"
 #include "VertexArray.h"
 
@@ -28,7 +40,7 @@ class Renderer
 {
 public:
     enum class MouseCtrl : int { Camera = 0, Object, Count };
-    enum class ViewMode : int { Flat = 0, GR, GRgeom, GRtess, Count };
+    enum class ViewMode : int { Flat = 0, GR, GRgeom, GRtess, Warp, Count };
 
     static const char* const MouseCtrlNames[];
     static const char* const ViewModeNames[];
@@ -39,8 +51,18 @@ public:
 
     bool Display();
 
+    /**
+     * @brief Advance animations (camera orbit, object rotation).
+     * @return true while an animation is running.
+     */
     bool Idle(double time);
 
+    /// Whether the scene has to be rendered again.
+    bool IsDirty();
+
+    /// Request a new frame, e.g. after a change which the renderer cannot observe itself.
+    void SetDirty();
+
     bool Init(int width, int height);
 
     bool KeyPressEvent(int key, int mods);
@@ -51,8 +73,21 @@ public:
 
     bool LoadObject(const char* filename);
 
+    /**
+     * @brief Replace the current object by a procedurally generated disk.
+     * @param numTriangles  Approximate number of triangles.
+     * @param rIn           Inner radius.
+     * @param rOut          Outer radius.
+     */
+    bool LoadDisk(unsigned int numTriangles, float rIn, float rOut);
+
     bool LoadSetting(const char* filename);
 
+    /**
+     * @brief Load tessellation presets generated by GRPolyRenTune.
+     */
+    bool LoadTessPresets(const char* filename);
+
     bool Motion(double x, double y);
 
     bool Mouse(int button, int action, int mods);
@@ -61,15 +96,32 @@ public:
 
     void SaveSetting(const char* filename);
 
+    /**
+     * @brief Enable automatic tessellation and select the cheapest preset
+     *        whose pixel error is below 'targetError' [%].
+     */
+    void SetTessTargetError(double targetError);
+
     void SetWindowSize(int width, int height);
 
     void UpdateMousePos(double x, double y);
 
+    /// Whether camera or object transformation changed with the last Display().
+    bool ViewChanged();
+
     void RenderGUI();
 
     void SetViewMode(ViewMode mode);
     void SetViewModeByName(const char* mode);
 
+    /**
+     * @brief Set reconstruction filter of the lookup table.
+     *   Hermite needs a lookup table with derivatives, otherwise Bicubic is used;
+     *   Chebyshev needs a fit, otherwise Bilinear is used.
+     */
+    void SetLUTFilter(LUT::Filter filter);
+    void SetLUTFilterByName(const char* filter);
+
     void GetClearColor(float* rgb);
     void SetClearColor(float* rgb);
     void SetClearColor(float r, float g, float b);
@@ -84,7 +136,61 @@ protected:
     bool mouseCameraCtrl(double x, double y);
     bool mouseObjectCtrl(double x, double y);
 
-    void drawObject(GLShader* shader, bool drawAsPatch);
+    /// Capture tessellated geometry of both image orders into the tessellation cache.
+    void captureTessGeometry(const glm::mat4& modelMX, const glm::mat4& obsCamViewMX);
+
+    /// Apply tessellation preset matching the target pixel error.
+    void applyTessPreset();
+
+    /// Draw the captured parts of the object from the tessellation cache.
+    void drawCachedObject(GLShader* shader, int order);
+
+    /// Draw all parts of the object, every part with 'numInstances' instances.
+    void drawObject(GLShader* shader, bool drawAsPatch, int numInstances = 1);
+
+    /// Lookup table filter supported by the current lookup table.
+    LUT::Filter getLUTFilter();
+
+    /// Maximum tessellation level scaled by m_tessLevelScale.
+    int getMaxTessLevel();
+
+    /// Radius of the source sphere of the Warp mode within the radial range of the lookup table.
+    float getWarpRadius();
+
+    /**
+     * @brief Select shader variant for image order, object texture, light, and panorama.
+     *   The features are compiled in as defines, see GLShader::SelectVariant.
+     */
+    bool selectVariant(GLShader* shader, int order, bool deferred = false, bool panorama = false);
+
+    /// Whether at least one light source is active.
+    bool isAnyLightActive();
+
+    /**
+     * @brief Bin the light sources per screen tile and light the G-buffer
+     *        in a full-screen pass into the current framebuffer.
+     * @param viewport  Viewport of the current framebuffer.
+     */
+    void renderLighting(const glm::mat4& modelMX, const glm::mat4& obsCamViewMX, const GLint* viewport);
+
+    /**
+     * @brief Warp the observer's cubemap into the current framebuffer.
+     *   The deflection map is only computed if observer, camera, or resolution changed.
+     * @param viewport  Viewport of the current framebuffer.
+     */
+    void renderWarp(const glm::mat4& modelMX, const glm::mat4& obsCamViewMX, const GLint* viewport);
+
+    /// Set colors and texture of the material of object part 'i'.
+    void setMaterial(GLShader* shader, unsigned int i);
+
+    /// Set matrices, lookup table, and tessellation uniforms.
+    void setUniforms(GLShader* shader, const glm::mat4& modelMX, const glm::mat4& obsCamViewMX);
+
+    /**
+     * @brief Merge identical vertices and upload object to the vertex array.
+     *   The draw arrays are compacted in place.
+     */
+    void uploadObject(float*& verts, float*& norm, float*& tc);
 
 #ifdef HAVE_IMGUI
     void renderGUImouse();
@@ -94,6 +200,7 @@ protected:
     void renderGUIview();
     void renderGUIlights();
     void renderGUIBackground();
+    void renderGUIprofiler();
 #endif // HAVE_IMGUI
 
     void loadSetting(const char* filename);
@@ -103,7 +210,7 @@ public:
     Camera m_camera;
     TransScale m_transScale;
     EulerRotation m_eulerRot;
-    SDSphere m_blackhole;
+    BlackHoleShadow m_blackhole;
     CoordSystem m_coordSystem;
     CrossHairs3D m_crossHairs;
 
@@ -111,31 +218,96 @@ public:
     float m_tessFactor;
     float m_tessExpon;
     float m_distRelation;
+
+    /// Keep tessellated geometry as long as object, LUT, and tessellation parameters do not change.
+    bool m_useGeometryCache;
+
+    /// Tessellation parameters are chosen from the presets to meet the target pixel error [%].
+    TessPresets m_tessPresets;
+    bool m_autoTess;
+    double m_tessTargetError;
+
+    /// Scale of maxTessLevel, set by the frame governor of the interactive version.
+    float m_tessLevelScale;
+
     int m_patFreq[2];
 
-    static const size_t m_numLights = 1;
-    LightSource m_lights[m_numLights];
+    /// Light sources, the active ones are uploaded to the light list every frame.
+    std::vector<LightSource> m_lights;
+
+    /// Deferred lighting drops lights below this value for every pixel of a screen tile.
+    float m_lightCutoff;
+
+    /**
+     * @brief Write position, normal, and albedo to a G-buffer and light every visible pixel once.
+     *   Only used in GRtess mode, the other modes have no lighting.
+     */
+    bool m_deferredLighting;
+
+    /**
+     * @brief Render the full sky of the observer in a single pass and show it as equirectangular image.
+     *   Deferred lighting, the tessellation cache, and the overlays are not used.
+     */
+    bool m_renderPanorama;
+
+    /// Radius of the sphere on which the Warp mode assumes all sources, 0: outer radius of the lookup table.
+    float m_warpRadius;
 
     OBJLoader m_obj;
-    
+
+    /// Material textures of the object, loaded in the background.
+    TextureLoader m_textureLoader;
+
+    GPUProfiler m_profiler;
+
 protected:
     GLShader m_shaderFlat;
     GLShader m_shaderGR;
     GLShader m_shaderGRgeom;
     GLShader m_shaderGRtess;
+    GLShader m_shaderGRtessCapture;
+    GLShader m_shaderGRcached;
+    GLShader m_shaderLighting;
+    GLShader m_shaderLightCull;
+    GLShader m_shaderWarp;
+    GLShader m_shaderWarpMap;
     GLShader* m_activeShader;
 
+    DeflectionMap m_deflectionMap;
+    GBuffer m_gbuffer;
+    LightList m_lightList;
+    Panorama m_panorama;
+    PatternAtlas m_patternAtlas;
+
+    GRProjector m_projector;
+    TessGeometryCache m_tessCache;
+    float m_tessCacheParams[4];
+
+    float m_lastViewState[48];
+    bool m_viewChanged;
+
+    /// Set by every change of camera, object, LUT, or render parameters; cleared by Display().
+    bool m_isDirty;
+
+    /// Object rotation per frame [rad].
+    float m_orbitVel;
+
     AnimOrbitCam m_animCam;
 
     VertexArray m_objVA;
-    std::vector<GLuint> m_objTexIDs;
+    /// TextureLoader handle per material texture id, or -1.
+    std::vector<int> m_objTexHandles;
 
     LUT m_lut;
+    LUT::Filter m_lutFilter;
 
     double prevTime;
     grpr::Mouse lastMouse;
 
     MouseCtrl m_mouseCtrl;
+
+    /// Light source edited in the GUI.
+    int m_guiLight;
     ViewMode m_viewMode;
 
     float m_clearColor[3];
@@ -6,6 +6,9 @@
  */
 #include "SDSphere.h"
 
+#include <algorithm>
+#include <cmath>
+
 // basic vertices of an icosahedron
 #define ICSH_X .5257311f
 #define ICSH_Z .8506508f
@@ -20,9 +23,14 @@ const GLuint icsh_indices[20][3] = { { 0, 4, 1 }, { 0, 9, 4 }, { 9, 5, 4 }, { 4,
     { 0, 1, 6 }, { 6, 1, 10 }, { 9, 0, 11 }, { 9, 11, 2 }, { 9, 2, 5 }, { 7, 2, 11 } };
 
 SDSphere::SDSphere()
+    : m_apparentSize(-1)
+    , m_numSubDivs(0)
 {
     m_center = glm::vec3(0.0f);
     SetRadius(1.0f);
+    for (unsigned int l = 0; l <= MaxSubdivisions; l++) {
+        m_isUploaded[l] = false;
+    }
 }
 
 SDSphere::~SDSphere() {}
@@ -49,9 +57,13 @@ void SDSphere::Draw(const float* projMXptr, const float* viewMXptr, const float*
 
     m_shader.SetFloatArray("m_color", 4, 1, glm::value_ptr(m_color));
     m_shader.SetFloat("flatShading", (m_isFlatShading ? 1.0f : 0.0f));
-    m_va.Bind();
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_numFaces * 3), GL_UNSIGNED_INT, nullptr);
-    m_va.Release();
+    unsigned int level = selectLevel();
+    if (!m_isUploaded[level]) {
+        genLevel(level);
+    }
+    m_levelVA[level].Bind();
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices[level].size()), GL_UNSIGNED_INT, nullptr);
+    m_levelVA[level].Release();
 
     m_shader.Release();
 }
@@ -60,7 +72,7 @@ bool SDSphere::Init()
 {
     //fprintf(stderr, "Initialize SDSphere ...\n");
 
-    SetSubdivisions(1);
+    SetSubdivisions(MaxSubdivisions);
 
     setModelMatrix();
 
@@ -87,157 +99,87 @@ void SDSphere::SetRadius(float radius)
     setModelMatrix();
 }
 
+void SDSphere::SetApparentSize(int pixels)
+{
+    m_apparentSize = pixels;
+}
+
 void SDSphere::SetSubdivisions(unsigned int numSubDivs)
 {
-    clear();
-    m_numVertices = 12;
-
-    // copy vertices from static array to vector array and generate texture coordinates
-    for (unsigned int i = 0; i < m_numVertices; i++) {
-        glm::vec3 nv = glm::vec3(icsh_data[i][0], icsh_data[i][1], icsh_data[i][2]);
-        glm::vec2 tc;
-        calcTexCoords(nv, tc);
-        svertices.push_back(nv);
-        snormals.push_back(glm::normalize(glm::vec3(icsh_data[i][0], icsh_data[i][1], icsh_data[i][2])));
-        stcoords.push_back(tc);
-    }
-    assert(svertices.size() == m_numVertices);
-
-    // copy indices from static array to vector array
-    m_numFaces = 20;
-    for (unsigned int i = 0; i < m_numFaces; i++) {
-        int ni0 = static_cast<int>(icsh_indices[i][0]);
-        int ni1 = static_cast<int>(icsh_indices[i][1]);
-        int ni2 = static_cast<int>(icsh_indices[i][2]);
-        sindices.push_back(ni0);
-        sindices.push_back(ni1);
-        sindices.push_back(ni2);
-    }
-    assert(sindices.size() == m_numFaces * 3);
-
-    // do subdivision
-    unsigned int nf = m_numFaces;
-    if (numSubDivs > 0) {
-        for (unsigned int f = 0; f < nf; f++) {
-            glm::vec3 v1 = glm::vec3(svertices[static_cast<size_t>(sindices[3 * f + 0])]);
-            glm::vec3 v2 = glm::vec3(svertices[static_cast<size_t>(sindices[3 * f + 1])]);
-            glm::vec3 v3 = glm::vec3(svertices[static_cast<size_t>(sindices[3 * f + 2])]);
-            // fprintf(stderr,"face %2d : %2d %2d %2d\n",f,sindices[3*f+0],sindices[3*f+1],sindices[3*f+2]);
-            subdivideTriangle(v1, v2, v3, numSubDivs);
-        }
+    m_numSubDivs = std::min(numSubDivs, static_cast<unsigned int>(MaxSubdivisions));
+}
 
-        // remove the original faces
-        std::vector<int>::iterator istart = sindices.begin();
-        std::vector<int>::iterator iend = istart + nf * 3;
-        sindices.erase(istart, iend);
-        m_numFaces -= nf;
+void SDSphere::genLevel(unsigned int level)
+{
+    if (m_indices[0].empty()) {
+        m_vertices.clear();
+        for (unsigned int i = 0; i < 12; i++) {
+            m_vertices.push_back(glm::vec3(icsh_data[i][0], icsh_data[i][1], icsh_data[i][2]));
+        }
+        m_indices[0].assign(&icsh_indices[0][0], &icsh_indices[0][0] + 60);
     }
 
-    for (unsigned int f = 0; f < m_numFaces; f++) {
-        size_t idx1 = static_cast<size_t>(sindices[3 * f + 0]);
-        size_t idx2 = static_cast<size_t>(sindices[3 * f + 1]);
-        size_t idx3 = static_cast<size_t>(sindices[3 * f + 2]);
-        glm::vec3 v1 = svertices[idx1];
-        glm::vec3 v2 = svertices[idx2];
-        glm::vec3 v3 = svertices[idx3];
-        glm::vec2 tc1 = stcoords[idx1];
-        glm::vec2 tc2 = stcoords[idx2];
-        glm::vec2 tc3 = stcoords[idx3];
-
-        if (v1[0] < 0.0f && v2[0] < 0.0f && v3[0] < 0.0f) {
-            //  if (v1[1]<0.0) {
-
-            if (!((v1[1] < 0 && v2[1] < 0 && v3[1] < 0) || (v1[1] > 0 && v2[1] > 0 && v3[1] > 0))) {
-                if (v1[1] < 0)
-                    tc1 = glm::vec2(tc1[0] + 1.0f, tc1[1]);
-                if (v2[1] < 0)
-                    tc2 = glm::vec2(tc2[0] + 1.0f, tc2[1]);
-                if (v3[1] < 0)
-                    tc3 = glm::vec2(tc3[0] + 1.0f, tc3[1]);
-
-                stcoords[idx1] = tc1;
-                stcoords[idx2] = tc2;
-                stcoords[idx3] = tc3;
-            }
+    // every triangle is split into four, the midpoints are shared with the neighbor
+    for (unsigned int l = 1; l <= level; l++) {
+        if (!m_indices[l].empty()) {
+            continue;
+        }
+        const std::vector<GLuint>& src = m_indices[l - 1];
+        std::vector<GLuint>& dst = m_indices[l];
+        std::unordered_map<unsigned long long, GLuint> cache;
+        dst.reserve(src.size() * 4);
+        for (size_t f = 0; f < src.size(); f += 3) {
+            GLuint v1 = src[f + 0];
+            GLuint v2 = src[f + 1];
+            GLuint v3 = src[f + 2];
+            GLuint v12 = midpoint(v1, v2, cache);
+            GLuint v23 = midpoint(v2, v3, cache);
+            GLuint v31 = midpoint(v3, v1, cache);
+            dst.insert(dst.end(), { v1, v12, v31, v2, v23, v12, v3, v31, v23, v12, v23, v31 });
         }
     }
 
-    m_va.Delete();
-    m_va.Create(m_numVertices);
-    m_va.SetArrayBuffer(0, GL_FLOAT, 3, &svertices[0]);
-    m_va.SetArrayBuffer(1, GL_FLOAT, 3, &snormals[0]);
-    m_va.SetArrayBuffer(3, GL_FLOAT, 2, &stcoords[0]);
-    m_va.SetElementBuffer(0, m_numFaces * 3, &sindices[0]);
-}
-
-void SDSphere::addTriangle(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3)
-{
-    size_t idx = svertices.size();
-
-    svertices.push_back(v1);
-    svertices.push_back(v2);
-    svertices.push_back(v3);
-    snormals.push_back(v1);
-    snormals.push_back(v2);
-    snormals.push_back(v3);
-
-    glm::vec2 tc1, tc2, tc3;
-    calcTexCoords(v1, tc1);
-    calcTexCoords(v2, tc2);
-    calcTexCoords(v3, tc3);
-    stcoords.push_back(tc1);
-    stcoords.push_back(tc2);
-    stcoords.push_back(tc3);
-
-    sindices.push_back(static_cast<int>(idx) + 0);
-    sindices.push_back(static_cast<int>(idx) + 1);
-    sindices.push_back(static_cast<int>(idx) + 2);
-
-    m_numFaces++;
-    m_numVertices += 3;
+    // vertices of a level are a prefix of the vertex list; on the unit sphere, normals equal positions
+    unsigned int numVertices = 10 * (1u << (2 * level)) + 2;
+    VertexArray& va = m_levelVA[level];
+    va.Delete();
+    va.Create(numVertices);
+    va.SetArrayBuffer(0, GL_FLOAT, 3, m_vertices.data());
+    va.SetArrayBuffer(1, GL_FLOAT, 3, m_vertices.data());
+    va.SetElementBuffer(0, static_cast<unsigned int>(m_indices[level].size()), m_indices[level].data());
+    m_isUploaded[level] = true;
 }
 
-void SDSphere::calcTexCoords(glm::vec3 v, glm::vec2& tc)
+GLuint SDSphere::midpoint(GLuint a, GLuint b, std::unordered_map<unsigned long long, GLuint>& cache)
 {
-    double th, ph;
-    th = acos(v[2]);
-    ph = atan2(v[1], v[0]);
-    tc[0] = static_cast<float>(ph / (2.0 * glm::pi<double>()) + 0.5);
-    tc[1] = static_cast<float>(th / glm::pi<double>());
-}
+    unsigned long long key = (static_cast<unsigned long long>(std::min(a, b)) << 32) | std::max(a, b);
+    auto itr = cache.find(key);
+    if (itr != cache.end()) {
+        return itr->second;
+    }
 
-void SDSphere::clear()
-{
-    svertices.clear();
-    snormals.clear();
-    stcoords.clear();
-    sindices.clear();
+    GLuint idx = static_cast<GLuint>(m_vertices.size());
+    m_vertices.push_back(glm::normalize(m_vertices[a] + m_vertices[b]));
+    cache[key] = idx;
+    return idx;
 }
 
-void SDSphere::subdivideTriangle(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, unsigned int depth)
+unsigned int SDSphere::selectLevel()
 {
-    glm::vec3 v12;
-    glm::vec3 v23;
-    glm::vec3 v31;
-
-    if (depth == 0) {
-        addTriangle(v1, v2, v3);
-        return;
+    if (m_apparentSize < 0) {
+        return m_numSubDivs;
     }
 
-    for (int i = 0; i < 3; i++) {
-        v12[i] = v1[i] + v2[i];
-        v23[i] = v2[i] + v3[i];
-        v31[i] = v3[i] + v1[i];
+    // An edge spanning angle a deviates r*a^2/8 pixels from a silhouette of radius r.
+    // The edge angle of the icosahedron (1.107 rad) halves with every level.
+    const double maxDeviation = 0.5;
+    double r = std::max(1.0, static_cast<double>(m_apparentSize));
+    double minSplits = 1.107 * sqrt(r / (8.0 * maxDeviation));
+    unsigned int level = 0;
+    while (level < m_numSubDivs && static_cast<double>(1u << level) < minSplits) {
+        level++;
     }
-
-    v12 = glm::normalize(v12);
-    v23 = glm::normalize(v23);
-    v31 = glm::normalize(v31);
-    subdivideTriangle(glm::normalize(v1), v12, v31, depth - 1);
-    subdivideTriangle(glm::normalize(v2), v23, v12, depth - 1);
-    subdivideTriangle(glm::normalize(v3), v31, v23, depth - 1);
-    subdivideTriangle(v12, v23, v31, depth - 1);
+    return level;
 }
 
 void SDSphere::setModelMatrix()
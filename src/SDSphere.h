@@ -7,12 +7,24 @@
 #ifndef GRPR_SDSPHERE_H
 #define GRPR_SDSPHERE_H
 
+#include <unordered_map>
 #include <vector>
 
 #include "Object.h"
 
+/**
+ * @brief Icosphere of the black hole.
+ *   The indexed meshes of all subdivision levels share one vertex list, the
+ *   midpoints of a level are appended to the vertices of the previous level.
+ *   Meshes are generated on first use and kept. Every frame, the coarsest
+ *   level whose silhouette deviates less than half a pixel from the sphere
+ *   is drawn, see SetApparentSize().
+ */
 class SDSphere : public Object
 {
+public:
+    static const unsigned int MaxSubdivisions = 6;
+
 public:
     SDSphere();
     virtual ~SDSphere();
@@ -27,6 +39,14 @@ public:
 
     void SetRadius(float radius);
 
+    /**
+     * @brief Set apparent radius for the level of detail.
+     * @param pixels  Apparent radius in pixels, see Camera::GetApparentSphereSize();
+     *                negative if the camera is inside, then the finest level is drawn.
+     */
+    void SetApparentSize(int pixels);
+
+    /// Finest subdivision level (at most MaxSubdivisions).
     void SetSubdivisions(unsigned int numSubDivs);
 
 protected:
@@ -35,23 +55,27 @@ protected:
 #pragma warning(disable : 4251)
 #endif
 
-    void addTriangle(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3);
-    void calcTexCoords(glm::vec3 v, glm::vec2& tc);
-    void clear();
-    void subdivideTriangle(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, unsigned int depth);
+    /// Generate indices of all levels up to 'level' if missing and upload the mesh of 'level'.
+    void genLevel(unsigned int level);
+
+    /// Index of the normalized midpoint of edge (a,b), shared by both adjacent triangles.
+    GLuint midpoint(GLuint a, GLuint b, std::unordered_map<unsigned long long, GLuint>& cache);
+
+    unsigned int selectLevel();
 
     void setModelMatrix();
 
 protected:
     float m_radius;
-    
-    std::vector<glm::vec3> svertices;
-    std::vector<glm::vec3> snormals;
-    std::vector<glm::vec2> stcoords;
-    std::vector<int> sindices;
-
-    unsigned int m_numVertices;
-    unsigned int m_numFaces;
+    int m_apparentSize;
+    unsigned int m_numSubDivs;
+
+    std::vector<glm::vec3> m_vertices;
+    std::vector<GLuint> m_indices[MaxSubdivisions + 1];
+    VertexArray m_levelVA[MaxSubdivisions + 1];
+
+    /// Indices of finer levels include the coarser ones, but only drawn levels are uploaded.
+    bool m_isUploaded[MaxSubdivisions + 1];
 };
 
 #endif // GRPR_SDSPHERE_H
@@ -0,0 +1,221 @@
+/**
+ * File:    TessGeometryCache.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "TessGeometryCache.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// apparent position, position, normal, texture coordinates
+constexpr GLsizei NumFloatsPerVertex = 3 + 3 + 3 + 2;
+constexpr size_t VertexSize = NumFloatsPerVertex * sizeof(GLfloat);
+constexpr size_t MinNumVertices = 3 * 1024;
+
+TessGeometryCache::TessGeometryCache()
+    : m_numRangesIssued(0)
+    , m_isCapturing(false)
+    , m_hasFailed(false)
+    , m_maxMemorySize(size_t(512) << 20)
+{
+    for (int i = 0; i < NumOrders; i++) {
+        m_tfo[i] = m_buf[i] = m_va[i] = 0;
+        m_capacity[i] = m_numTriangles[i] = 0;
+        m_isCaptured[i] = false;
+    }
+}
+
+TessGeometryCache::~TessGeometryCache()
+{
+    //
+}
+
+void TessGeometryCache::BeginCapture(int order, size_t minNumVertices)
+{
+    if (m_capacity[order] < minNumVertices) {
+        resize(order, minNumVertices);
+    }
+    m_isCaptured[order] = false;
+    m_numRangesIssued = 0;
+    m_isCapturing = true;
+
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_tfo[order]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_buf[order]);
+    glBeginTransformFeedback(GL_TRIANGLES);
+}
+
+void TessGeometryCache::BeginRange()
+{
+    if (m_numRangesIssued == m_rangeQueries.size()) {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        m_rangeQueries.push_back(query);
+    }
+    glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, m_rangeQueries[m_numRangesIssued]);
+}
+
+bool TessGeometryCache::EndCapture(int order)
+{
+    glEndTransformFeedback();
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    m_isCapturing = false;
+
+    // ranges are written back to back
+    m_rangeFirst[order].resize(m_numRangesIssued);
+    m_rangeCount[order].resize(m_numRangesIssued);
+    GLuint64 numWritten = 0;
+    for (size_t i = 0; i < m_numRangesIssued; i++) {
+        GLuint64 numRange = 0;
+        glGetQueryObjectui64v(m_rangeQueries[i], GL_QUERY_RESULT, &numRange);
+        m_rangeFirst[order][i] = static_cast<size_t>(numWritten);
+        m_rangeCount[order][i] = static_cast<size_t>(numRange);
+        numWritten += numRange;
+    }
+
+    // A full buffer means that primitives might have been dropped.
+    if (numWritten * 3 >= m_capacity[order]) {
+        size_t capacity = 2 * m_capacity[order];
+        size_t otherSize = m_capacity[1 - order] * VertexSize;
+        if (capacity * VertexSize + otherSize > m_maxMemorySize) {
+            fprintf(stderr, "TessGeometryCache: tessellated geometry exceeds %zu MB, cache disabled.\n",
+                m_maxMemorySize >> 20);
+            m_hasFailed = true;
+            return true;
+        }
+        resize(order, capacity);
+        return false;
+    }
+
+    m_numTriangles[order] = static_cast<size_t>(numWritten);
+    m_isCaptured[order] = true;
+    return true;
+}
+
+void TessGeometryCache::EndRange()
+{
+    glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+    m_numRangesIssued++;
+}
+
+void TessGeometryCache::Delete()
+{
+    for (int i = 0; i < NumOrders; i++) {
+        if (m_va[i] > 0) {
+            glDeleteVertexArrays(1, &m_va[i]);
+        }
+        if (glIsBuffer(m_buf[i])) {
+            glDeleteBuffers(1, &m_buf[i]);
+        }
+        if (m_tfo[i] > 0) {
+            glDeleteTransformFeedbacks(1, &m_tfo[i]);
+        }
+        m_tfo[i] = m_buf[i] = m_va[i] = 0;
+        m_capacity[i] = m_numTriangles[i] = 0;
+        m_isCaptured[i] = false;
+        m_rangeFirst[i].clear();
+        m_rangeCount[i].clear();
+    }
+
+    if (!m_rangeQueries.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(m_rangeQueries.size()), m_rangeQueries.data());
+        m_rangeQueries.clear();
+    }
+    m_numRangesIssued = 0;
+}
+
+void TessGeometryCache::Draw(int order, size_t range)
+{
+    if (!m_isCaptured[order] || range >= m_rangeCount[order].size() || m_rangeCount[order][range] == 0) {
+        return;
+    }
+
+    glBindVertexArray(m_va[order]);
+    glDrawArrays(GL_TRIANGLES, static_cast<GLint>(3 * m_rangeFirst[order][range]),
+        static_cast<GLsizei>(3 * m_rangeCount[order][range]));
+    glBindVertexArray(0);
+}
+
+size_t TessGeometryCache::GetMemorySize()
+{
+    return (m_capacity[0] + m_capacity[1]) * VertexSize;
+}
+
+size_t TessGeometryCache::GetNumRanges(int order)
+{
+    return (m_isCaptured[order] ? m_rangeCount[order].size() : 0);
+}
+
+size_t TessGeometryCache::GetNumTriangles(int order)
+{
+    return (m_isCaptured[order] ? m_numTriangles[order] : 0);
+}
+
+std::vector<std::string> TessGeometryCache::GetVaryings()
+{
+    return { "gApparentPos", "gPosition", "gNormal", "gTexCoords" };
+}
+
+bool TessGeometryCache::HasFailed()
+{
+    return m_hasFailed;
+}
+
+void TessGeometryCache::Init()
+{
+    glGenTransformFeedbacks(NumOrders, m_tfo);
+    glGenBuffers(NumOrders, m_buf);
+    glGenVertexArrays(NumOrders, m_va);
+
+    const GLint dims[] = { 3, 3, 3, 2 };
+    for (int i = 0; i < NumOrders; i++) {
+        resize(i, MinNumVertices);
+
+        // The vertex array refers to the buffer name, which stays the same when resizing.
+        glBindVertexArray(m_va[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buf[i]);
+        size_t offset = 0;
+        for (GLuint a = 0; a < 4; a++) {
+            glEnableVertexAttribArray(a);
+            glVertexAttribPointer(a, dims[a], GL_FLOAT, GL_FALSE, static_cast<GLsizei>(VertexSize),
+                reinterpret_cast<const void*>(offset));
+            offset += dims[a] * sizeof(GLfloat);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void TessGeometryCache::Invalidate()
+{
+    m_isCaptured[0] = m_isCaptured[1] = false;
+    m_hasFailed = false;
+}
+
+bool TessGeometryCache::IsCapturing()
+{
+    return m_isCapturing;
+}
+
+bool TessGeometryCache::IsValid()
+{
+    return m_isCaptured[0] && m_isCaptured[1];
+}
+
+void TessGeometryCache::SetMaxMemorySize(size_t bytes)
+{
+    m_maxMemorySize = bytes;
+    Invalidate();
+}
+
+void TessGeometryCache::resize(int order, size_t numVertices)
+{
+    TRACE_SCOPE("TessGeometryCache::resize");
+    numVertices = std::max(numVertices, MinNumVertices);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buf[order]);
+    glBufferData(GL_ARRAY_BUFFER, numVertices * VertexSize, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_capacity[order] = numVertices;
+}
@@ -0,0 +1,105 @@
+/**
+ * File:    TessGeometryCache.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_TESS_GEOMETRY_CACHE_H
+#define GRPR_TESS_GEOMETRY_CACHE_H
+
+#include "glad/glad.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Transform feedback cache of the tessellated GR geometry.
+ *
+ *   The output of the GRtess pipeline (tessellation evaluation shader) is
+ *   captured once per image order. As long as the cache is valid, a frame only
+ *   needs to rasterize the captured triangles with the current view. Every part
+ *   of the object is captured into its own range, such that its material can be
+ *   bound before the range is drawn.
+ *
+ *   Captured per vertex (interleaved): apparent position (3), object position (3),
+ *   normal (3), texture coordinates (2). These are the outputs of shader/grpr.te.
+ *   The buffers grow by doubling if the capture does not fit, up to a memory limit.
+ *   If the geometry does not fit into the limit, the cache remains invalid and
+ *   HasFailed() returns true until the next Invalidate().
+ */
+class TessGeometryCache
+{
+public:
+    TessGeometryCache();
+    ~TessGeometryCache();
+
+    /**
+     * @brief Start capturing the geometry of an image order.
+     *   The capture program has to be bound and the rasterizer discarded.
+     * @param order   Image order (0,1).
+     * @param minNumVertices  Minimum buffer capacity in vertices.
+     */
+    void BeginCapture(int order, size_t minNumVertices);
+
+    /// Start the range of the next object part; ranges are numbered in capture order.
+    void BeginRange();
+
+    /**
+     * @brief Finish capture.
+     * @return false if the buffer was too small and the capture has to be repeated.
+     */
+    bool EndCapture(int order);
+
+    void EndRange();
+
+    void Delete();
+
+    /// Draw captured triangles of one range. Vertex attributes 0-3 as described above.
+    void Draw(int order, size_t range);
+
+    size_t GetMemorySize();
+    size_t GetNumRanges(int order);
+    size_t GetNumTriangles(int order);
+
+    /// Names of the captured output variables.
+    static std::vector<std::string> GetVaryings();
+
+    bool HasFailed();
+
+    void Init();
+
+    void Invalidate();
+
+    /// Between BeginCapture and EndCapture.
+    bool IsCapturing();
+
+    /// Cache is valid if both image orders are captured.
+    bool IsValid();
+
+    void SetMaxMemorySize(size_t bytes);
+
+protected:
+    void resize(int order, size_t numVertices);
+
+protected:
+    static const int NumOrders = 2;
+
+    GLuint m_tfo[NumOrders];
+    GLuint m_buf[NumOrders];
+    GLuint m_va[NumOrders];
+
+    /// One primitives-written query per range, results are read in EndCapture.
+    std::vector<GLuint> m_rangeQueries;
+    size_t m_numRangesIssued;
+    std::vector<size_t> m_rangeFirst[NumOrders];
+    std::vector<size_t> m_rangeCount[NumOrders];
+
+    size_t m_capacity[NumOrders];
+    size_t m_numTriangles[NumOrders];
+    bool m_isCaptured[NumOrders];
+    bool m_isCapturing;
+    bool m_hasFailed;
+    size_t m_maxMemorySize;
+};
+
+#endif // GRPR_TESS_GEOMETRY_CACHE_H
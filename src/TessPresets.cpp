@@ -0,0 +1,151 @@
+/**
+ * File:    TessPresets.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "TessPresets.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+/**
+ *  Read number following 'key' in 'line'.
+ */
+static bool readValue(const std::string& line, const char* key, double& value)
+{
+    size_t pos = line.find(key);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    value = atof(line.c_str() + pos + strlen(key));
+    return true;
+}
+
+TessPresets::TessPresets()
+{
+    //
+}
+
+TessPresets::~TessPresets()
+{
+    //
+}
+
+void TessPresets::Clear()
+{
+    m_presets.clear();
+}
+
+const TessPresets::Preset& TessPresets::GetPreset(size_t idx)
+{
+    return m_presets[idx];
+}
+
+size_t TessPresets::GetNumPresets()
+{
+    return m_presets.size();
+}
+
+bool TessPresets::Load(const char* filename)
+{
+    TRACE_SCOPE("TessPresets::Load");
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        fprintf(stderr, "Cannot open tessellation preset file '%s'.\n", filename);
+        return false;
+    }
+
+    std::vector<Preset> presets;
+    std::string line;
+    while (std::getline(in, line)) {
+        double maxTessLevel, tessFactor, tessExpon, distRelation;
+        Preset p;
+        if (readValue(line, "\"maxTessLevel\": ", maxTessLevel) && readValue(line, "\"tessFactor\": ", tessFactor)
+            && readValue(line, "\"tessExpon\": ", tessExpon) && readValue(line, "\"distRelation\": ", distRelation)
+            && readValue(line, "\"pixelError\": ", p.pixelError) && readValue(line, "\"gpu_ms\": ", p.gpuMS)
+            && readValue(line, "\"primitives\": ", p.primitives)) {
+            p.maxTessLevel = static_cast<int>(maxTessLevel);
+            p.tessFactor = static_cast<float>(tessFactor);
+            p.tessExpon = static_cast<float>(tessExpon);
+            p.distRelation = static_cast<float>(distRelation);
+            presets.push_back(p);
+        }
+    }
+
+    if (presets.empty()) {
+        fprintf(stderr, "No tessellation presets found in '%s'.\n", filename);
+        return false;
+    }
+
+    SetParetoFront(presets);
+    fprintf(stderr, "%zu tessellation presets loaded from '%s'.\n", m_presets.size(), filename);
+    return true;
+}
+
+bool TessPresets::Save(const char* filename)
+{
+    FILE* fptr = nullptr;
+#ifdef _WIN32
+    fopen_s(&fptr, filename, "w");
+#else
+    fptr = fopen(filename, "w");
+#endif
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot open file '%s' for writing.\n", filename);
+        return false;
+    }
+
+    fprintf(fptr, "{\n  \"presets\": [\n");
+    for (size_t i = 0; i < m_presets.size(); i++) {
+        const Preset& p = m_presets[i];
+        fprintf(fptr,
+            "    {\"maxTessLevel\": %d, \"tessFactor\": %.3f, \"tessExpon\": %.3f, \"distRelation\": %.1f, "
+            "\"pixelError\": %.5f, \"gpu_ms\": %.4f, \"primitives\": %.0f}%s\n",
+            p.maxTessLevel, p.tessFactor, p.tessExpon, p.distRelation, p.pixelError, p.gpuMS, p.primitives,
+            (i + 1 < m_presets.size() ? "," : ""));
+    }
+    fprintf(fptr, "  ]\n}\n");
+    fclose(fptr);
+
+    fprintf(stderr, "Tessellation presets written to '%s'.\n", filename);
+    return true;
+}
+
+const TessPresets::Preset* TessPresets::Select(double targetError)
+{
+    if (m_presets.empty()) {
+        return nullptr;
+    }
+
+    for (const Preset& p : m_presets) {
+        if (p.pixelError <= targetError) {
+            return &p;
+        }
+    }
+    return &m_presets.back();
+}
+
+void TessPresets::SetParetoFront(const std::vector<Preset>& candidates)
+{
+    std::vector<Preset> sorted = candidates;
+    std::sort(sorted.begin(), sorted.end(), [](const Preset& a, const Preset& b) {
+        if (a.gpuMS != b.gpuMS) {
+            return a.gpuMS < b.gpuMS;
+        }
+        return a.pixelError < b.pixelError;
+    });
+
+    // Walking along increasing cost, a preset is kept only if it is more accurate than all cheaper ones.
+    m_presets.clear();
+    for (const Preset& p : sorted) {
+        if (m_presets.empty() || p.pixelError < m_presets.back().pixelError) {
+            m_presets.push_back(p);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * File:    TessPresets.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_TESS_PRESETS_H
+#define GRPR_TESS_PRESETS_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Tessellation presets with measured image error and cost.
+ *
+ *   The presets are generated by GRPolyRenTune, which sweeps the tessellation
+ *   parameters and compares every image against a highly tessellated reference.
+ *   Only Pareto-optimal settings (no other setting is both cheaper and more
+ *   accurate) are kept. At runtime, Select() returns the cheapest preset which
+ *   meets a target pixel error.
+ */
+class TessPresets
+{
+public:
+    struct Preset
+    {
+        int maxTessLevel;
+        float tessFactor;
+        float tessExpon;
+        float distRelation;
+        double pixelError; //!< Percentage of pixels deviating from the reference.
+        double gpuMS;      //!< GPU time per frame [ms].
+        double primitives; //!< Generated primitives per frame.
+    };
+
+public:
+    TessPresets();
+    ~TessPresets();
+
+    void Clear();
+
+    const Preset& GetPreset(size_t idx);
+    size_t GetNumPresets();
+
+    /**
+     * @brief Load presets written by Save().
+     * @param filename  Preset file name.
+     * @return true if at least one preset could be read.
+     */
+    bool Load(const char* filename);
+
+    /**
+     * @brief Save presets. Every preset is written into a single line.
+     */
+    bool Save(const char* filename);
+
+    /**
+     * @brief Select cheapest preset with pixel error below target.
+     * @param targetError  Maximum pixel error [%].
+     * @return Preset, or the most accurate one if no preset meets the target,
+     *         or nullptr if there are no presets.
+     */
+    const Preset* Select(double targetError);
+
+    /**
+     * @brief Set presets, only the Pareto front with respect to GPU time and
+     *        pixel error is kept.
+     */
+    void SetParetoFront(const std::vector<Preset>& candidates);
+
+protected:
+    /// Presets ordered by increasing GPU time (and decreasing pixel error).
+    std::vector<Preset> m_presets;
+};
+
+#endif // GRPR_TESS_PRESETS_H
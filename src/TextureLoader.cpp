@@ -0,0 +1,567 @@
+/**
+ * File:    TextureLoader.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "TextureLoader.h"
+#include "StringUtils.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+constexpr unsigned int NumSegments = 3;
+constexpr size_t SegmentSize = 8 * 1024 * 1024;
+constexpr unsigned int MaxNumWorkers = 4;
+constexpr size_t DefaultMemoryBudget = 256 * 1024 * 1024;
+
+TextureLoader::TextureLoader()
+    : m_numPending(0)
+    , m_memoryBudget(DefaultMemoryBudget)
+    , m_memoryUsed(0)
+    , m_generation(0)
+    , m_quit(false)
+    , m_pbo(0)
+    , m_pboPtr(nullptr)
+    , m_segment(0)
+{
+    for (unsigned int i = 0; i < NumSegments; i++) {
+        m_fences[i] = nullptr;
+    }
+}
+
+TextureLoader::~TextureLoader()
+{
+    stopWorkers();
+}
+
+void TextureLoader::Clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.clear();
+        m_done.clear();
+        m_generation++;
+    }
+
+    for (Entry& entry : m_entries) {
+        if (glIsTexture(entry.texID)) {
+            glDeleteTextures(1, &entry.texID);
+        }
+    }
+    m_entries.clear();
+    m_handles.clear();
+    m_uploads.clear();
+    m_numPending = 0;
+    m_memoryUsed = 0;
+}
+
+void TextureLoader::Delete()
+{
+    Clear();
+    for (unsigned int i = 0; i < NumSegments; i++) {
+        if (m_fences[i] != nullptr) {
+            glDeleteSync(m_fences[i]);
+            m_fences[i] = nullptr;
+        }
+    }
+    if (glIsBuffer(m_pbo)) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &m_pbo);
+    }
+    m_pbo = 0;
+    m_pboPtr = nullptr;
+}
+
+void TextureLoader::Finish()
+{
+    TRACE_SCOPE("TextureLoader::Finish");
+    while (IsLoading()) {
+        if (!Update()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+size_t TextureLoader::GetMemoryBudget()
+{
+    return m_memoryBudget;
+}
+
+size_t TextureLoader::GetMemoryUsed()
+{
+    return m_memoryUsed;
+}
+
+GLuint TextureLoader::GetTexID(int handle)
+{
+    if (handle >= 0 && handle < static_cast<int>(m_entries.size())) {
+        const Entry& entry = m_entries[static_cast<size_t>(handle)];
+        return (entry.state == State::Ready ? entry.texID : 0);
+    }
+    return 0;
+}
+
+bool TextureLoader::IsLoading()
+{
+    return (m_numPending > 0);
+}
+
+int TextureLoader::Request(const char* filename)
+{
+    if (filename == nullptr) {
+        return -1;
+    }
+
+    auto itr = m_handles.find(filename);
+    if (itr != m_handles.end()) {
+        return itr->second;
+    }
+
+    const char* const extensions[] = { ".ppm", ".pgm", ".pnm", ".tga" };
+    bool isSupported = false;
+    for (const char* ext : extensions) {
+        isSupported |= StringEndsWith(filename, ext, false);
+    }
+    if (!isSupported) {
+        fprintf(stderr, "Image format of '%s' is not supported (PPM/PGM/TGA only)!\n", filename);
+        return -1;
+    }
+
+    int handle = static_cast<int>(m_entries.size());
+    Entry entry;
+    entry.filename = filename;
+    entry.state = State::Decoding;
+    entry.texID = 0;
+    entry.bytes = 0;
+    entry.firstLevel = 0;
+    entry.level = 0;
+    entry.row = 0;
+    m_entries.push_back(entry);
+    m_handles[filename] = handle;
+    m_numPending++;
+
+    if (m_workers.empty()) {
+        startWorkers();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Job job;
+        job.handle = handle;
+        job.generation = m_generation;
+        job.filename = filename;
+        m_jobs.push_back(job);
+    }
+    m_cond.notify_one();
+    return handle;
+}
+
+void TextureLoader::SetMemoryBudget(size_t bytes)
+{
+    m_memoryBudget = bytes;
+}
+
+bool TextureLoader::Update()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Job& job : m_done) {
+            Entry& entry = m_entries[static_cast<size_t>(job.handle)];
+            if (job.levels.empty()) {
+                finishEntry(entry, State::Failed);
+                continue;
+            }
+            entry.levels = std::move(job.levels);
+            entry.state = State::Uploading;
+            m_uploads.push_back(job.handle);
+        }
+        m_done.clear();
+    }
+
+    if (m_uploads.empty() || (m_pbo == 0 && !createStagingBuffer())) {
+        return false;
+    }
+
+    // the segment may still be read by uploads of an earlier call
+    GLsync& fence = m_fences[m_segment];
+    if (fence != nullptr) {
+        if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    TRACE_SCOPE("TextureLoader::Update");
+    bool isAvailable = false;
+    size_t segmentOffset = m_segment * SegmentSize;
+    size_t used = 0;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    while (!m_uploads.empty()) {
+        Entry& entry = m_entries[static_cast<size_t>(m_uploads.front())];
+        if (entry.texID == 0 && !allocTexture(entry)) {
+            finishEntry(entry, State::Failed);
+            m_uploads.pop_front();
+            continue;
+        }
+
+        // upload as many rows of the current level as fit into the segment
+        MipLevel& level = entry.levels[entry.level];
+        size_t rowSize = static_cast<size_t>(level.width) * 4;
+        int numRows = std::min(level.height - entry.row, static_cast<int>((SegmentSize - used) / rowSize));
+        if (numRows <= 0) {
+            break;
+        }
+
+        size_t size = rowSize * static_cast<size_t>(numRows);
+        memcpy(m_pboPtr + segmentOffset + used, &level.data[rowSize * static_cast<size_t>(entry.row)], size);
+        glBindTexture(GL_TEXTURE_2D, entry.texID);
+        glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(entry.level - entry.firstLevel), 0, entry.row,
+            level.width, numRows, GL_RGBA, GL_UNSIGNED_BYTE,
+            reinterpret_cast<const void*>(segmentOffset + used));
+        used += size;
+
+        entry.row += numRows;
+        if (entry.row == level.height) {
+            entry.row = 0;
+            entry.level++;
+        }
+        if (entry.level == entry.levels.size()) {
+            finishEntry(entry, State::Ready);
+            m_uploads.pop_front();
+            isAvailable = true;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (used > 0) {
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_segment = (m_segment + 1) % NumSegments;
+    }
+    return isAvailable;
+}
+
+bool TextureLoader::allocTexture(Entry& entry)
+{
+    // drop the finest levels until the texture fits into the budget
+    size_t bytes = 0;
+    for (const MipLevel& level : entry.levels) {
+        bytes += level.data.size();
+    }
+    size_t firstLevel = 0;
+    while (firstLevel < entry.levels.size() && m_memoryUsed + bytes > m_memoryBudget) {
+        bytes -= entry.levels[firstLevel].data.size();
+        firstLevel++;
+    }
+    if (firstLevel == entry.levels.size()) {
+        fprintf(stderr, "Texture '%s' exceeds the memory budget!\n", entry.filename.c_str());
+        return false;
+    }
+    if (static_cast<size_t>(entry.levels[firstLevel].width) * 4 > SegmentSize) {
+        fprintf(stderr, "Texture '%s' is too wide!\n", entry.filename.c_str());
+        return false;
+    }
+    if (firstLevel > 0) {
+        fprintf(stderr, "Texture '%s' is reduced to %d x %d to fit into the memory budget.\n",
+            entry.filename.c_str(), entry.levels[firstLevel].width, entry.levels[firstLevel].height);
+    }
+
+    const MipLevel& base = entry.levels[firstLevel];
+    glGenTextures(1, &entry.texID);
+    glBindTexture(GL_TEXTURE_2D, entry.texID);
+    glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(entry.levels.size() - firstLevel), GL_RGBA8, base.width,
+        base.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    entry.bytes = bytes;
+    entry.firstLevel = firstLevel;
+    entry.level = firstLevel;
+    entry.row = 0;
+    m_memoryUsed += bytes;
+    return true;
+}
+
+bool TextureLoader::createStagingBuffer()
+{
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr size = static_cast<GLsizeiptr>(NumSegments * SegmentSize);
+
+    glGenBuffers(1, &m_pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+    m_pboPtr = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (m_pboPtr == nullptr) {
+        fprintf(stderr, "Cannot map texture staging buffer!\n");
+        glDeleteBuffers(1, &m_pbo);
+        m_pbo = 0;
+        return false;
+    }
+    return true;
+}
+
+void TextureLoader::finishEntry(Entry& entry, State state)
+{
+    entry.state = state;
+    std::vector<MipLevel>().swap(entry.levels);
+    m_numPending--;
+}
+
+void TextureLoader::startWorkers()
+{
+    unsigned int numWorkers = std::max(1u, std::min(std::thread::hardware_concurrency(), MaxNumWorkers));
+    m_quit = false;
+    for (unsigned int i = 0; i < numWorkers; i++) {
+        m_workers.push_back(std::thread(&TextureLoader::workerLoop, this));
+    }
+}
+
+void TextureLoader::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cond.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void TextureLoader::workerLoop()
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_quit || !m_jobs.empty(); });
+            if (m_quit) {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        MipLevel image;
+        if (decodeImage(job.filename, image)) {
+            job.levels.push_back(std::move(image));
+            generateMipmaps(job.levels);
+        }
+        else {
+            fprintf(stderr, "Cannot load texture '%s'\n", job.filename.c_str());
+        }
+
+        // results of requests before the last Clear() are dropped
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (job.generation == m_generation) {
+            m_done.push_back(std::move(job));
+        }
+    }
+}
+
+/// Next token of a PNM header, comments are skipped.
+static bool readPNMToken(const std::vector<unsigned char>& buf, size_t& pos, int& val)
+{
+    while (pos < buf.size() && (isspace(buf[pos]) || buf[pos] == '#')) {
+        if (buf[pos] == '#') {
+            while (pos < buf.size() && buf[pos] != '\n') {
+                pos++;
+            }
+        }
+        else {
+            pos++;
+        }
+    }
+    if (pos >= buf.size() || !isdigit(buf[pos])) {
+        return false;
+    }
+    val = 0;
+    while (pos < buf.size() && isdigit(buf[pos])) {
+        val = val * 10 + (buf[pos++] - '0');
+    }
+    return true;
+}
+
+/// Binary PGM (P5) or PPM (P6); rows are stored top to bottom.
+static bool decodePNM(const std::vector<unsigned char>& buf, int& width, int& height,
+    std::vector<unsigned char>& rgba)
+{
+    if (buf.size() < 2 || buf[0] != 'P' || (buf[1] != '5' && buf[1] != '6')) {
+        return false;
+    }
+    int numChannels = (buf[1] == '6' ? 3 : 1);
+    size_t pos = 2;
+    int maxVal = 0;
+    if (!readPNMToken(buf, pos, width) || !readPNMToken(buf, pos, height) || !readPNMToken(buf, pos, maxVal)
+        || width <= 0 || height <= 0 || maxVal <= 0 || maxVal > 65535) {
+        return false;
+    }
+    pos++;
+
+    size_t bytesPerSample = (maxVal > 255 ? 2 : 1);
+    size_t numPixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+    if (buf.size() < pos + numPixels * numChannels * bytesPerSample) {
+        return false;
+    }
+
+    rgba.resize(numPixels * 4);
+    const unsigned char* src = &buf[pos];
+    for (int y = 0; y < height; y++) {
+        unsigned char* dst = &rgba[static_cast<size_t>(height - 1 - y) * static_cast<size_t>(width) * 4];
+        for (int x = 0; x < width; x++) {
+            unsigned char val[3];
+            for (int c = 0; c < numChannels; c++) {
+                int sample = (bytesPerSample == 2 ? (src[0] << 8) | src[1] : src[0]);
+                val[c] = static_cast<unsigned char>(sample * 255 / maxVal);
+                src += bytesPerSample;
+            }
+            dst[0] = val[0];
+            dst[1] = val[numChannels == 3 ? 1 : 0];
+            dst[2] = val[numChannels == 3 ? 2 : 0];
+            dst[3] = 255;
+            dst += 4;
+        }
+    }
+    return true;
+}
+
+/// Uncompressed or RLE true-color (24/32 bit) and grayscale (8 bit) TGA.
+static bool decodeTGA(const std::vector<unsigned char>& buf, int& width, int& height,
+    std::vector<unsigned char>& rgba)
+{
+    const size_t headerSize = 18;
+    if (buf.size() < headerSize) {
+        return false;
+    }
+
+    int imageType = buf[2];
+    int bpp = buf[16];
+    bool isRLE = (imageType == 10 || imageType == 11);
+    bool isGray = (imageType == 3 || imageType == 11);
+    if (!(imageType == 2 || imageType == 3 || isRLE) || (isGray ? bpp != 8 : (bpp != 24 && bpp != 32))) {
+        return false;
+    }
+    width = buf[12] | (buf[13] << 8);
+    height = buf[14] | (buf[15] << 8);
+    bool isTopDown = ((buf[17] & 0x20) != 0);
+
+    size_t colorMapSize = (buf[1] == 1 ? static_cast<size_t>(buf[5] | (buf[6] << 8)) * ((buf[7] + 7) / 8) : 0);
+    size_t pos = headerSize + buf[0] + colorMapSize;
+    size_t pixelSize = static_cast<size_t>(bpp / 8);
+    size_t numPixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+    if (numPixels == 0) {
+        return false;
+    }
+
+    // expand run-length packets into plain pixels
+    std::vector<unsigned char> pixels;
+    if (isRLE) {
+        pixels.reserve(numPixels * pixelSize);
+        while (pixels.size() < numPixels * pixelSize && pos < buf.size()) {
+            int header = buf[pos++];
+            size_t count = static_cast<size_t>(header & 0x7f) + 1;
+            bool isRun = ((header & 0x80) != 0);
+            size_t packetSize = (isRun ? pixelSize : count * pixelSize);
+            if (pos + packetSize > buf.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < (isRun ? count : 1); i++) {
+                pixels.insert(pixels.end(), buf.begin() + static_cast<long>(pos),
+                    buf.begin() + static_cast<long>(pos + packetSize));
+            }
+            pos += packetSize;
+        }
+        pixels.resize(numPixels * pixelSize);
+    }
+    else {
+        if (buf.size() < pos + numPixels * pixelSize) {
+            return false;
+        }
+        pixels.assign(buf.begin() + static_cast<long>(pos),
+            buf.begin() + static_cast<long>(pos + numPixels * pixelSize));
+    }
+
+    rgba.resize(numPixels * 4);
+    const unsigned char* src = pixels.data();
+    for (int y = 0; y < height; y++) {
+        int row = (isTopDown ? height - 1 - y : y);
+        unsigned char* dst = &rgba[static_cast<size_t>(row) * static_cast<size_t>(width) * 4];
+        for (int x = 0; x < width; x++) {
+            if (isGray) {
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = 255;
+            }
+            else {
+                dst[0] = src[2];
+                dst[1] = src[1];
+                dst[2] = src[0];
+                dst[3] = (pixelSize == 4 ? src[3] : 255);
+            }
+            src += pixelSize;
+            dst += 4;
+        }
+    }
+    return true;
+}
+
+bool TextureLoader::decodeImage(const std::string& filename, MipLevel& image)
+{
+    TRACE_SCOPE("TextureLoader::decodeImage");
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::vector<unsigned char> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (StringEndsWith(filename.c_str(), ".tga", false)) {
+        return decodeTGA(buf, image.width, image.height, image.data);
+    }
+    return decodePNM(buf, image.width, image.height, image.data);
+}
+
+void TextureLoader::generateMipmaps(std::vector<MipLevel>& levels)
+{
+    TRACE_SCOPE("TextureLoader::generateMipmaps");
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const MipLevel& src = levels.back();
+        MipLevel dst;
+        dst.width = std::max(1, src.width / 2);
+        dst.height = std::max(1, src.height / 2);
+        dst.data.resize(static_cast<size_t>(dst.width) * static_cast<size_t>(dst.height) * 4);
+
+        // 2x2 box filter, the last row and column of odd sizes are clamped
+        for (int y = 0; y < dst.height; y++) {
+            int y0 = std::min(2 * y, src.height - 1);
+            int y1 = std::min(2 * y + 1, src.height - 1);
+            for (int x = 0; x < dst.width; x++) {
+                int x0 = std::min(2 * x, src.width - 1);
+                int x1 = std::min(2 * x + 1, src.width - 1);
+                const unsigned char* p00 = &src.data[(static_cast<size_t>(y0) * src.width + x0) * 4];
+                const unsigned char* p01 = &src.data[(static_cast<size_t>(y0) * src.width + x1) * 4];
+                const unsigned char* p10 = &src.data[(static_cast<size_t>(y1) * src.width + x0) * 4];
+                const unsigned char* p11 = &src.data[(static_cast<size_t>(y1) * src.width + x1) * 4];
+                unsigned char* d = &dst.data[(static_cast<size_t>(y) * dst.width + x) * 4];
+                for (int c = 0; c < 4; c++) {
+                    d[c] = static_cast<unsigned char>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+                }
+            }
+        }
+        levels.push_back(std::move(dst));
+    }
+}
@@ -0,0 +1,138 @@
+/**
+ * File:    TextureLoader.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#ifndef GRPR_TEXTURE_LOADER_H
+#define GRPR_TEXTURE_LOADER_H
+
+#include "glad/glad.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Asynchronous loading of material textures.
+ *
+ *   Images (binary PPM/PGM, uncompressed or RLE TGA) are decoded and reduced
+ *   to a full mip chain on worker threads. Update() streams the levels from
+ *   the main thread through a persistently mapped pixel unpack buffer into
+ *   immutable RGBA8 textures, at most one staging segment per call, such that
+ *   large textures do not stall a frame. Requests of the same file share one
+ *   texture. Textures that do not fit into the memory budget drop their
+ *   finest mip levels.
+ */
+class TextureLoader
+{
+public:
+    TextureLoader();
+    ~TextureLoader();
+
+    /// Discard all textures and pending requests.
+    void Clear();
+
+    /// Discard all textures and release the staging buffer.
+    void Delete();
+
+    /// Wait until all requested textures are uploaded.
+    void Finish();
+
+    size_t GetMemoryBudget();
+
+    /// Size of all textures in bytes.
+    size_t GetMemoryUsed();
+
+    /// Texture of a request, 0 as long as it is loading or if loading failed.
+    GLuint GetTexID(int handle);
+
+    /// Whether requested textures are still decoded or uploaded.
+    bool IsLoading();
+
+    /**
+     * @brief Request texture from image file.
+     * @param filename  Image file, the format is given by the file extension.
+     * @return Handle for GetTexID(), or -1 if the format is not supported.
+     */
+    int Request(const char* filename);
+
+    /// Memory budget of all textures in bytes.
+    void SetMemoryBudget(size_t bytes);
+
+    /**
+     * @brief Stream decoded images into their textures.
+     * @return true if a texture became available.
+     */
+    bool Update();
+
+protected:
+    struct MipLevel
+    {
+        int width;
+        int height;
+        std::vector<unsigned char> data;
+    };
+
+    enum class State : int { Decoding = 0, Uploading, Ready, Failed };
+
+    struct Entry
+    {
+        std::string filename;
+        State state;
+        GLuint texID;
+        size_t bytes;
+        std::vector<MipLevel> levels;
+        size_t firstLevel;  //!< finest level within the memory budget
+        size_t level;       //!< level and row to upload next
+        int row;
+    };
+
+    struct Job
+    {
+        int handle;
+        unsigned int generation;
+        std::string filename;
+        std::vector<MipLevel> levels;
+    };
+
+protected:
+    bool allocTexture(Entry& entry);
+    bool createStagingBuffer();
+    void finishEntry(Entry& entry, State state);
+    void startWorkers();
+    void stopWorkers();
+    void workerLoop();
+
+    static bool decodeImage(const std::string& filename, MipLevel& image);
+    static void generateMipmaps(std::vector<MipLevel>& levels);
+
+protected:
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, int> m_handles;
+    std::deque<int> m_uploads;
+    unsigned int m_numPending;
+    size_t m_memoryBudget;
+    size_t m_memoryUsed;
+
+    // shared with the worker threads
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Job> m_jobs;
+    std::deque<Job> m_done;
+    std::vector<std::thread> m_workers;
+    unsigned int m_generation;
+    bool m_quit;
+
+    // staging buffer, segments are reused once their fence is signaled
+    GLuint m_pbo;
+    unsigned char* m_pboPtr;
+    GLsync m_fences[3];
+    unsigned int m_segment;
+};
+
+#endif // GRPR_TEXTURE_LOADER_H
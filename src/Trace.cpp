@@ -0,0 +1,113 @@
+/**
+ * File:    Trace.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ */
+#include "Trace.h"
+
+#ifdef USE_TRACE
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct ThreadRing
+{
+    uint32_t tid;
+    std::atomic<uint64_t> head;
+    grpr::Trace::Event events[grpr::Trace::RingSize];
+};
+
+std::mutex registryMutex;
+std::vector<ThreadRing*> registry;
+
+std::chrono::steady_clock::time_point traceStart()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+/**
+ *  The ring of a thread is registered once under a lock. Afterwards, only
+ *  the owning thread writes into it. Rings are never freed such that events
+ *  of finished threads are still available when the trace is written.
+ */
+ThreadRing* threadRing()
+{
+    thread_local ThreadRing* ring = nullptr;
+    if (ring == nullptr) {
+        ring = new ThreadRing();
+        ring->head.store(0);
+        std::lock_guard<std::mutex> lock(registryMutex);
+        ring->tid = static_cast<uint32_t>(registry.size() + 1);
+        registry.push_back(ring);
+    }
+    return ring;
+}
+
+} // namespace
+
+namespace grpr {
+
+uint64_t Trace::Now()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - traceStart())
+            .count());
+}
+
+void Trace::Record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadRing* ring = threadRing();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    Event& ev = ring->events[head % RingSize];
+    ev.name = name;
+    ev.start = start;
+    ev.duration = end - start;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+bool Trace::WriteJSON(const char* filename)
+{
+    FILE* fptr = nullptr;
+#ifdef _WIN32
+    fopen_s(&fptr, filename, "w");
+#else
+    fptr = fopen(filename, "w");
+#endif
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot open trace file '%s'.\n", filename);
+        return false;
+    }
+
+    fprintf(fptr, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool first = true;
+    size_t numEvents = 0;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (ThreadRing* ring : registry) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = (head > RingSize ? head - RingSize : 0);
+        for (uint64_t i = begin; i < head; i++) {
+            const Event& ev = ring->events[i % RingSize];
+            fprintf(fptr, "%s{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%u}",
+                (first ? "" : ",\n"), ev.name, static_cast<unsigned long long>(ev.start),
+                static_cast<unsigned long long>(ev.duration), ring->tid);
+            first = false;
+            numEvents++;
+        }
+    }
+    fprintf(fptr, "\n]}\n");
+    fclose(fptr);
+
+    fprintf(stderr, "Trace with %zu events written to '%s'.\n", numEvents, filename);
+    return true;
+}
+
+} // namespace grpr
+
+#endif // USE_TRACE
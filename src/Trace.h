@@ -0,0 +1,91 @@
+/**
+ * File:    Trace.h
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ *
+ *  Scoped CPU trace markers. They are only compiled in when USE_TRACE is
+ *  defined (CMake option USE_TRACE). Every thread records into its own
+ *  ring buffer without locking; the events of all threads can be written
+ *  in the Chrome trace event format, which can be opened with
+ *  chrome://tracing or https://ui.perfetto.dev.
+ *
+ *  Usage:
+ *     void foo() {
+ *         TRACE_SCOPE("foo");
+ *         ...
+ *     }
+ *
+ *     TRACE_WRITE("trace.json");
+ */
+#ifndef GRPR_TRACE_H
+#define GRPR_TRACE_H
+
+#ifdef USE_TRACE
+
+#include <atomic>
+#include <cstdint>
+
+namespace grpr {
+
+class Trace
+{
+public:
+    struct Event
+    {
+        const char* name; //!< Static string, must outlive the trace.
+        uint64_t start; //!< Start time [us] since trace start.
+        uint64_t duration; //!< Duration [us].
+    };
+
+    /// Number of events per thread before the oldest ones are overwritten.
+    static const uint64_t RingSize = 1 << 16;
+
+    /// Get current time in microseconds since start of tracing.
+    static uint64_t Now();
+
+    /// Record a complete event for the calling thread.
+    static void Record(const char* name, uint64_t start, uint64_t end);
+
+    /**
+     * @brief Write events of all threads as Chrome trace JSON.
+     * @param filename   Output file name.
+     * @return true if file could be written.
+     */
+    static bool WriteJSON(const char* filename);
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+        : m_name(name)
+        , m_start(Trace::Now())
+    {
+    }
+
+    ~TraceScope()
+    {
+        Trace::Record(m_name, m_start, Trace::Now());
+    }
+
+private:
+    const char* m_name;
+    uint64_t m_start;
+};
+
+} // namespace grpr
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) grpr::TraceScope TRACE_CONCAT(grprTraceScope, __LINE__)(name)
+#define TRACE_WRITE(filename) grpr::Trace::WriteJSON(filename)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_WRITE(filename)
+
+#endif // USE_TRACE
+
+#endif // GRPR_TRACE_H
@@ -5,6 +5,7 @@
  *  This file is part of GRPolygonRender.
  */
 #include "VertexArray.h"
+#include "Trace.h"
 #include "Utilities.h"
 
 #include <fstream>
@@ -159,6 +160,7 @@ void VertexArray::BindBufferBase(GLenum target, GLuint idx)
 
 bool VertexArray::SetArrayBuffer(GLuint idx, GLenum type, unsigned int dim, const void* data, GLenum usage)
 {
+    TRACE_SCOPE("VertexArray::SetArrayBuffer");
     if (isDummy) {
         fprintf(stderr, "Error: it's a dummy VA: no array buffer can be set!\n");
         return false;
@@ -0,0 +1,455 @@
+/**
+ * File:    bench.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ *
+ *  Headless rendering benchmark. Every scene is rendered in every view mode
+ *  for a fixed number of frames. The results (frame-time percentiles, GPU
+ *  time, generated primitives, memory use) are written as JSON and can be
+ *  compared against a baseline file written by a previous run:
+ *
+ *    ./GRPolyRenBench  [options]
+ *
+ *      --frames <n>          number of timed frames per run        (100)
+ *      --warmup <n>          number of untimed frames per run      (10)
+ *      --size <w> <h>        framebuffer size                      (1280 720)
+ *      --lut <file>          lookup table                          (lut_r40_32x64.dat)
+ *      --lut-filter <name>   Bilinear, Bicubic, Hermite, Chebyshev (Bilinear)
+ *      --max-triangles <n>   skip procedural meshes above n        (10000000)
+ *      --output <file>       result file                           (bench.json)
+ *      --baseline <file>     compare median frame times with baseline
+ *      --threshold <f>       relative slow-down flagged as regression (0.1)
+ *
+ *  The exit code is 1 if a regression was found.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// glad then glfw
+#include "glad/glad.h"
+
+#include "GLFW/glfw3.h"
+#include "FrameBuffer.h"
+#include "Renderer.h"
+
+struct BenchScene
+{
+    std::string name;
+    std::string objFilename; //!< Empty for procedural disk.
+    unsigned int numTriangles; //!< Number of triangles of procedural disk.
+    const char* objTexture;
+    float fov;
+    float scale;
+    float euler[3];
+    float trans[3];
+};
+
+struct BenchTess
+{
+    int maxTessLevel;
+    float tessFactor;
+};
+
+struct BenchResult
+{
+    std::string id;
+    std::string scene;
+    std::string mode;
+    int maxTessLevel;
+    float tessFactor;
+    unsigned int numTriangles;
+    double mean, p50, p90, p95, p99, max;
+    double gpuMS;
+    double primitives;
+    long gpuMemKB;
+    long rssKB;
+    long peakRssKB;
+};
+
+static GLFWwindow* window = nullptr;
+Renderer* renderer = nullptr;
+FrameBuffer fbo;
+
+/**
+ *  Read resident set size of the process from /proc (Linux only).
+ */
+static void getProcessMemory(long& rssKB, long& peakKB)
+{
+    rssKB = peakKB = -1;
+#ifdef __linux__
+    std::ifstream in("/proc/self/status");
+    std::string key;
+    long value;
+    while (in >> key) {
+        if (key == "VmRSS:" && (in >> value)) {
+            rssKB = value;
+        }
+        else if (key == "VmHWM:" && (in >> value)) {
+            peakKB = value;
+        }
+    }
+#endif
+}
+
+/**
+ *  Used GPU memory via GL_NVX_gpu_memory_info, -1 if not available.
+ */
+static long getGPUMemory()
+{
+    if (!GLAD_GL_NVX_gpu_memory_info) {
+        return -1;
+    }
+    GLint total = 0, avail = 0;
+    glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &total);
+    glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &avail);
+    return static_cast<long>(total - avail);
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    double pos = p * (sorted.size() - 1);
+    size_t idx = static_cast<size_t>(pos);
+    double frac = pos - idx;
+    if (idx + 1 < sorted.size()) {
+        return sorted[idx] * (1.0 - frac) + sorted[idx + 1] * frac;
+    }
+    return sorted[idx];
+}
+
+static bool setupScene(const BenchScene& scene)
+{
+    bool isOkay = false;
+    if (scene.objFilename.empty()) {
+        isOkay = renderer->LoadDisk(scene.numTriangles, 3.0f, 15.0f);
+    }
+    else {
+        isOkay = renderer->LoadObject(scene.objFilename.c_str());
+    }
+
+    const double robs = 40.0;
+    renderer->m_camera.SetPosition(robs, 0.0, 0.0);
+    renderer->m_camera.SetPoI(0.0, 0.0, 0.0);
+    renderer->m_camera.SetFoVy(scene.fov);
+
+    renderer->m_transScale.SetScale(scene.scale, scene.scale, scene.scale);
+    renderer->m_transScale.SetTrans(scene.trans[0], scene.trans[1], scene.trans[2]);
+    renderer->m_eulerRot.SetOrderByName("z_ys_xss");
+    renderer->m_eulerRot.Set(scene.euler[0], scene.euler[1], scene.euler[2]);
+    renderer->m_obj.SetObjTextureByName(scene.objTexture);
+
+    renderer->m_blackhole.SetRadius(0.0f);
+    renderer->m_crossHairs.Show(false);
+    renderer->m_coordSystem.Show(false);
+    return isOkay;
+}
+
+static BenchResult runBenchmark(
+    const BenchScene& scene, Renderer::ViewMode mode, const BenchTess& tess, int numWarmup, int numFrames)
+{
+    BenchResult res;
+    res.scene = scene.name;
+    res.mode = Renderer::ViewModeNames[static_cast<int>(mode)];
+    res.maxTessLevel = tess.maxTessLevel;
+    res.tessFactor = tess.tessFactor;
+    res.numTriangles = renderer->m_obj.GetNumDrawVertices() / 3;
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s/%s/tess%dx%.1f", res.scene.c_str(), res.mode.c_str(), tess.maxTessLevel,
+        tess.tessFactor);
+    res.id = std::string(buf);
+
+    renderer->SetViewMode(mode);
+    renderer->m_maxTessLevel = tess.maxTessLevel;
+    renderer->m_tessFactor = tess.tessFactor;
+
+    fbo.Bind();
+    renderer->m_profiler.SetEnabled(false);
+    for (int i = 0; i < numWarmup; i++) {
+        renderer->Display();
+    }
+    glFinish();
+
+    renderer->m_profiler.SetHistorySize(static_cast<size_t>(numFrames));
+    renderer->m_profiler.SetEnabled(true);
+
+    std::vector<double> frameTimes;
+    for (int i = 0; i < numFrames; i++) {
+        auto start = std::chrono::steady_clock::now();
+        renderer->Display();
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    // The profiler reads back the queries of a frame two frames later.
+    renderer->Display();
+    renderer->Display();
+    glFinish();
+    renderer->m_profiler.SetEnabled(false);
+    fbo.Release();
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    double sum = 0.0;
+    for (double t : frameTimes) {
+        sum += t;
+    }
+    res.mean = sum / frameTimes.size();
+    res.p50 = percentile(frameTimes, 0.50);
+    res.p90 = percentile(frameTimes, 0.90);
+    res.p95 = percentile(frameTimes, 0.95);
+    res.p99 = percentile(frameTimes, 0.99);
+    res.max = frameTimes.back();
+
+    res.gpuMS = 0.0;
+    res.primitives = 0.0;
+    for (int p = 0; p < GPUProfiler::NumPasses; p++) {
+        GPUProfiler::Pass pass = static_cast<GPUProfiler::Pass>(p);
+        res.gpuMS += renderer->m_profiler.GetTime(pass);
+        res.primitives += renderer->m_profiler.GetStat(pass, GPUProfiler::Stat::Primitives);
+    }
+
+    res.gpuMemKB = getGPUMemory();
+    getProcessMemory(res.rssKB, res.peakRssKB);
+
+    fprintf(stderr, "%-40s  p50: %8.3f ms   p99: %8.3f ms   gpu: %8.3f ms   prims: %.0f\n", res.id.c_str(), res.p50,
+        res.p99, res.gpuMS, res.primitives);
+    return res;
+}
+
+/**
+ *  Each result is written into a single line, which makes it easy to read
+ *  the file back as baseline without a full JSON parser.
+ */
+static bool writeResults(const char* filename, const std::vector<BenchResult>& results, int width, int height,
+    int numWarmup, int numFrames)
+{
+    FILE* fptr = nullptr;
+#ifdef _WIN32
+    fopen_s(&fptr, filename, "w");
+#else
+    fptr = fopen(filename, "w");
+#endif
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot open file '%s' for writing.\n", filename);
+        return false;
+    }
+
+    const char* glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const char* glVersion = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+    fprintf(fptr, "{\n");
+    fprintf(fptr, "  \"gl_renderer\": \"%s\",\n", (glRenderer != nullptr ? glRenderer : ""));
+    fprintf(fptr, "  \"gl_version\": \"%s\",\n", (glVersion != nullptr ? glVersion : ""));
+    fprintf(fptr, "  \"width\": %d,\n  \"height\": %d,\n", width, height);
+    fprintf(fptr, "  \"warmup\": %d,\n  \"frames\": %d,\n", numWarmup, numFrames);
+    fprintf(fptr, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(fptr,
+            "    {\"id\": \"%s\", \"scene\": \"%s\", \"mode\": \"%s\", \"maxTessLevel\": %d, \"tessFactor\": %.2f, "
+            "\"triangles\": %u, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p95_ms\": %.4f, "
+            "\"p99_ms\": %.4f, \"max_ms\": %.4f, \"gpu_ms\": %.4f, \"primitives\": %.0f, \"gpu_mem_kb\": %ld, "
+            "\"rss_kb\": %ld, \"peak_rss_kb\": %ld}%s\n",
+            r.id.c_str(), r.scene.c_str(), r.mode.c_str(), r.maxTessLevel, r.tessFactor, r.numTriangles, r.mean,
+            r.p50, r.p90, r.p95, r.p99, r.max, r.gpuMS, r.primitives, r.gpuMemKB, r.rssKB, r.peakRssKB,
+            (i + 1 < results.size() ? "," : ""));
+    }
+    fprintf(fptr, "  ]\n}\n");
+    fclose(fptr);
+
+    fprintf(stderr, "Results written to '%s'.\n", filename);
+    return true;
+}
+
+static bool readBaseline(const char* filename, std::map<std::string, double>& baseline)
+{
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        fprintf(stderr, "Cannot open baseline file '%s'.\n", filename);
+        return false;
+    }
+
+    const std::string idKey = "\"id\": \"";
+    const std::string p50Key = "\"p50_ms\": ";
+
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t idPos = line.find(idKey);
+        size_t p50Pos = line.find(p50Key);
+        if (idPos == std::string::npos || p50Pos == std::string::npos) {
+            continue;
+        }
+        idPos += idKey.length();
+        size_t idEnd = line.find('"', idPos);
+        if (idEnd == std::string::npos) {
+            continue;
+        }
+        baseline[line.substr(idPos, idEnd - idPos)] = atof(line.c_str() + p50Pos + p50Key.length());
+    }
+    return true;
+}
+
+static int compareBaseline(const std::vector<BenchResult>& results, const char* filename, double threshold)
+{
+    std::map<std::string, double> baseline;
+    if (!readBaseline(filename, baseline)) {
+        return 0;
+    }
+
+    int numRegressions = 0;
+    fprintf(stderr, "\nComparison with baseline '%s' (median frame time):\n", filename);
+    for (const BenchResult& r : results) {
+        auto itr = baseline.find(r.id);
+        if (itr == baseline.end() || itr->second <= 0.0) {
+            fprintf(stderr, "  %-40s  no baseline\n", r.id.c_str());
+            continue;
+        }
+
+        double rel = r.p50 / itr->second - 1.0;
+        bool isRegression = (rel > threshold);
+        numRegressions += (isRegression ? 1 : 0);
+        fprintf(stderr, "  %-40s  %8.3f -> %8.3f ms  (%+6.1f%%)%s\n", r.id.c_str(), itr->second, r.p50, rel * 100.0,
+            (isRegression ? "  REGRESSION" : ""));
+    }
+    fprintf(stderr, "%d regression(s) found.\n", numRegressions);
+    return numRegressions;
+}
+
+int main(int argc, char* argv[])
+{
+    int numFrames = 100;
+    int numWarmup = 10;
+    int width = 1280;
+    int height = 720;
+    unsigned int maxTriangles = 10000000;
+    double threshold = 0.1;
+    std::string lutFilename = "lut_r40_32x64.dat";
+    std::string lutFilter = "Bilinear";
+    std::string outFilename = "bench.json";
+    std::string baselineFilename;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            numFrames = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            numWarmup = std::max(0, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--lut") == 0 && i + 1 < argc) {
+            lutFilename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--lut-filter") == 0 && i + 1 < argc) {
+            lutFilter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--max-triangles") == 0 && i + 1 < argc) {
+            maxTriangles = static_cast<unsigned int>(atol(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outFilename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselineFilename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "Unknown option '%s'.\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (!glfwInit()) {
+        fprintf(stderr, "Cannot initialize glfw.\n");
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window = glfwCreateWindow(640, 480, "", nullptr, nullptr);
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGL()) {
+        fprintf(stderr, "Failed to initialize GLAD.\n");
+        return -1;
+    }
+    glfwSwapInterval(0);
+
+    if (!fbo.Create(width, height)) {
+        return -1;
+    }
+
+    renderer = new Renderer();
+    renderer->Init(width, height);
+    if (!renderer->LoadLUT(lutFilename.c_str())) {
+        fprintf(stderr, "Cannot load lookup table '%s'.\n", lutFilename.c_str());
+        return -1;
+    }
+    renderer->SetLUTFilterByName(lutFilter.c_str());
+
+    std::vector<BenchScene> scenes = {
+        {"disk.obj", "objects/disk.obj", 0, "disk", 52.0f, 1.1f, {0.0f, 80.0f, 0.0f}, {0.0f, 0.0f, 0.0f}},
+        {"sphere.obj", "objects/sphere.obj", 0, "col_sphere", 19.0f, 1.0f, {0.0f, 0.0f, 0.0f}, {0.0f, 6.0f, 0.0001f}},
+        {"triangle.obj", "objects/triangle.obj", 0, "triangle", 20.0f, 5.0f, {0.0f, -90.0f, 0.0f},
+            {-5.0f, 3.0f, -2.0f}},
+    };
+
+    const unsigned int procTriangles[] = {10000, 100000, 1000000, 10000000};
+    for (unsigned int n : procTriangles) {
+        if (n > maxTriangles) {
+            continue;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "disk_%u", n);
+        scenes.push_back({name, "", n, "disk", 52.0f, 1.0f, {0.0f, 80.0f, 0.0f}, {0.0f, 0.0f, 0.0f}});
+    }
+
+    const std::vector<BenchTess> defaultTess = {{32, 1.0f}};
+    const std::vector<BenchTess> tessSettings = {{1, 1.0f}, {16, 1.0f}, {64, 5.0f}};
+
+    std::vector<BenchResult> results;
+    for (const BenchScene& scene : scenes) {
+        if (!setupScene(scene)) {
+            fprintf(stderr, "Skip scene '%s'.\n", scene.name.c_str());
+            continue;
+        }
+
+        for (int m = 0; m < static_cast<int>(Renderer::ViewMode::Count); m++) {
+            Renderer::ViewMode mode = static_cast<Renderer::ViewMode>(m);
+            const std::vector<BenchTess>& tessList = (mode == Renderer::ViewMode::GRtess ? tessSettings : defaultTess);
+            for (const BenchTess& tess : tessList) {
+                results.push_back(runBenchmark(scene, mode, tess, numWarmup, numFrames));
+            }
+        }
+    }
+
+    writeResults(outFilename.c_str(), results, width, height, numWarmup, numFrames);
+
+    int numRegressions = 0;
+    if (!baselineFilename.empty()) {
+        numRegressions = compareBaseline(results, baselineFilename.c_str(), threshold);
+    }
+
+    delete renderer;
+    fbo.Delete();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return (numRegressions > 0 ? 1 : 0);
+}
@@ -7,9 +7,7 @@
  *  Run:
  *    ./GLPolyRen <object filename>  <setting filename>
  */
-#include <chrono>
 #include <iostream>
-#include <thread>
 #include <tuple>
 
 // take care of the order: glad then glfw
@@ -21,8 +19,10 @@
 
 #include "ImGUIHandle.h"
 #include "FPSCounter.h"
+#include "FrameGovernor.h"
 #include "Renderer.h"
 #include "StringUtils.h"
+#include "Trace.h"
 
 #include "portable-file-dialogs.h"
 
@@ -46,6 +46,12 @@ Renderer* renderer = nullptr;
 
 static ImGUIHandle imh;
 static FPSCounter fpsCounter;
+static FrameGovernor governor;
+
+// number of GUI-only frames drawn after an event, ImGui needs a few frames to settle
+constexpr int NumGUIFrames = 3;
+// maximum time the loop sleeps while waiting for events [s]
+constexpr double EventTimeout = 1.0;
 
 void error_callback(int error, const char* description)
 {
@@ -56,7 +62,10 @@ void error_callback(int error, const char* description)
 void display(GLFWwindow* window)
 {
     if (renderer != nullptr) {
+        governor.BeginFrame(glfwGetTime());
+        renderer->m_tessLevelScale = governor.GetTessLevelScale();
         renderer->Display();
+        governor.EndFrame(renderer->ViewChanged());
     }
 }
 
@@ -105,6 +114,7 @@ void resize(GLFWwindow*, int width, int height)
     if (renderer != nullptr) {
         renderer->SetWindowSize(width, height);
     }
+    governor.SetWindowSize(width, height);
     glViewport(0, 0, width, height);
 }
 
@@ -206,6 +216,7 @@ void setCallbackFunctions()
  */
 bool loadFiles(const std::vector<std::string> files)
 {
+    renderer->SetDirty();
     if (files.size() > 0) {
         if (StringEndsWith(files[0].c_str(), ".lua")) {
 #ifdef HAVE_LUA
@@ -236,6 +247,7 @@ bool loadFiles(const std::vector<std::string> files)
  */
 void renderGUI()
 {
+    TRACE_SCOPE("renderGUI");
     imh.NewFrame();
     ImGui::Begin("GRPolyRen - Control");
 
@@ -248,6 +260,15 @@ void renderGUI()
     }
 
     renderer->RenderGUI();
+    governor.RenderGUI();
+
+    // Parameters are changed by active widgets; the frame after deactivation has to be rendered, too.
+    static bool guiWasActive = false;
+    bool guiIsActive = ImGui::IsAnyItemActive();
+    if (guiIsActive || guiWasActive) {
+        renderer->SetDirty();
+    }
+    guiWasActive = guiIsActive;
 
     if (ImGui::Button("Save current state")) {
         renderer->SaveSetting(cfgFilename.c_str());
@@ -275,6 +296,10 @@ void setWindowSize(int width, int height) {
     renderer->SetWindowSize(width, height);
 }
 
+void setTileSize(int, int) {
+    fprintf(stderr, "  setTileSize() : cannot be used in interactive version.\n");
+}
+
 bool saveImageToFile(const char* ) {
     fprintf(stderr, "  saveImageToFile() : cannot be used in interactive version.\n");
     return false;
@@ -297,6 +322,10 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    // reuse program binaries of earlier runs and let the driver compile in parallel
+    GLShader::SetBinaryCachePath("shader_cache");
+    GLShader::EnableParallelCompile(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+
     setCallbackFunctions();
 
     glfwSwapInterval(1);
@@ -309,6 +338,10 @@ int main(int argc, char* argv[])
     renderer->Init(window_width, window_height);
     renderer->LoadLUT(lutFilename.c_str());
 
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    governor.Init(fbWidth, fbHeight);
+
     if (argc > 1) {
         std::vector<std::string> files;
         for (int i = 1; i < argc; ++i) {
@@ -335,10 +368,33 @@ int main(int argc, char* argv[])
     glfwSwapInterval(0);
 #endif // USE_FPS
 
+    // The scene is rendered only if something changed; otherwise, the loop waits for
+    // events and GUI-only frames reuse the last rendered image.
+    int guiFrames = NumGUIFrames;
     while (!glfwWindowShouldClose(window)) {
+        TRACE_SCOPE("frame");
 
-        renderer->Idle(glfwGetTime());
-        display(window);
+        bool isAnimating = renderer->Idle(glfwGetTime());
+#ifdef USE_FPS
+        bool redrawScene = true;
+#else
+        bool redrawScene = isAnimating || renderer->IsDirty() || governor.NeedsRedraw();
+#endif // USE_FPS
+
+        if (!redrawScene && guiFrames <= 0) {
+            glfwWaitEventsTimeout(EventTimeout);
+            guiFrames = NumGUIFrames;
+            continue;
+        }
+
+        if (redrawScene) {
+            display(window);
+            guiFrames = NumGUIFrames;
+        }
+        else {
+            governor.Present();
+            guiFrames--;
+        }
 
 #ifdef USE_FPS            
         double fps = fpsCounter.GetFPS();
@@ -349,13 +405,15 @@ int main(int argc, char* argv[])
         glfwSwapBuffers(window);
 
 #ifndef USE_FPS            
-        std::this_thread::sleep_for(std::chrono::microseconds(5000));
+        governor.WaitForNextFrame(glfwGetTime());
 #endif // USE_FPS
 
         glfwPollEvents();
     }
     fprintf(stderr, "\n");
+    TRACE_WRITE("grpolyren_trace.json");
 
+    governor.Delete();
     imh.Shutdown();
     glfwDestroyWindow(window);
     glfwTerminate();
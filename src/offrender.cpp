@@ -10,6 +10,7 @@
  *  otherwise run:
  *    ./OfflineRen.exe  object.obj [settings.cfg]
  */
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <thread>
@@ -19,7 +20,9 @@
 #include "glad/glad.h"
 
 #include "GLFW/glfw3.h"
+#include "FrameBuffer.h"
 #include "Renderer.h"
+#include "Trace.h"
 
 #ifdef HAVE_LUA
 #include "LuaHandle.h"
@@ -31,91 +34,109 @@ std::string cfgFilename = std::string("setting.cfg");
 int window_width = 1280;
 int window_height = 720;
 
+// Requested tile size for rendering. A value of zero lets the tile size be
+// determined by the framebuffer limits of the OpenGL implementation.
+int tile_width = 0;
+int tile_height = 0;
+
+// Upper bound for automatic tiles to keep the framebuffer memory bounded.
+const int maxAutoTileSize = 4096;
+
 static GLFWwindow* window = nullptr;
 Renderer* renderer = nullptr;
-GLuint fbo = 0, fboDepth = 0, fboImg = 0;
+FrameBuffer fbo;
 
-void deleteFBO() {
-    if (glIsTexture(fboImg)) {
-        glDeleteTextures(1, &fboImg);
-        fboImg = 0;
-    }
-
-    if (glIsRenderbuffer(fboDepth)) {
-        glDeleteRenderbuffers(1, &fboDepth);
-        fboDepth = 0;
-    }
+/**
+ * Determine the size of a single tile. The tile never exceeds the
+ * maximum renderbuffer, texture, or viewport size.
+ */
+void getTileSize(int& tw, int& th) {
+    GLint maxRBSize = 0, maxTexSize = 0;
+    GLint maxViewport[2] = {0, 0};
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRBSize);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+
+    int maxW = std::min(std::min(maxRBSize, maxTexSize), maxViewport[0]);
+    int maxH = std::min(std::min(maxRBSize, maxTexSize), maxViewport[1]);
+
+    tw = (tile_width > 0 ? tile_width : std::min(maxAutoTileSize, window_width));
+    th = (tile_height > 0 ? tile_height : std::min(maxAutoTileSize, window_height));
+    tw = std::max(1, std::min(std::min(tw, maxW), window_width));
+    th = std::max(1, std::min(std::min(th, maxH), window_height));
+}
 
-    if (glIsFramebuffer(fbo)) {
-        glDeleteFramebuffers(1, &fbo);
-        fbo = 0;
-    }
+bool isTiled() {
+    int tw, th;
+    getTileSize(tw, th);
+    return (tw < window_width || th < window_height);
 }
 
 /**
- * 
+ *  The framebuffer object has the size of a single tile. If the image
+ *  fits into one tile, this is the full image size.
  */
 bool createFBO() {
-    deleteFBO();
-
-    glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-    glGenRenderbuffers(1, &fboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, fboDepth);
-
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, window_width, window_height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, fboDepth);
-    
-    glGenTextures(1, &fboImg);
-    glBindTexture(GL_TEXTURE_2D, fboImg);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, window_width, window_height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fboImg, 0);
-
-    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (status != GL_FRAMEBUFFER_COMPLETE) {
-        fprintf(stderr, "FBO incomplete!\n");
+    int tw, th;
+    getTileSize(tw, th);
+
+    if (!fbo.Create(tw, th)) {
         return false;
     }
-    
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    fprintf(stderr, "FBO complete.\n");
+    fprintf(stderr, "FBO complete (%d x %d).\n", tw, th);
     return true;
 }
 
 /**
- * 
+ *  Render the tile with lower left corner (x,y) and size (w,h) in pixels
+ *  into the framebuffer object.
+ */
+void renderTile(int x, int y, int w, int h) {
+    TRACE_SCOPE("renderTile");
+    double fw = static_cast<double>(window_width);
+    double fh = static_cast<double>(window_height);
+    renderer->m_camera.SetTileRegion(x / fw, y / fh, (x + w) / fw, (y + h) / fh);
+
+    fbo.Bind();
+    glViewport(0, 0, w, h);
+
+    renderer->m_textureLoader.Finish();
+    renderer->Display();
+    glFinish();
+
+    renderer->m_camera.ResetTileRegion();
+}
+
+/**
+ *  If the image does not fit into a single tile, the tiles are rendered
+ *  while the image is saved.
  */
 void draw() {
+    if (isTiled()) {
+        int tw, th;
+        getTileSize(tw, th);
+        fprintf(stderr, "Image (%d x %d) will be rendered in tiles of %d x %d when saved.\n",
+            window_width, window_height, tw, th);
+        return;
+    }
+
     fprintf(stderr, "Render image...\n");
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    glDrawBuffer(GL_COLOR_ATTACHMENT0);
-    glViewport(0, 0, window_width, window_height);
+    renderer->m_textureLoader.Finish();
+    fbo.Bind();
 
     renderer->Display();
     glfwSwapBuffers(window);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    fbo.Release();
 }
 
 /**
- * 
+ *  The image is written row of tiles by row of tiles, starting at the top.
+ *  Hence, only a strip of the image's width and the tile's height is kept
+ *  in memory.
  */
 bool saveImageToFile(const char* filename) {
-    size_t bufSize = window_width * window_height * 3;
-    unsigned char* rgb = new unsigned char[bufSize];
-
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-    glReadBuffer(GL_COLOR_ATTACHMENT0);
-    glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glReadPixels(0, 0, window_width, window_height, GL_RGB, GL_UNSIGNED_BYTE, rgb);
-
+    TRACE_SCOPE("saveImageToFile");
     FILE* fptr = nullptr;
 #ifdef _WIN32
     fopen_s(&fptr, filename, "wb");
@@ -125,23 +146,49 @@ bool saveImageToFile(const char* filename) {
 
     if (fptr == nullptr) {
         fprintf(stderr, "Error...\n");
-        delete [] rgb;
         return false;
     }
 
-    fprintf(stderr, "Save image to file '%s'.\n", filename);
+    bool tiled = isTiled();
+    int tw, th;
+    getTileSize(tw, th);
 
-    fprintf(fptr, "P6\n%d %d\n255\n", window_width, window_height);    
-    //fwrite(rgb, sizeof(unsigned char), window_width * window_height * 3, fptr);
+    size_t bufSize = static_cast<size_t>(window_width) * th * 3;
+    unsigned char* rgb = new unsigned char[bufSize];
 
-    unsigned char* dptr;
-    for(unsigned int r = 0; r < window_height; r++) {
-        dptr = &rgb[3 * (window_height - r - 1) * window_width];
-        fwrite(dptr, sizeof(unsigned char), window_width * 3, fptr);
+    fprintf(stderr, "Save image to file '%s'.\n", filename);
+    fprintf(fptr, "P6\n%d %d\n255\n", window_width, window_height);
+
+    int numTilesX = (window_width + tw - 1) / tw;
+    int numTilesY = (window_height + th - 1) / th;
+    int tileCount = 0;
+
+    for(int yTop = window_height; yTop > 0; yTop -= th) {
+        int y = std::max(0, yTop - th);
+        int h = yTop - y;
+
+        for(int x = 0; x < window_width; x += tw) {
+            int w = std::min(tw, window_width - x);
+            if (tiled) {
+                fprintf(stderr, "\rRender tile %d/%d ...", ++tileCount, numTilesX * numTilesY);
+                renderTile(x, y, w, h);
+            }
+
+            fbo.ReadPixels(0, 0, w, h, window_width, &rgb[3 * x]);
+        }
+
+        unsigned char* dptr;
+        for(int r = 0; r < h; r++) {
+            dptr = &rgb[3 * static_cast<size_t>(h - r - 1) * window_width];
+            fwrite(dptr, sizeof(unsigned char), window_width * 3, fptr);
+        }
+    }
+    if (tiled) {
+        fprintf(stderr, "\n");
     }
     fclose(fptr);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    fbo.Release();
     delete [] rgb;
     return true;
 }
@@ -153,6 +200,12 @@ void setWindowSize(int width, int height) {
     createFBO();
 }
 
+void setTileSize(int width, int height) {
+    tile_width = width;
+    tile_height = height;
+    createFBO();
+}
+
 /**
  * 
  */
@@ -182,6 +235,10 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    // reuse program binaries of earlier runs and let the driver compile in parallel
+    GLShader::SetBinaryCachePath("shader_cache");
+    GLShader::EnableParallelCompile(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+
     createFBO();
 
     renderer = new Renderer();
@@ -208,7 +265,9 @@ int main(int argc, char* argv[]) {
     saveImageToFile("out.ppm");    
 #endif    
 
-    deleteFBO();
+    TRACE_WRITE("offlineren_trace.json");
+
+    fbo.Delete();
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
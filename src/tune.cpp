@@ -0,0 +1,340 @@
+/**
+ * File:    tune.cpp
+ * Author:  Thomas Mueller, HdA/MPIA
+ *
+ *  This file is part of GRPolygonRender.
+ *
+ *  Tessellation tuning tool. The bundled objects are rendered headlessly in
+ *  GRtess mode with a highly tessellated reference setting and for a grid of
+ *  maxTessLevel, tessFactor, tessExpon, and distRelation values. For every
+ *  setting, GPU time and generated primitives are measured and the image is
+ *  compared with the reference. The pixel error is the percentage of pixels
+ *  whose color deviates by more than a tolerance in any channel.
+ *
+ *  The Pareto-optimal settings with respect to GPU time and worst pixel error
+ *  over all scenes are written as presets, which can be loaded by GRPolyRen
+ *  (see TessPresets).
+ *
+ *    ./GRPolyRenTune  [options]
+ *
+ *      --frames <n>          number of timed frames per setting    (20)
+ *      --warmup <n>          number of untimed frames per setting  (3)
+ *      --size <w> <h>        framebuffer size                      (960 540)
+ *      --lut <file>          lookup table                          (lut_r40_32x64.dat)
+ *      --tolerance <n>       color tolerance per channel [0,255]   (8)
+ *      --output <file>       preset file                           (tess_presets.json)
+ *      --results <file>      all measurements                      (tune_results.json)
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// glad then glfw
+#include "glad/glad.h"
+
+#include "GLFW/glfw3.h"
+#include "FrameBuffer.h"
+#include "Renderer.h"
+#include "TessPresets.h"
+
+struct TuneScene
+{
+    std::string name;
+    std::string objFilename;
+    const char* objTexture;
+    float fov;
+    float scale;
+    float euler[3];
+    float trans[3];
+};
+
+struct TuneResult
+{
+    std::string scene;
+    TessPresets::Preset preset;
+    double meanAbsError;
+};
+
+static GLFWwindow* window = nullptr;
+Renderer* renderer = nullptr;
+FrameBuffer fbo;
+
+static bool setupScene(const TuneScene& scene)
+{
+    bool isOkay = renderer->LoadObject(scene.objFilename.c_str());
+
+    const double robs = 40.0;
+    renderer->m_camera.SetPosition(robs, 0.0, 0.0);
+    renderer->m_camera.SetPoI(0.0, 0.0, 0.0);
+    renderer->m_camera.SetFoVy(scene.fov);
+
+    renderer->m_transScale.SetScale(scene.scale, scene.scale, scene.scale);
+    renderer->m_transScale.SetTrans(scene.trans[0], scene.trans[1], scene.trans[2]);
+    renderer->m_eulerRot.SetOrderByName("z_ys_xss");
+    renderer->m_eulerRot.Set(scene.euler[0], scene.euler[1], scene.euler[2]);
+    renderer->m_obj.SetObjTextureByName(scene.objTexture);
+
+    renderer->m_blackhole.SetRadius(0.0f);
+    renderer->m_crossHairs.Show(false);
+    renderer->m_coordSystem.Show(false);
+    return isOkay;
+}
+
+/**
+ *  Render scene with the given tessellation setting.
+ * @param preset  Tessellation parameters; GPU time and primitives are filled in.
+ * @param rgb     Final image.
+ */
+static void render(TessPresets::Preset& preset, int numWarmup, int numFrames, std::vector<unsigned char>& rgb)
+{
+    renderer->m_maxTessLevel = preset.maxTessLevel;
+    renderer->m_tessFactor = preset.tessFactor;
+    renderer->m_tessExpon = preset.tessExpon;
+    renderer->m_distRelation = preset.distRelation;
+
+    fbo.Bind();
+    renderer->m_profiler.SetEnabled(false);
+    for (int i = 0; i < numWarmup; i++) {
+        renderer->Display();
+    }
+
+    renderer->m_profiler.SetHistorySize(static_cast<size_t>(numFrames));
+    renderer->m_profiler.SetEnabled(true);
+    for (int i = 0; i < numFrames; i++) {
+        renderer->Display();
+    }
+
+    // The profiler reads back the queries of a frame two frames later.
+    renderer->Display();
+    renderer->Display();
+    glFinish();
+    renderer->m_profiler.SetEnabled(false);
+
+    preset.gpuMS = 0.0;
+    preset.primitives = 0.0;
+    for (int p = 0; p < GPUProfiler::NumPasses; p++) {
+        GPUProfiler::Pass pass = static_cast<GPUProfiler::Pass>(p);
+        preset.gpuMS += renderer->m_profiler.GetTime(pass);
+        preset.primitives += renderer->m_profiler.GetStat(pass, GPUProfiler::Stat::Primitives);
+    }
+
+    rgb.resize(3 * static_cast<size_t>(fbo.GetWidth()) * fbo.GetHeight());
+    fbo.ReadPixels(0, 0, fbo.GetWidth(), fbo.GetHeight(), 0, rgb.data());
+    fbo.Release();
+}
+
+/**
+ *  Percentage of pixels which deviate by more than 'tolerance' in any channel.
+ */
+static double pixelError(const std::vector<unsigned char>& img, const std::vector<unsigned char>& ref, int tolerance,
+    double& meanAbsError)
+{
+    size_t numPixels = img.size() / 3;
+    size_t numBad = 0;
+    double sum = 0.0;
+    for (size_t i = 0; i < numPixels; i++) {
+        int maxDiff = 0;
+        for (size_t c = 0; c < 3; c++) {
+            int diff = abs(static_cast<int>(img[3 * i + c]) - static_cast<int>(ref[3 * i + c]));
+            maxDiff = std::max(maxDiff, diff);
+            sum += diff;
+        }
+        numBad += (maxDiff > tolerance ? 1 : 0);
+    }
+    meanAbsError = (numPixels > 0 ? sum / (3.0 * numPixels) : 0.0);
+    return (numPixels > 0 ? 100.0 * numBad / numPixels : 0.0);
+}
+
+static bool writeResults(const char* filename, const std::vector<TuneResult>& results, int tolerance)
+{
+    FILE* fptr = nullptr;
+#ifdef _WIN32
+    fopen_s(&fptr, filename, "w");
+#else
+    fptr = fopen(filename, "w");
+#endif
+    if (fptr == nullptr) {
+        fprintf(stderr, "Cannot open file '%s' for writing.\n", filename);
+        return false;
+    }
+
+    fprintf(fptr, "{\n  \"tolerance\": %d,\n  \"results\": [\n", tolerance);
+    for (size_t i = 0; i < results.size(); i++) {
+        const TuneResult& r = results[i];
+        const TessPresets::Preset& p = r.preset;
+        fprintf(fptr,
+            "    {\"scene\": \"%s\", \"maxTessLevel\": %d, \"tessFactor\": %.3f, \"tessExpon\": %.3f, "
+            "\"distRelation\": %.1f, \"pixelError\": %.5f, \"meanAbsError\": %.5f, \"gpu_ms\": %.4f, "
+            "\"primitives\": %.0f}%s\n",
+            r.scene.c_str(), p.maxTessLevel, p.tessFactor, p.tessExpon, p.distRelation, p.pixelError, r.meanAbsError,
+            p.gpuMS, p.primitives, (i + 1 < results.size() ? "," : ""));
+    }
+    fprintf(fptr, "  ]\n}\n");
+    fclose(fptr);
+
+    fprintf(stderr, "Results written to '%s'.\n", filename);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int numFrames = 20;
+    int numWarmup = 3;
+    int width = 960;
+    int height = 540;
+    int tolerance = 8;
+    std::string lutFilename = "lut_r40_32x64.dat";
+    std::string outFilename = "tess_presets.json";
+    std::string resultsFilename = "tune_results.json";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            numFrames = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            numWarmup = std::max(0, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--lut") == 0 && i + 1 < argc) {
+            lutFilename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = std::max(0, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outFilename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--results") == 0 && i + 1 < argc) {
+            resultsFilename = argv[++i];
+        }
+        else {
+            fprintf(stderr, "Unknown option '%s'.\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (!glfwInit()) {
+        fprintf(stderr, "Cannot initialize glfw.\n");
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window = glfwCreateWindow(640, 480, "", nullptr, nullptr);
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGL()) {
+        fprintf(stderr, "Failed to initialize GLAD.\n");
+        return -1;
+    }
+    glfwSwapInterval(0);
+
+    if (!fbo.Create(width, height)) {
+        return -1;
+    }
+
+    renderer = new Renderer();
+    renderer->Init(width, height);
+    if (!renderer->LoadLUT(lutFilename.c_str())) {
+        fprintf(stderr, "Cannot load lookup table '%s'.\n", lutFilename.c_str());
+        return -1;
+    }
+
+    // The full tessellation pipeline is measured, not the cached geometry.
+    renderer->SetViewMode(Renderer::ViewMode::GRtess);
+    renderer->m_useGeometryCache = false;
+
+    const std::vector<TuneScene> scenes = {
+        {"disk.obj", "objects/disk.obj", "disk", 52.0f, 1.1f, {0.0f, 80.0f, 0.0f}, {0.0f, 0.0f, 0.0f}},
+        {"sphere.obj", "objects/sphere.obj", "col_sphere", 19.0f, 1.0f, {0.0f, 0.0f, 0.0f}, {0.0f, 6.0f, 0.0001f}},
+        {"triangle.obj", "objects/triangle.obj", "triangle", 20.0f, 5.0f, {0.0f, -90.0f, 0.0f}, {-5.0f, 3.0f, -2.0f}},
+    };
+
+    const int maxTessLevels[] = {1, 2, 4, 8, 16, 32, 64};
+    const float tessFactors[] = {0.5f, 1.0f, 2.0f, 5.0f};
+    const float tessExpons[] = {0.5f, 0.75f, 1.0f};
+    const float distRelations[] = {50.0f, 100.0f, 200.0f};
+
+    std::vector<TessPresets::Preset> settings;
+    for (int mtl : maxTessLevels) {
+        for (float factor : tessFactors) {
+            for (float expon : tessExpons) {
+                for (float rel : distRelations) {
+                    settings.push_back({mtl, factor, expon, rel, 0.0, 0.0, 0.0});
+                }
+            }
+        }
+    }
+
+    // Saturated tessellation factor, i.e. every edge is split maxTessLevel times.
+    TessPresets::Preset reference = {64, 1000.0f, 0.75f, 100.0f, 0.0, 0.0, 0.0};
+
+    std::vector<TuneResult> results;
+    std::vector<TessPresets::Preset> candidates = settings;
+
+    size_t numScenes = 0;
+    std::vector<unsigned char> refImage, image;
+    for (const TuneScene& scene : scenes) {
+        if (!setupScene(scene)) {
+            fprintf(stderr, "Skip scene '%s'.\n", scene.name.c_str());
+            continue;
+        }
+        numScenes++;
+
+        TessPresets::Preset ref = reference;
+        render(ref, numWarmup, numFrames, refImage);
+        fprintf(stderr, "%-14s reference  gpu: %8.3f ms   prims: %.0f\n", scene.name.c_str(), ref.gpuMS, ref.primitives);
+
+        for (size_t i = 0; i < settings.size(); i++) {
+            TuneResult res;
+            res.scene = scene.name;
+            res.preset = settings[i];
+            render(res.preset, numWarmup, numFrames, image);
+            res.preset.pixelError = pixelError(image, refImage, tolerance, res.meanAbsError);
+            results.push_back(res);
+
+            fprintf(stderr, "%-14s tess %2d x %4.1f ^ %4.2f  rel %5.0f   err: %8.4f %%   gpu: %8.3f ms   prims: %.0f\n",
+                scene.name.c_str(), res.preset.maxTessLevel, res.preset.tessFactor, res.preset.tessExpon,
+                res.preset.distRelation, res.preset.pixelError, res.preset.gpuMS, res.preset.primitives);
+
+            // worst error and mean cost over all scenes
+            TessPresets::Preset& c = candidates[i];
+            c.pixelError = std::max(c.pixelError, res.preset.pixelError);
+            c.gpuMS += res.preset.gpuMS;
+            c.primitives += res.preset.primitives;
+        }
+    }
+
+    if (numScenes > 0) {
+        for (TessPresets::Preset& c : candidates) {
+            c.gpuMS /= numScenes;
+            c.primitives /= numScenes;
+        }
+
+        writeResults(resultsFilename.c_str(), results, tolerance);
+
+        TessPresets presets;
+        presets.SetParetoFront(candidates);
+        presets.Save(outFilename.c_str());
+
+        fprintf(stderr, "\nPareto-optimal presets:\n");
+        for (size_t i = 0; i < presets.GetNumPresets(); i++) {
+            const TessPresets::Preset& p = presets.GetPreset(i);
+            fprintf(stderr, "  tess %2d x %4.1f ^ %4.2f  rel %5.0f   err: %8.4f %%   gpu: %8.3f ms\n", p.maxTessLevel,
+                p.tessFactor, p.tessExpon, p.distRelation, p.pixelError, p.gpuMS);
+        }
+    }
+
+    delete renderer;
+    fbo.Delete();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return (numScenes > 0 ? 0 : -1);
+}